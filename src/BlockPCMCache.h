@@ -0,0 +1,214 @@
+#pragma once
+
+// Cache en PSRAM de bloques ya renderizados.
+//
+// Guardar el PCM tal cual no es viable (a 96KHz estereo son 384KB por
+// segundo), asi que cada bloque se guarda como la secuencia de tramos de
+// nivel constante que pasa por ZXProcessor::emitFrame(). Cada tramo ocupa
+// 32 bits: 24 bits de muestras y 8 bits de indice a una paleta de frames
+// estereo (normalmente solo hay 2 o 3 niveles distintos por bloque).
+//
+// La entrada es valida solo para los mismos ajustes de salida con los que se
+// genero: sampling rate, nivel inicial del flanco y frames de nivel alto y
+// bajo (que ya llevan aplicados volumen y speaker).
+//
+// Las entradas se capturan mientras el bloque suena; no hay render anticipado
+// del bloque siguiente.
+
+#define BLOCK_CACHE_MAX_RUN 0x00FFFFFF
+
+struct tBlockCacheEntry {
+  bool valid = false;
+  int block = -1;
+  // Ajustes de salida (clave)
+  uint32_t sr = 0;
+  uint8_t startEdge = 0;
+  uint32_t frameLow = 0;
+  uint32_t frameHigh = 0;
+  // Tramos
+  uint32_t *runs = nullptr;
+  int numRuns = 0;
+  int capacity = 0;
+  uint32_t palette[BLOCK_CACHE_PALETTE];
+  int paletteSize = 0;
+  // Estado al terminar el bloque
+  uint8_t endEdge = 0;
+  uint64_t endPhase = 0;
+  uint64_t totalT = 0;
+  uint64_t totalSamples = 0;
+  unsigned long lastUse = 0;
+};
+
+class BlockPCMCache {
+private:
+  tBlockCacheEntry _entries[BLOCK_CACHE_SLOTS];
+  tBlockCacheEntry *_capture = nullptr;
+  size_t _usedBytes = 0;
+  unsigned long _useCounter = 0;
+
+  void release(tBlockCacheEntry &e) {
+    if (e.runs != nullptr) {
+      free(e.runs);
+      _usedBytes -= e.capacity * sizeof(uint32_t);
+    }
+    e.runs = nullptr;
+    e.numRuns = 0;
+    e.capacity = 0;
+    e.paletteSize = 0;
+    e.valid = false;
+    e.block = -1;
+  }
+
+  tBlockCacheEntry *oldest(tBlockCacheEntry *except) {
+    // Entrada valida menos usada recientemente
+    tBlockCacheEntry *lru = nullptr;
+    for (int i = 0; i < BLOCK_CACHE_SLOTS; i++) {
+      tBlockCacheEntry *e = &_entries[i];
+      if (e == except || !e->valid) {
+        continue;
+      }
+      if (lru == nullptr || e->lastUse < lru->lastUse) {
+        lru = e;
+      }
+    }
+    return lru;
+  }
+
+  bool grow() {
+    // Duplicamos la capacidad del bloque en captura, liberando bloques
+    // antiguos si nos pasamos del presupuesto
+    int newCapacity = (_capture->capacity == 0) ? 4096 : _capture->capacity * 2;
+    size_t extra = (newCapacity - _capture->capacity) * sizeof(uint32_t);
+
+    while (_usedBytes + extra > BLOCK_CACHE_SIZE) {
+      tBlockCacheEntry *lru = oldest(_capture);
+      if (lru == nullptr) {
+        // No cabe ni vaciando la cache
+        return false;
+      }
+      release(*lru);
+    }
+
+    uint32_t *runs =
+        (uint32_t *)ps_realloc(_capture->runs, newCapacity * sizeof(uint32_t));
+    if (runs == nullptr) {
+      return false;
+    }
+
+    _capture->runs = runs;
+    _capture->capacity = newCapacity;
+    _usedBytes += extra;
+    return true;
+  }
+
+public:
+  bool isCapturing() const { return _capture != nullptr; }
+
+  size_t getUsedBytes() const { return _usedBytes; }
+
+  void clear() {
+    _capture = nullptr;
+    for (int i = 0; i < BLOCK_CACHE_SLOTS; i++) {
+      release(_entries[i]);
+    }
+  }
+
+  tBlockCacheEntry *find(int block, uint32_t sr, uint8_t edge,
+                         uint32_t frameLow, uint32_t frameHigh) {
+    for (int i = 0; i < BLOCK_CACHE_SLOTS; i++) {
+      tBlockCacheEntry &e = _entries[i];
+      if (e.valid && e.block == block && e.sr == sr && e.startEdge == edge &&
+          e.frameLow == frameLow && e.frameHigh == frameHigh) {
+        e.lastUse = ++_useCounter;
+        return &e;
+      }
+    }
+    return nullptr;
+  }
+
+  void startCapture(int block, uint32_t sr, uint8_t edge, uint32_t frameLow,
+                    uint32_t frameHigh) {
+    // Buscamos hueco: libre, misma clave de bloque o la mas antigua
+    tBlockCacheEntry *slot = nullptr;
+    for (int i = 0; i < BLOCK_CACHE_SLOTS && slot == nullptr; i++) {
+      if (_entries[i].block == block || _entries[i].runs == nullptr) {
+        slot = &_entries[i];
+      }
+    }
+    if (slot == nullptr) {
+      slot = oldest(nullptr);
+    }
+    if (slot == nullptr) {
+      _capture = nullptr;
+      return;
+    }
+
+    release(*slot);
+    slot->block = block;
+    slot->sr = sr;
+    slot->startEdge = edge;
+    slot->frameLow = frameLow;
+    slot->frameHigh = frameHigh;
+    _capture = slot;
+  }
+
+  void capture(uint32_t frame, int samples) {
+    if (_capture == nullptr || samples <= 0) {
+      return;
+    }
+
+    // Indice del frame en la paleta
+    int idx = 0;
+    while (idx < _capture->paletteSize && _capture->palette[idx] != frame) {
+      idx++;
+    }
+    if (idx == _capture->paletteSize) {
+      if (idx == BLOCK_CACHE_PALETTE) {
+        // Demasiados niveles. Este bloque no se cachea
+        abortCapture();
+        return;
+      }
+      _capture->palette[_capture->paletteSize++] = frame;
+    }
+
+    // Los tramos muy largos (pausas) se parten en trozos de 24 bits
+    while (samples > 0) {
+      if (_capture->numRuns == _capture->capacity && !grow()) {
+        abortCapture();
+        return;
+      }
+      uint32_t n = (samples > BLOCK_CACHE_MAX_RUN) ? BLOCK_CACHE_MAX_RUN : samples;
+      _capture->runs[_capture->numRuns++] = n | ((uint32_t)idx << 24);
+      samples -= n;
+    }
+  }
+
+  void abortCapture() {
+    if (_capture != nullptr) {
+      release(*_capture);
+      _capture = nullptr;
+    }
+  }
+
+  void endCapture(uint8_t endEdge, uint64_t endPhase, uint64_t totalT,
+                  uint64_t totalSamples, uint32_t frameLow, uint32_t frameHigh) {
+    if (_capture == nullptr) {
+      return;
+    }
+
+    // Si el volumen ha cambiado durante el bloque la clave ya no vale
+    if (_capture->numRuns == 0 || _capture->frameLow != frameLow ||
+        _capture->frameHigh != frameHigh) {
+      abortCapture();
+      return;
+    }
+
+    _capture->endEdge = endEdge;
+    _capture->endPhase = endPhase;
+    _capture->totalT = totalT;
+    _capture->totalSamples = totalSamples;
+    _capture->lastUse = ++_useCounter;
+    _capture->valid = true;
+    _capture = nullptr;
+  }
+};
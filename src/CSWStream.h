@@ -0,0 +1,183 @@
+#pragma once
+
+// Lectura en streaming de los pulsos de un bloque CSW (RLE o Z-RLE).
+//
+// Al analizar la cinta solo se guarda dónde empiezan los datos y cuántos
+// bytes ocupan. Al reproducir, los datos se leen de la SD en trozos de
+// CSW_STREAM_CHUNK y, si van comprimidos, se descomprimen con tinfl sobre
+// un diccionario circular de TINFL_LZ_DICT_SIZE. La memoria usada es la
+// misma para un bloque de 1KB que para uno de 10MB.
+//
+// Formato RLE de CSW v2: cada byte distinto de cero es la duración del
+// pulso en muestras; un 0x00 va seguido de un DWORD con la duración.
+
+#include <miniz.h>
+
+class CSWStream {
+private:
+  File _file;
+  uint32_t _pos = 0; // Siguiente byte del fichero a leer
+  uint32_t _start = 0;
+  uint32_t _end = 0;
+  bool _zrle = false;
+  bool _failed = false;
+
+  // Entrada (tal cual está en el fichero)
+  uint8_t *_in = nullptr;
+  size_t _inLen = 0;
+  size_t _inPos = 0;
+
+  // Salida de tinfl (solo Z-RLE)
+  tinfl_decompressor *_inflator = nullptr;
+  uint8_t *_dict = nullptr;
+  size_t _dictPos = 0; // Donde escribe tinfl la siguiente salida
+  size_t _outPos = 0;  // Siguiente byte RLE por leer
+  size_t _outLen = 0;  // Bytes RLE pendientes desde _outPos
+  bool _inflateDone = false;
+
+  bool refillInput() {
+    if (_pos >= _end) {
+      return false;
+    }
+    size_t n = min((uint32_t)CSW_STREAM_CHUNK, _end - _pos);
+    _file.seek(_pos);
+    _inLen = _file.read(_in, n);
+    _inPos = 0;
+    _pos += _inLen;
+    return _inLen > 0;
+  }
+
+  bool inflateMore() {
+    // Descomprime hasta tener algo de salida o llegar al final
+    while (!_inflateDone) {
+      if (_inPos == _inLen && _pos < _end && !refillInput()) {
+        _failed = true;
+        return false;
+      }
+
+      size_t inBytes = _inLen - _inPos;
+      size_t outBytes = TINFL_LZ_DICT_SIZE - _dictPos;
+      mz_uint32 flags = TINFL_FLAG_PARSE_ZLIB_HEADER;
+      if (_pos < _end) {
+        flags |= TINFL_FLAG_HAS_MORE_INPUT;
+      }
+
+      tinfl_status status =
+          tinfl_decompress(_inflator, _in + _inPos, &inBytes, _dict,
+                           _dict + _dictPos, &outBytes, flags);
+      _inPos += inBytes;
+      _outPos = _dictPos;
+      _outLen = outBytes;
+      _dictPos = (_dictPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+      if (status < TINFL_STATUS_DONE) {
+        logln("CSW: Z-RLE data error " + String((int)status));
+        _failed = true;
+        return false;
+      }
+      if (status == TINFL_STATUS_DONE) {
+        _inflateDone = true;
+      } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && _pos >= _end &&
+                 _inPos == _inLen) {
+        logln("CSW: Z-RLE stream truncated");
+        _failed = true;
+        _inflateDone = true;
+      }
+      if (outBytes > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool nextByte(uint8_t &b) {
+    if (_zrle) {
+      if (_outLen == 0 && !inflateMore()) {
+        return false;
+      }
+      b = _dict[_outPos++];
+      _outLen--;
+      return true;
+    }
+
+    if (_inPos == _inLen && !refillInput()) {
+      return false;
+    }
+    b = _in[_inPos++];
+    return true;
+  }
+
+public:
+  bool begin(File &file, uint32_t offset, uint32_t size, bool zrle) {
+    end();
+
+    _in = (uint8_t *)ps_malloc(CSW_STREAM_CHUNK);
+    if (zrle) {
+      _inflator = (tinfl_decompressor *)ps_malloc(sizeof(tinfl_decompressor));
+      _dict = (uint8_t *)ps_malloc(TINFL_LZ_DICT_SIZE);
+    }
+    if (_in == nullptr || (zrle && (_inflator == nullptr || _dict == nullptr))) {
+      end();
+      return false;
+    }
+
+    if (zrle) {
+      tinfl_init(_inflator);
+    }
+
+    _file = file;
+    _start = offset;
+    _pos = offset;
+    _end = offset + size;
+    _zrle = zrle;
+    return true;
+  }
+
+  void end() {
+    free(_in);
+    free(_inflator);
+    free(_dict);
+    _in = nullptr;
+    _inflator = nullptr;
+    _dict = nullptr;
+    _inLen = 0;
+    _inPos = 0;
+    _dictPos = 0;
+    _outPos = 0;
+    _outLen = 0;
+    _inflateDone = false;
+    _failed = false;
+  }
+
+  bool failed() const { return _failed; }
+
+  int getProgress() const {
+    // Porcentaje de los datos del bloque ya leídos de la SD
+    return (_end > _start) ? (int)(((uint64_t)(_pos - _start) * 100) /
+                                   (_end - _start))
+                           : 100;
+  }
+
+  bool nextPulse(uint32_t &samples) {
+    uint8_t b;
+    if (!nextByte(b)) {
+      return false;
+    }
+    if (b != 0) {
+      samples = b;
+      return true;
+    }
+
+    // Pulso largo: DWORD little-endian
+    uint8_t d[4];
+    for (int i = 0; i < 4; i++) {
+      if (!nextByte(d[i])) {
+        _failed = true;
+        return false;
+      }
+    }
+    samples = ((uint32_t)d[3] << 24) | ((uint32_t)d[2] << 16) |
+              ((uint32_t)d[1] << 8) | d[0];
+    return true;
+  }
+};
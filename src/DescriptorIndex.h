@@ -0,0 +1,453 @@
+#pragma once
+
+// Indice de bloques persistente (.dsc) junto al fichero de cinta, como
+// fichero oculto (.nombre.ext.dsc).
+//
+// Al abrir un TZX/TSX/CDT o PZX por primera vez se analiza completo y se
+// guarda aqui la tabla de descriptores junto con los datos que cuelgan de
+// ella (secuencias de pulsos, tablas de simbolos del ID 0x19, pulsos
+// PZX...). La siguiente vez que se abre el mismo fichero la tabla se
+// recupera con una sola lectura de la SD.
+//
+// El indice solo vale para el mismo fichero (tamaño y fecha de modificación)
+// y para la misma version del firmware (version del formato y tamaño de los
+// descriptores). Si algo no coincide se ignora y se vuelve a generar.
+
+#define DSC_MAGIC 0x43534450 // "PDSC"
+#define DSC_VERSION 8
+#define DSC_FORMAT_TZX 1
+#define DSC_FORMAT_PZX 2
+
+struct tDscHeader {
+  uint32_t magic = DSC_MAGIC;
+  uint16_t version = DSC_VERSION;
+  uint8_t format = 0;
+  uint8_t hasGroupBlocks = 0;
+  uint32_t descriptorSize = 0; // sizeof del descriptor al generarlo
+  uint32_t fileSize = 0;       // Clave: fichero de cinta
+  uint32_t fileTime = 0;
+  int32_t numBlocks = 0;
+  int32_t totalBlocks = 0;
+  int32_t groupCount = 0;
+  char programName[32] = {0};
+  uint32_t payloadSize = 0;
+};
+
+class DescriptorIndex {
+private:
+  uint8_t *_buf = nullptr;
+  size_t _len = 0;
+  size_t _cap = 0;
+  size_t _pos = 0;
+
+  // ------------------------------------------------------------------
+  // Escritura / lectura del buffer en PSRAM
+  // ------------------------------------------------------------------
+  bool put(const void *data, size_t n) {
+    if (_len + n > _cap) {
+      size_t cap = (_cap == 0) ? 16384 : _cap;
+      while (cap < _len + n) {
+        cap *= 2;
+      }
+      uint8_t *buf = (uint8_t *)ps_realloc(_buf, cap);
+      if (buf == nullptr) {
+        return false;
+      }
+      _buf = buf;
+      _cap = cap;
+    }
+    memcpy(_buf + _len, data, n);
+    _len += n;
+    return true;
+  }
+
+  bool get(void *data, size_t n) {
+    if (_pos + n > _len) {
+      return false;
+    }
+    memcpy(data, _buf + _pos, n);
+    _pos += n;
+    return true;
+  }
+
+  bool putArray(const void *data, int count, size_t elemSize) {
+    // Marca de presencia y, si hay datos, el array completo
+    uint8_t present = (data != nullptr && count > 0) ? 1 : 0;
+    if (!put(&present, 1)) {
+      return false;
+    }
+    return present ? put(data, count * elemSize) : true;
+  }
+
+  template <typename T> bool getArray(T *&data, int count) {
+    data = nullptr;
+    uint8_t present = 0;
+    if (!get(&present, 1)) {
+      return false;
+    }
+    if (!present) {
+      return true;
+    }
+    if (count <= 0) {
+      return false;
+    }
+    data = parseArena.allocArray<T>(count);
+    return data != nullptr && get(data, count * sizeof(T));
+  }
+
+  void reset() {
+    if (_buf != nullptr) {
+      free(_buf);
+    }
+    _buf = nullptr;
+    _len = 0;
+    _cap = 0;
+    _pos = 0;
+  }
+
+  // ------------------------------------------------------------------
+  // Datos dependientes de cada bloque
+  // ------------------------------------------------------------------
+  bool putExtraTZX(const tTZXBlockDescriptor &d) {
+    switch (d.ID) {
+    case 19: // ID 0x13 - Pulse sequence
+      return putArray(d.timming.pulse_seq_array, d.timming.pulse_seq_num_pulses,
+                      sizeof(int));
+
+    case 25: { // ID 0x19 - GDB
+      // La tabla de simbolos va fuera del descriptor
+      if (!putArray(d.symbol, 1, sizeof(tSymbol))) {
+        return false;
+      }
+      if (d.symbol == nullptr) {
+        return true;
+      }
+      const tSymbol &s = *d.symbol;
+      bool ok = putArray(s.pilotStream, s.TOTP, sizeof(tPrle));
+      // Tablas de simbolos: flag + pulsos de cada uno
+      for (int k = 0; ok && k < s.ASP && s.symDefPilot != nullptr; k++) {
+        ok = put(&s.symDefPilot[k].symbolFlag, sizeof(int)) &&
+             putArray(s.symDefPilot[k].pulse_array, s.NPP, sizeof(int));
+      }
+      for (int k = 0; ok && k < s.ASD && s.symDefData != nullptr; k++) {
+        ok = put(&s.symDefData[k].symbolFlag, sizeof(int)) &&
+             putArray(s.symDefData[k].pulse_array, s.NPD, sizeof(int));
+      }
+      return ok;
+    }
+
+    case 38: // ID 0x26 - Call sequence
+      return putArray(d.call_sequence_array, d.call_sequence_count,
+                      sizeof(uint16_t));
+
+    default:
+      return true;
+    }
+  }
+
+  bool getExtraTZX(tTZXBlockDescriptor &d) {
+    switch (d.ID) {
+    case 19:
+      return getArray(d.timming.pulse_seq_array,
+                      d.timming.pulse_seq_num_pulses);
+
+    case 25: {
+      if (!getArray(d.symbol, 1)) {
+        return false;
+      }
+      if (d.symbol == nullptr) {
+        return true;
+      }
+      // Los punteros guardados solo indican que tablas hay detras
+      tSymbol &s = *d.symbol;
+      bool hadPilot = s.symDefPilot != nullptr;
+      bool hadData = s.symDefData != nullptr;
+      clearPointersSymbol(s);
+      if (!getArray(s.pilotStream, s.TOTP)) {
+        return false;
+      }
+      if (hadPilot) {
+        s.symDefPilot = parseArena.allocArray<tSymDef>(s.ASP);
+        if (s.symDefPilot == nullptr) {
+          return false;
+        }
+        for (int k = 0; k < s.ASP; k++) {
+          if (!get(&s.symDefPilot[k].symbolFlag, sizeof(int)) ||
+              !getArray(s.symDefPilot[k].pulse_array, s.NPP)) {
+            return false;
+          }
+        }
+      }
+      if (hadData) {
+        s.symDefData = parseArena.allocArray<tSymDef>(s.ASD);
+        if (s.symDefData == nullptr) {
+          return false;
+        }
+        for (int k = 0; k < s.ASD; k++) {
+          if (!get(&s.symDefData[k].symbolFlag, sizeof(int)) ||
+              !getArray(s.symDefData[k].pulse_array, s.NPD)) {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+
+    case 38:
+      return getArray(d.call_sequence_array, d.call_sequence_count);
+
+    default:
+      return true;
+    }
+  }
+
+  bool putExtraPZX(const tPZXBlockDescriptor &d) {
+    // Los pulsos de PULS se leen del fichero al reproducir
+    if (strcmp(d.tag, "DATA") == 0) {
+      return putArray(d.data_s0_pulses, d.data_p0_count, sizeof(uint16_t)) &&
+             putArray(d.data_s1_pulses, d.data_p1_count, sizeof(uint16_t));
+    }
+    return true;
+  }
+
+  bool getExtraPZX(tPZXBlockDescriptor &d) {
+    if (strcmp(d.tag, "DATA") == 0) {
+      return getArray(d.data_s0_pulses, d.data_p0_count) &&
+             getArray(d.data_s1_pulses, d.data_p1_count);
+    }
+    return true;
+  }
+
+  static void clearPointersTZX(tTZXBlockDescriptor &d) {
+    // Los punteros guardados no valen en esta sesion
+    d.timming.pulse_seq_array = nullptr;
+    d.call_sequence_array = nullptr;
+    d.symbol = nullptr;
+  }
+
+  static void clearPointersSymbol(tSymbol &s) {
+    s.symDefPilot = nullptr;
+    s.symDefData = nullptr;
+    s.pilotStream = nullptr;
+    s.pilotEdges = nullptr;
+    s.pilotEdgeStart = nullptr;
+    s.dataEdges = nullptr;
+    s.dataEdgeStart = nullptr;
+  }
+
+  static void clearPointersPZX(tPZXBlockDescriptor &d) {
+    d.timming.pulse_seq_array = nullptr;
+    d.data_s0_pulses = nullptr;
+    d.data_s1_pulses = nullptr;
+  }
+
+  // ------------------------------------------------------------------
+  // Fichero
+  // ------------------------------------------------------------------
+  bool fillKey(tDscHeader &h, File &tapeFile, uint8_t format) {
+    h.format = format;
+    h.fileSize = tapeFile.size();
+    h.fileTime = (uint32_t)tapeFile.getLastWrite();
+    return h.fileSize > 0;
+  }
+
+  static String dscPathOf(const char *path) {
+    // Mismo directorio que la cinta, pero oculto: /dir/.nombre.tzx.dsc. El
+    // navegador de ficheros no lista los ficheros que empiezan por punto
+    String p = String(path);
+    int slash = p.lastIndexOf('/');
+    return p.substring(0, slash + 1) + "." + p.substring(slash + 1) + ".dsc";
+  }
+
+  bool writeFile(const char *path, tDscHeader &h) {
+    h.payloadSize = _len;
+
+    String dscPath = dscPathOf(path);
+    File dsc = SD_MMC.open(dscPath, FILE_WRITE);
+    if (!dsc) {
+      return false;
+    }
+
+    bool ok = dsc.write((uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+              dsc.write(_buf, _len) == _len;
+    dsc.close();
+
+    if (!ok) {
+      SD_MMC.remove(dscPath);
+    }
+    return ok;
+  }
+
+  bool readFile(const char *path, tDscHeader &h, const tDscHeader &key) {
+    // Cabecera y datos en una sola lectura
+    String dscPath = dscPathOf(path);
+    if (!SD_MMC.exists(dscPath)) {
+      return false;
+    }
+
+    File dsc = SD_MMC.open(dscPath, FILE_READ);
+    if (!dsc) {
+      return false;
+    }
+
+    size_t total = dsc.size();
+    if (total < sizeof(h)) {
+      dsc.close();
+      return false;
+    }
+
+    _buf = (uint8_t *)ps_malloc(total);
+    if (_buf == nullptr) {
+      dsc.close();
+      return false;
+    }
+    _cap = total;
+    _len = dsc.read(_buf, total);
+    _pos = 0;
+    dsc.close();
+
+    if (_len != total || !get(&h, sizeof(h))) {
+      return false;
+    }
+
+    // Validamos formato y clave
+    return h.magic == DSC_MAGIC && h.version == DSC_VERSION &&
+           h.format == key.format && h.descriptorSize == key.descriptorSize &&
+           h.fileSize == key.fileSize && h.fileTime == key.fileTime &&
+           h.payloadSize == total - sizeof(h);
+  }
+
+public:
+  bool saveTZX(const char *path, File &tapeFile, const tTZX &tzx,
+               int totalBlocks, int groupCount, const char *programName) {
+    // Lo llama la tarea del analizador: los datos del fichero llegan como
+    // parametros y no se leen de los globales
+    tDscHeader h;
+    if (tzx.descriptor == nullptr || !fillKey(h, tapeFile, DSC_FORMAT_TZX)) {
+      return false;
+    }
+
+    h.descriptorSize = sizeof(tTZXBlockDescriptor);
+    h.hasGroupBlocks = tzx.hasGroupBlocks;
+    h.numBlocks = tzx.numBlocks;
+    h.totalBlocks = totalBlocks;
+    h.groupCount = groupCount;
+    strncpy(h.programName, programName, sizeof(h.programName) - 1);
+
+    reset();
+    bool ok =
+        put(tzx.descriptor, tzx.numBlocks * sizeof(tTZXBlockDescriptor));
+    for (int n = 0; ok && n < tzx.numBlocks; n++) {
+      ok = putExtraTZX(tzx.descriptor[n]);
+    }
+
+    ok = ok && writeFile(path, h);
+    reset();
+    return ok;
+  }
+
+  bool loadTZX(const char *path, File &tapeFile, tTZX &tzx,
+               int &totalBlocks, int &groupCount) {
+    // Rellena la tabla de descriptores, haciendola crecer si hace falta. El
+    // nombre del programa sale luego de los propios descriptores
+    tDscHeader key;
+    tDscHeader h;
+    key.descriptorSize = sizeof(tTZXBlockDescriptor);
+    if (tzx.descriptor == nullptr || !fillKey(key, tapeFile, DSC_FORMAT_TZX)) {
+      return false;
+    }
+
+    reset();
+    tArenaMark arenaMark = parseArena.mark();
+    bool ok = readFile(path, h, key) && h.numBlocks > 0 &&
+              reserveTZXDescriptors(tzx, h.numBlocks + 1) &&
+              get(tzx.descriptor, h.numBlocks * sizeof(tTZXBlockDescriptor));
+
+    int loaded = 0;
+    for (; ok && loaded < h.numBlocks; loaded++) {
+      tTZXBlockDescriptor &d = tzx.descriptor[loaded];
+      clearPointersTZX(d);
+      ok = getExtraTZX(d);
+    }
+    reset();
+
+    if (!ok) {
+      // Deshacemos lo cargado. Los bloques sin recuperar aun tienen los
+      // punteros del fichero
+      parseArena.rollback(arenaMark);
+      for (int n = 0; n < h.numBlocks && n < tzx.capacity; n++) {
+        clearPointersTZX(tzx.descriptor[n]);
+      }
+      return false;
+    }
+
+    tzx.numBlocks = h.numBlocks;
+    tzx.hasGroupBlocks = h.hasGroupBlocks;
+    totalBlocks = h.totalBlocks;
+    groupCount = h.groupCount;
+    return true;
+  }
+
+  bool savePZX(const char *path, File &tapeFile, const tPZX &pzx,
+               int totalBlocks) {
+    tDscHeader h;
+    if (pzx.descriptor == nullptr || !fillKey(h, tapeFile, DSC_FORMAT_PZX)) {
+      return false;
+    }
+
+    h.descriptorSize = sizeof(tPZXBlockDescriptor);
+    h.numBlocks = pzx.numBlocks;
+    h.totalBlocks = totalBlocks;
+
+    reset();
+    bool ok = put(pzx.descriptor, pzx.numBlocks * sizeof(tPZXBlockDescriptor));
+    for (int n = 0; ok && n < pzx.numBlocks; n++) {
+      ok = putExtraPZX(pzx.descriptor[n]);
+    }
+
+    ok = ok && writeFile(path, h);
+    reset();
+    return ok;
+  }
+
+  bool loadPZX(const char *path, File &tapeFile, tPZX &pzx,
+               int &totalBlocks) {
+    // Reserva la tabla de descriptores (como PZXprocessor::getBlockDescriptor)
+    tDscHeader key;
+    tDscHeader h;
+    key.descriptorSize = sizeof(tPZXBlockDescriptor);
+    if (!fillKey(key, tapeFile, DSC_FORMAT_PZX)) {
+      return false;
+    }
+
+    reset();
+    if (!readFile(path, h, key) || h.numBlocks <= 0) {
+      reset();
+      return false;
+    }
+
+    tArenaMark arenaMark = parseArena.mark();
+    tPZXBlockDescriptor *descriptor = (tPZXBlockDescriptor *)ps_calloc(
+        h.numBlocks, sizeof(tPZXBlockDescriptor));
+    bool ok = descriptor != nullptr &&
+              get(descriptor, h.numBlocks * sizeof(tPZXBlockDescriptor));
+
+    int loaded = 0;
+    for (; ok && loaded < h.numBlocks; loaded++) {
+      clearPointersPZX(descriptor[loaded]);
+      ok = getExtraPZX(descriptor[loaded]);
+    }
+    reset();
+
+    if (!ok) {
+      parseArena.rollback(arenaMark);
+      free(descriptor);
+      return false;
+    }
+
+    pzx.descriptor = descriptor;
+    pzx.numBlocks = h.numBlocks;
+    totalBlocks = h.totalBlocks;
+    return true;
+  }
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+// Representacion intermedia de la señal de cinta.
+//
+// Todos los bloques (TAP, TZX, PZX) se reducen a una lista de semi-pulsos.
+// Cada entrada es un uint32:
+//   bits  0..29  duracion del semi-pulso en T-states
+//   bits 30..31  nivel del semi-pulso (EDGE_TOGGLE, EDGE_KEEP, EDGE_LOW, EDGE_HIGH)
+//
+// EDGE_TOGGLE es el flanco normal: cambia de nivel respecto al semi-pulso
+// anterior (salvo que KEEP_CURRENT_EDGE lo impida). El resto fija el nivel,
+// como hacen los simbolos del ID 0x19 o el nivel inicial de PZX.
+//
+// ZXProcessor::renderEdges() es el unico punto que pasa esta lista a PCM.
+
+#define EDGE_TOGGLE 0
+#define EDGE_KEEP 1
+#define EDGE_LOW 2
+#define EDGE_HIGH 3
+
+#define EDGE_TSTATES_MASK 0x3FFFFFFF
+#define EDGE_MODE_SHIFT 30
+
+#define EDGE_MAKE(tstates, mode)                                              \
+  (((uint32_t)(tstates) & EDGE_TSTATES_MASK) |                                 \
+   ((uint32_t)(mode) << EDGE_MODE_SHIFT))
+#define EDGE_TSTATES(edge) ((edge) & EDGE_TSTATES_MASK)
+#define EDGE_MODE(edge) ((uint8_t)((edge) >> EDGE_MODE_SHIFT))
+
+class EdgeList {
+private:
+  uint32_t *_edges = nullptr;
+  int _count = 0;
+  int _capacity = 0;
+
+public:
+  bool reserve(int capacity) {
+    if (capacity <= _capacity) {
+      return true;
+    }
+
+    uint32_t *edges =
+        (uint32_t *)ps_realloc(_edges, capacity * sizeof(uint32_t));
+    if (edges == nullptr) {
+      return false;
+    }
+
+    _edges = edges;
+    _capacity = capacity;
+    return true;
+  }
+
+  void clear() { _count = 0; }
+
+  int size() const { return _count; }
+
+  const uint32_t *data() const { return _edges; }
+
+  bool push(uint32_t tstates, uint8_t mode = EDGE_TOGGLE) {
+    // Los semi-pulsos de mas de 2^30 T-states (unos 5 minutos) se parten
+    // manteniendo el nivel
+    do {
+      if (_count == _capacity &&
+          !reserve(_capacity == 0 ? EDGE_LIST_CHUNK : _capacity * 2)) {
+        return false;
+      }
+
+      uint32_t t = (tstates > EDGE_TSTATES_MASK) ? EDGE_TSTATES_MASK : tstates;
+      _edges[_count++] = EDGE_MAKE(t, mode);
+      tstates -= t;
+      mode = EDGE_KEEP;
+    } while (tstates > 0);
+
+    return true;
+  }
+
+  bool append(const uint32_t *edges, int count) {
+    // Copia una secuencia ya codificada (plantillas de simbolos ID 0x19)
+    if (_count + count > _capacity) {
+      int capacity = (_capacity == 0) ? EDGE_LIST_CHUNK : _capacity;
+      while (capacity < _count + count) {
+        capacity *= 2;
+      }
+      if (!reserve(capacity)) {
+        return false;
+      }
+    }
+
+    memcpy(_edges + _count, edges, count * sizeof(uint32_t));
+    _count += count;
+    return true;
+  }
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+// Lector con ventana de lectura anticipada en PSRAM.
+//
+// Los analizadores de bloques leen campos de 1 a 4 bytes repartidos por todo
+// el fichero. Con seek + read por campo cada lectura es un acceso a la SD;
+// con la ventana, la SD solo se toca cuando el campo pedido cae fuera de lo
+// ya leído, así que recorrer el fichero de principio a fin es una sola pasada
+// secuencial en trozos de FILE_WINDOW_SIZE.
+
+class FileWindowReader {
+private:
+  File _file;
+  uint8_t *_window = nullptr;
+  size_t _size = 0;
+  uint32_t _start = 0; // Offset del fichero del primer byte de la ventana
+  uint32_t _len = 0;   // Bytes válidos en la ventana
+  uint32_t _reads = 0; // Lecturas a la SD desde begin()
+
+  bool refill(uint32_t offset) {
+    // Cargamos la ventana empezando en el offset pedido
+    _file.seek(offset);
+    _reads++;
+    _start = offset;
+    _len = _file.read(_window, _size);
+    return _len > 0;
+  }
+
+public:
+  bool begin(File &file, size_t size = FILE_WINDOW_SIZE) {
+    end();
+
+    _window = (uint8_t *)ps_malloc(size);
+    if (_window == nullptr) {
+      return false;
+    }
+
+    _file = file;
+    _size = size;
+    _start = 0;
+    _len = 0;
+    _reads = 0;
+    return true;
+  }
+
+  void end() {
+    if (_window != nullptr) {
+      free(_window);
+    }
+    _window = nullptr;
+    _size = 0;
+    _len = 0;
+  }
+
+  bool isOpen() const { return _window != nullptr; }
+
+  uint32_t getReads() const { return _reads; }
+
+  size_t read(uint32_t offset, uint8_t *dst, size_t n) {
+    // Copia n bytes desde offset. Las lecturas más grandes que la ventana
+    // van directas a la SD.
+    if (n >= _size) {
+      _file.seek(offset);
+      _reads++;
+      return _file.read(dst, n);
+    }
+
+    size_t done = 0;
+    while (done < n) {
+      uint32_t pos = offset + done;
+      if (pos < _start || pos >= _start + _len) {
+        if (!refill(pos)) {
+          // Fin de fichero. Lo que falte queda a cero
+          memset(dst + done, 0, n - done);
+          break;
+        }
+      }
+
+      size_t chunk = min((size_t)(_start + _len - pos), n - done);
+      memcpy(dst + done, _window + (pos - _start), chunk);
+      done += chunk;
+    }
+    return done;
+  }
+
+  uint8_t checksum(uint32_t offset, size_t n, uint32_t *ones = nullptr) {
+    // XOR de n bytes desde offset, sobre la propia ventana (sin copiarlos).
+    // Con "ones" se cuentan tambien sus bits a 1 en el mismo recorrido
+    uint8_t chk = 0;
+    size_t done = 0;
+    while (done < n) {
+      uint32_t pos = offset + done;
+      if (pos < _start || pos >= _start + _len) {
+        if (!refill(pos)) {
+          break;
+        }
+      }
+
+      size_t chunk = min((size_t)(_start + _len - pos), n - done);
+      const uint8_t *src = _window + (pos - _start);
+      chk = xorChecksum(src, chunk, chk);
+      if (ones != nullptr) {
+        for (size_t k = 0; k < chunk; k++) {
+          *ones += __builtin_popcount(src[k]);
+        }
+      }
+      done += chunk;
+    }
+    return chk;
+  }
+
+  uint8_t getBYTE(uint32_t offset) {
+    uint8_t b = 0;
+    read(offset, &b, 1);
+    return b;
+  }
+
+  uint16_t getWORD(uint32_t offset) {
+    uint8_t b[2];
+    read(offset, b, 2);
+    return (b[1] << 8) | b[0]; // Little-endian
+  }
+
+  uint32_t getDWORD(uint32_t offset) {
+    uint8_t b[4];
+    read(offset, b, 4);
+    return ((uint32_t)b[3] << 24) | ((uint32_t)b[2] << 16) |
+           ((uint32_t)b[1] << 8) | b[0]; // Little-endian
+  }
+
+  uint32_t getNBYTE(uint32_t offset, int n) {
+    uint8_t b[4] = {0, 0, 0, 0};
+    read(offset, b, min(n, 4));
+
+    uint32_t result = 0;
+    for (int i = 0; i < n && i < 4; i++) {
+      result |= ((uint32_t)b[i] << (8 * i));
+    }
+    return result;
+  }
+};
@@ -590,7 +590,8 @@ private:
                   if (fnameToLower.indexOf(search_pattern) != -1 || search_pattern == "")
                   {
                       bool isDir = isDirectoryPath(entry.c_str()); // entry.isDirectory();
-                      bool isHidden = entry[0] == '.';
+                      // entry trae la ruta completa. Lo oculto se mira en el nombre
+                      bool isHidden = fname[0] == '.';
 
                       //if (ext == nullptr) ext = ""; // Si no hay extensión, asignamos cadena vacía
 
@@ -2712,6 +2713,7 @@ private:
           REC = false;
           ABORT = true;
           EJECT = false;
+          raiseTapeEvent(TAPE_EVENT_PAUSE);
           //updateInformationMainPage();
         }    
         else if (strCmd.indexOf("STOP") != -1) 
@@ -2727,6 +2729,7 @@ private:
           REC = false;
           ABORT = true;
           EJECT = false;
+          raiseTapeEvent(TAPE_EVENT_STOP);
 
           BLOCK_SELECTED = 0;
           BYTES_LOADED = 0;
@@ -2750,6 +2753,7 @@ private:
           REC = false;
           ABORT = false;
           EJECT = true;
+          raiseTapeEvent(TAPE_EVENT_STOP);
 
           // Esto lo hacemos así porque el EJECT lanza un comando en paralelo
           // al control del tape (tapeControl)
@@ -2826,6 +2830,9 @@ private:
 
           kitStream.setVolume(MAIN_VOL / 100);
 
+          // Avisamos al generador de pulsos (LEVEL_FRAME)
+          VOL_CHANGE = true;
+
         }
         // Ajuste del volumen
         else if (strCmd.indexOf("VOL=") != -1) 
@@ -2848,6 +2855,9 @@ private:
           myNex.writeStr("tape.tapeVol.txt",String(int(MAIN_VOL)) + "%");
 
           kitStream.setVolume(MAIN_VOL / 100);
+
+          // Avisamos al generador de pulsos (LEVEL_FRAME)
+          VOL_CHANGE = true;
           
         }
         // Ajuste el vol canal R
@@ -2869,6 +2879,9 @@ private:
 
           saveVolSliders();
 
+          // Avisamos al generador de pulsos (LEVEL_FRAME)
+          VOL_CHANGE = true;
+
         }
         // Ajuste el vol canal L
         else if (strCmd.indexOf("VLL=") != -1) 
@@ -2897,6 +2910,9 @@ private:
 
           saveVolSliders();
 
+          // Avisamos al generador de pulsos (LEVEL_FRAME)
+          VOL_CHANGE = true;
+
         }
         else if (strCmd.indexOf("EQH=") != -1) 
         {
@@ -3065,6 +3081,9 @@ private:
           logln("");
           logln("Polarization =" + String(INVERSETRAIN));
 
+          // Avisamos al generador de pulsos (LEVEL_FRAME)
+          VOL_CHANGE = true;
+
         }
         // Nivel LOW a cero
         else if (strCmd.indexOf("ZER=") != -1) 
@@ -3162,6 +3181,7 @@ private:
           kitStream.setPAPower(ACTIVE_AMP);
           logln("Active amp=" + String(ACTIVE_AMP));
           AMP_CHANGE = true;
+          VOL_CHANGE = true;
         }        
         // Habilita los dos canales
         else if (strCmd.indexOf("STE=") != -1) 
@@ -3205,6 +3225,7 @@ private:
           // Almacenamos en NVS
           saveHMIcfg("SPKopt");
           SPK_CHANGE = true;
+          VOL_CHANGE = true;
           //logln("Speaker enable=" + String(EN_SPEAKER));
         }
         
@@ -3250,7 +3271,7 @@ private:
           writeString("menuAudio.mutAmp.val=1");
           // Habilitamos/Deshabilitamos el amplificador
           kitStream.setPAPower(ACTIVE_AMP);
-;
+          VOL_CHANGE = true;
           //logln("EAR LEFT enable=" + String(SWAP_EAR_CHANNEL));
         }
         // Save polarization in ID 0x2B
@@ -3506,6 +3527,23 @@ private:
             logln("Modo Out to WAV =" + String(OUT_TO_WAV));
           #endif
         }
+        // Convertir las cintas del directorio actual sin audio.
+        // 1 - WAV, 2 - PZX, 3 - TZX (solo TAP)
+        else if (strCmd.indexOf("CNV=") != -1) 
+        {
+          uint8_t buff[8];
+          strCmd.getBytes(buff, 7);
+          int target = (int)buff[4];
+          //
+          if (target >= OFFLINE_WAV && target <= OFFLINE_TZX)
+          {
+            CONVERT_DIR_REQUEST = target;
+          }
+
+          #ifdef DEBUGMODE
+            logln("Convert directory request =" + String(target));
+          #endif
+        }
         // Habilitar play to WAV file file
         else if (strCmd.indexOf("WA8=") != -1) 
         {
@@ -3752,7 +3790,7 @@ private:
           myNex.writeStr("tape.tapeVol.txt",String(int(MAIN_VOL)) + "%");
 
           kitStream.setVolume(MAIN_VOL / 100);
-
+          VOL_CHANGE = true;
         }        
         else if (strCmd.indexOf("VOLDW") != -1) 
         {
@@ -3769,6 +3807,7 @@ private:
 
 
           kitStream.setVolume(MAIN_VOL / 100);
+          VOL_CHANGE = true;
           // logln("");
           // logln("VOL DOWN");
           // logln("");
@@ -4196,6 +4235,23 @@ private:
         myNex.writeStr("debug.dbgBit0.txt",dbgBit0);
         myNex.writeStr("debug.dbgTState.txt",dbgTState);
         myNex.writeStr("debug.dbgRep.txt",dbgRep);      
+
+        // Buffer de salida de audio
+        myNex.writeStr("debug.dbgRingUnd.txt",String(PCM_RING_UNDERRUNS));
+        myNex.writeStr("debug.dbgRingLvl.txt",String(PCM_RING_LEVEL) + "%");
+        // Muestras que sonaron tras el último STOP / PAUSE / REM
+        myNex.writeStr("debug.dbgStopLat.txt",String(STOP_LATENCY_SAMPLES));
+        // Accesos a la SD al abrir el último fichero
+        myNex.writeStr("debug.dbgSdReads.txt",String(SD_READS_LAST_OPEN));
+      }
+
+      String tapeTimeToString(uint64_t tstates)
+      {
+          // T-states a mm:ss
+          uint32_t secs = (uint32_t)(tstates / (uint64_t)DfreqCPU);
+          uint32_t mins = secs / 60;
+          secs = secs % 60;
+          return (mins < 10 ? "0" : "") + String(mins) + ":" + (secs < 10 ? "0" : "") + String(secs);
       }
 
       void updateInformationMainPage(bool FORZE_REFRESH = false) 
@@ -4379,22 +4435,39 @@ private:
                 }            
           }
 
+          // En TZX/CDT/TSX el tiempo se conoce de antemano (duracion de cada
+          // bloque calculada al abrir el fichero). Mientras se reproduce se
+          // muestra el tiempo y la barra total va por tiempo, no por bytes
+          String message = LAST_MESSAGE;
+          int progressTotal = PROGRESS_BAR_TOTAL_VALUE;
+          if (LOADING_STATE == 1 && TAPE_TOTAL_T > 0)
+          {
+            uint64_t elapsed = TAPE_ELAPSED_T + (TAPE_BLOCK_T * PROGRESS_BAR_BLOCK_VALUE) / 100;
+            if (elapsed > TAPE_TOTAL_T)
+            {
+              elapsed = TAPE_TOTAL_T;
+            }
+            message = "Time: " + tapeTimeToString(elapsed) + " / " + tapeTimeToString(TAPE_TOTAL_T) +
+                      "  ETA: " + tapeTimeToString(TAPE_TOTAL_T - elapsed);
+            progressTotal = (int)((elapsed * 100) / TAPE_TOTAL_T);
+          }
+
           // Actualizamos el LAST_MESSAGE
-          if (lastMsn != LAST_MESSAGE || FORZE_REFRESH)
+          if (lastMsn != message || FORZE_REFRESH)
           {
-            writeString("g0.txt=\"" + LAST_MESSAGE + "\"");
+            writeString("g0.txt=\"" + message + "\"");
             // writeXSTR(66,247,342,16,2,65535,0,1,1,50,LAST_MESSAGE);
           }
-          lastMsn = LAST_MESSAGE;
+          lastMsn = message;
           
           // Actualizamos la barra de progreso
           if (lastPr1 != PROGRESS_BAR_BLOCK_VALUE || FORZE_REFRESH)
           {writeString("progressBlock.val=" + String(PROGRESS_BAR_BLOCK_VALUE));}
           lastPr1 = PROGRESS_BAR_BLOCK_VALUE;
 
-          if (lastPr2 != PROGRESS_BAR_TOTAL_VALUE || FORZE_REFRESH)
-          {writeString("progressTotal.val=" + String(PROGRESS_BAR_TOTAL_VALUE));}
-          lastPr2 = PROGRESS_BAR_TOTAL_VALUE;
+          if (lastPr2 != progressTotal || FORZE_REFRESH)
+          {writeString("progressTotal.val=" + String(progressTotal));}
+          lastPr2 = progressTotal;
 
                             
           if (CURRENT_PAGE == 2)
@@ -4790,6 +4863,23 @@ private:
           }
       }
       
+      String blockTypeWithChk(const char* typeName, uint8_t chkStatus)
+      {
+        // Tipo de bloque seguido del resultado del checksum, si lo tiene.
+        // Se calcula al analizar el fichero, aqui no se lee nada de la SD
+        String label = String(typeName);
+        label.trim();
+        if (chkStatus == BLOCK_CHK_OK)
+        {
+          label += " OK";
+        }
+        else if (chkStatus == BLOCK_CHK_BAD)
+        {
+          label += " BAD";
+        }
+        return label;
+      }
+
       void openBlocksBrowser(const tTZX& myTZX, const tTAP& myTAP, const tPZX& myPZX)
       {
         // Rellenamos el browser con todos los bloques
@@ -4852,7 +4942,7 @@ private:
             {
                 // ... (lógica TZX usando real_idx)
                 // Colores, etc.
-                myNex.writeStr("blocks.data" + String(i) + ".txt",myTZX.descriptor[real_idx + 1].typeName);
+                myNex.writeStr("blocks.data" + String(i) + ".txt",blockTypeWithChk(myTZX.descriptor[real_idx + 1].typeName,myTZX.descriptor[real_idx + 1].chkStatus));
                 delay(pa);
                 myNex.writeStr("blocks.name" + String(i) + ".txt",myTZX.descriptor[real_idx + 1].name);
                 delay(pa);
@@ -4875,7 +4965,8 @@ private:
             else // TAP
             {
               // ✅ LÓGICA TAP CORREGIDA USANDO real_idx
-              myNex.writeStr("blocks.data" + String(i) + ".txt",myTAP.descriptor[real_idx].typeName);
+              // En un TAP todos los bloques llevan checksum
+              myNex.writeStr("blocks.data" + String(i) + ".txt",blockTypeWithChk(myTAP.descriptor[real_idx].typeName,myTAP.descriptor[real_idx].corrupted ? BLOCK_CHK_BAD : BLOCK_CHK_OK));
               delay(pa);  
               myNex.writeStr("blocks.name" + String(i) + ".txt",myTAP.descriptor[real_idx].name);
               delay(pa);
@@ -0,0 +1,435 @@
+#pragma once
+
+// Conversion de cintas sin pasar por el audio.
+//
+// Con OFFLINE_RENDER activo los procesadores reproducen la cinta igual que
+// siempre, pero la salida no va a kitStream ni al PCM ring:
+//   OFFLINE_WAV  el PCM de ZXProcessor::writeOutput va a un WAV en la SD.
+//   OFFLINE_PZX  los semi-pulsos de ZXProcessor::renderEdges se guardan
+//                como bloques PULS de un PZX. No se genera PCM.
+// Sin el I2S marcando el ritmo, la cinta sale tan rapido como dan la CPU y
+// la SD.
+//
+// OFFLINE_TZX no pasa por los pulsos: los bloques de un TAP se copian como
+// bloques 0x10 (convertTAPtoTZX).
+
+class SDBufferedWriter {
+  // Escritura secuencial en la SD en trozos de OFFLINE_WRITE_BUFFER_SIZE
+private:
+  File _file;
+  uint8_t *_buf = nullptr;
+  size_t _fill = 0;
+  uint32_t _written = 0; // Bytes escritos desde begin()
+  bool _failed = false;
+
+public:
+  bool begin(const char *path) {
+    end();
+
+    _buf = (uint8_t *)ps_malloc(OFFLINE_WRITE_BUFFER_SIZE);
+    if (_buf == nullptr) {
+      return false;
+    }
+
+    _file = SD_MMC.open(path, FILE_WRITE);
+    if (!_file) {
+      free(_buf);
+      _buf = nullptr;
+      return false;
+    }
+
+    _fill = 0;
+    _written = 0;
+    _failed = false;
+    return true;
+  }
+
+  bool isOpen() const { return _buf != nullptr; }
+
+  bool failed() const { return _failed; }
+
+  uint32_t size() const { return _written; }
+
+  void flush() {
+    if (_fill > 0 && _file.write(_buf, _fill) != _fill) {
+      _failed = true;
+    }
+    _fill = 0;
+  }
+
+  void write(const uint8_t *data, size_t n) {
+    _written += n;
+    while (n > 0) {
+      size_t room = OFFLINE_WRITE_BUFFER_SIZE - _fill;
+      size_t k = (n < room) ? n : room;
+      memcpy(_buf + _fill, data, k);
+      _fill += k;
+      data += k;
+      n -= k;
+
+      if (_fill == OFFLINE_WRITE_BUFFER_SIZE) {
+        flush();
+      }
+    }
+  }
+
+  void put16(uint16_t v) {
+    uint8_t b[2] = {(uint8_t)v, (uint8_t)(v >> 8)};
+    write(b, 2);
+  }
+
+  void put32(uint32_t v) {
+    uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16),
+                    (uint8_t)(v >> 24)};
+    write(b, 4);
+  }
+
+  void patch32(uint32_t offset, uint32_t v) {
+    // Rellena un campo de la cabecera cuando ya se conoce su valor
+    flush();
+    uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16),
+                    (uint8_t)(v >> 24)};
+    _file.seek(offset);
+    if (_file.write(b, 4) != 4) {
+      _failed = true;
+    }
+  }
+
+  bool end() {
+    if (_buf == nullptr) {
+      return false;
+    }
+    flush();
+    _file.close();
+    free(_buf);
+    _buf = nullptr;
+    return !_failed;
+  }
+};
+
+class WAVTapeWriter {
+  // WAV PCM de 16 bits. Los tamaños se rellenan al cerrar
+private:
+  SDBufferedWriter _out;
+  static const uint32_t HEADER_SIZE = 44;
+
+public:
+  bool begin(const char *path, uint32_t sampleRate, uint16_t channels) {
+    if (!_out.begin(path)) {
+      return false;
+    }
+
+    _out.write((const uint8_t *)"RIFF", 4);
+    _out.put32(0);
+    _out.write((const uint8_t *)"WAVEfmt ", 8);
+    _out.put32(16);
+    _out.put16(1); // PCM
+    _out.put16(channels);
+    _out.put32(sampleRate);
+    _out.put32(sampleRate * channels * 2);
+    _out.put16(channels * 2);
+    _out.put16(16);
+    _out.write((const uint8_t *)"data", 4);
+    _out.put32(0);
+    return true;
+  }
+
+  bool isOpen() const { return _out.isOpen(); }
+
+  void write(const uint8_t *pcm, size_t bytes) { _out.write(pcm, bytes); }
+
+  bool end() {
+    if (!_out.isOpen()) {
+      return false;
+    }
+    uint32_t data = _out.size() - HEADER_SIZE;
+    _out.patch32(4, data + HEADER_SIZE - 8);
+    _out.patch32(HEADER_SIZE - 4, data);
+    return _out.end();
+  }
+};
+
+class PZXTapeWriter {
+  // Semi-pulsos (T-states y nivel) a bloques PULS.
+  //
+  // Los semi-pulsos seguidos del mismo nivel se juntan en uno y las
+  // duraciones repetidas se guardan con contador. Cada bloque PULS empieza
+  // en nivel bajo: si toca empezar en alto se mete un pulso de duración 0.
+private:
+  SDBufferedWriter _out;
+  uint8_t *_puls = nullptr; // Cuerpo del bloque PULS en curso
+  size_t _fill = 0;
+  uint8_t _blockLevel = 0; // Nivel del siguiente pulso escrito en el bloque
+
+  // Pulso pendiente, aun puede crecer
+  bool _started = false;
+  uint8_t _level = 0;
+  uint32_t _pending = 0;
+
+  // Grupo de pulsos iguales pendiente de escribir
+  uint32_t _rleDuration = 0;
+  uint16_t _rleCount = 0;
+  uint8_t _rleLevel = 0;
+  uint8_t _nextLevel = 0; // Nivel del pulso que sigue al grupo
+
+  // Paso a T-states de 3.5MHz (los del PZX)
+  uint32_t _cpu = PZX_CPU_FREQ;
+  uint64_t _scaleRest = 0;
+
+  static const uint32_t MAX_PULSE = 0x7FFFFFFF;
+
+  void putWord(uint16_t v) {
+    _puls[_fill++] = (uint8_t)v;
+    _puls[_fill++] = (uint8_t)(v >> 8);
+  }
+
+  void flushBlock() {
+    if (_fill == 0) {
+      return;
+    }
+    _out.write((const uint8_t *)"PULS", 4);
+    _out.put32(_fill);
+    _out.write(_puls, _fill);
+    _fill = 0;
+    _blockLevel = 0;
+  }
+
+  void flushGroup() {
+    if (_rleCount == 0) {
+      return;
+    }
+
+    // Cero, contador y duración larga: 8 bytes como mucho
+    if (_fill + 8 > OFFLINE_PZX_PULS_CHUNK) {
+      flushBlock();
+    }
+    if (_rleLevel != _blockLevel) {
+      putWord(0);
+      _blockLevel ^= 1;
+    }
+    // Una duración larga empieza con una palabra > 0x8000, que se leería
+    // como contador: en ese caso el contador (1) va siempre
+    if (_rleCount > 1 || _rleDuration > 0xFFFF) {
+      putWord(0x8000 | _rleCount);
+    }
+    if (_rleDuration > 0x7FFF) {
+      putWord(0x8000 | (uint16_t)(_rleDuration >> 16));
+      putWord((uint16_t)_rleDuration);
+    } else {
+      putWord((uint16_t)_rleDuration);
+    }
+    _blockLevel ^= (_rleCount & 1);
+    _rleCount = 0;
+  }
+
+  void writePulse(uint32_t duration, uint8_t level) {
+    if (level != _nextLevel) {
+      // Dos pulsos seguidos del mismo nivel: uno de 0 entre medias
+      writePulse(0, _nextLevel);
+    }
+
+    if (_rleCount > 0 && duration == _rleDuration && _rleCount < 0x7FFF) {
+      _rleCount++;
+    } else {
+      flushGroup();
+      _rleDuration = duration;
+      _rleCount = 1;
+      _rleLevel = level;
+    }
+    _nextLevel = level ^ 1;
+  }
+
+  uint32_t scale(uint32_t tstates) {
+    if (_cpu == PZX_CPU_FREQ) {
+      return tstates;
+    }
+    // El resto se arrastra para no acumular deriva
+    uint64_t acc = (uint64_t)tstates * PZX_CPU_FREQ + _scaleRest;
+    uint32_t t = (uint32_t)(acc / _cpu);
+    _scaleRest = acc - (uint64_t)t * _cpu;
+    return t;
+  }
+
+public:
+  bool begin(const char *path, const String &title, uint32_t cpuFreq) {
+    _puls = (uint8_t *)ps_malloc(OFFLINE_PZX_PULS_CHUNK);
+    if (_puls == nullptr) {
+      return false;
+    }
+    if (!_out.begin(path)) {
+      free(_puls);
+      _puls = nullptr;
+      return false;
+    }
+
+    _fill = 0;
+    _blockLevel = 0;
+    _started = false;
+    _pending = 0;
+    _rleCount = 0;
+    _nextLevel = 0;
+    _cpu = (cpuFreq > 0) ? cpuFreq : PZX_CPU_FREQ;
+    _scaleRest = 0;
+
+    // Cabecera PZXT 1.0 con el titulo
+    _out.write((const uint8_t *)"PZXT", 4);
+    _out.put32(2 + title.length() + 1);
+    uint8_t version[2] = {1, 0};
+    _out.write(version, 2);
+    _out.write((const uint8_t *)title.c_str(), title.length() + 1);
+    return true;
+  }
+
+  bool isOpen() const { return _out.isOpen(); }
+
+  void pulse(uint32_t tstates, uint8_t level) {
+    tstates = scale(tstates);
+
+    if (!_started) {
+      _started = true;
+      _level = level;
+      _pending = tstates;
+      return;
+    }
+
+    if (level == _level && _pending <= MAX_PULSE - tstates) {
+      _pending += tstates;
+      return;
+    }
+
+    writePulse(_pending, _level);
+    _level = level;
+    _pending = tstates;
+  }
+
+  bool end() {
+    if (!_out.isOpen()) {
+      return false;
+    }
+    if (_started) {
+      writePulse(_pending, _level);
+    }
+    flushGroup();
+    flushBlock();
+
+    free(_puls);
+    _puls = nullptr;
+    return _out.end();
+  }
+};
+
+class TZXTapeWriter {
+  // TZX 1.20 con bloques de velocidad normal (0x10)
+private:
+  SDBufferedWriter _out;
+
+public:
+  bool begin(const char *path) {
+    if (!_out.begin(path)) {
+      return false;
+    }
+    _out.write((const uint8_t *)"ZXTape!\x1A", 8);
+    uint8_t version[2] = {1, 20};
+    _out.write(version, 2);
+    return true;
+  }
+
+  void beginStandardBlock(uint16_t pauseMs, uint16_t length) {
+    // Los datos del bloque se pasan despues con write()
+    uint8_t id = 0x10;
+    _out.write(&id, 1);
+    _out.put16(pauseMs);
+    _out.put16(length);
+  }
+
+  void write(const uint8_t *data, size_t n) { _out.write(data, n); }
+
+  bool end() { return _out.end(); }
+};
+
+class OfflineRender {
+private:
+  WAVTapeWriter _wav;
+  PZXTapeWriter _pzx;
+
+public:
+  bool beginWAV(const char *path, uint32_t sampleRate) {
+    return _wav.begin(path, sampleRate, 2);
+  }
+
+  bool beginPZX(const char *path, const String &title, uint32_t cpuFreq) {
+    return _pzx.begin(path, title, cpuFreq);
+  }
+
+  void writePCM(const uint8_t *pcm, size_t bytes) {
+    if (_wav.isOpen()) {
+      _wav.write(pcm, bytes);
+    }
+  }
+
+  void pulse(uint32_t tstates, uint8_t level) {
+    if (_pzx.isOpen()) {
+      _pzx.pulse(tstates, level);
+    }
+  }
+
+  bool end() {
+    // Cierra el que este abierto
+    bool ok = true;
+    if (_wav.isOpen()) {
+      ok = _wav.end();
+    }
+    if (_pzx.isOpen()) {
+      ok = _pzx.end() && ok;
+    }
+    return ok;
+  }
+};
+
+bool convertTAPtoTZX(const char *src, const char *dst) {
+  // Cada bloque del TAP (longitud + datos) pasa a un bloque 0x10 con la pausa
+  // que se usa al reproducir el TAP
+  File tap = SD_MMC.open(src, FILE_READ);
+  if (!tap) {
+    return false;
+  }
+
+  FileWindowReader reader;
+  TZXTapeWriter tzx;
+  if (!reader.begin(tap) || !tzx.begin(dst)) {
+    reader.end();
+    tap.close();
+    return false;
+  }
+
+  uint32_t size = tap.size();
+  uint32_t pos = 0;
+  int blocks = 0;
+  uint8_t chunk[512];
+
+  while (pos + 2 <= size) {
+    uint16_t len = reader.getWORD(pos);
+    pos += 2;
+    if (len == 0 || pos + len > size) {
+      logln("TAP to TZX: truncated block at offset " + String(pos - 2));
+      break;
+    }
+
+    tzx.beginStandardBlock(DSILENT, len);
+    for (uint32_t done = 0; done < len;) {
+      size_t n = min((uint32_t)sizeof(chunk), len - done);
+      reader.read(pos + done, chunk, n);
+      tzx.write(chunk, n);
+      done += n;
+    }
+    pos += len;
+    blocks++;
+  }
+
+  reader.end();
+  tap.close();
+
+  bool ok = tzx.end();
+  logln("TAP to TZX: " + String(blocks) + " blocks");
+  return ok && blocks > 0;
+}
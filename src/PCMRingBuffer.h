@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+
+// Buffer circular PCM de un productor (ZXProcessor) y un consumidor
+// (tarea de salida de audio). Sin bloqueos: cada lado solo modifica
+// su propio indice. Los indices crecen de forma continua y se reducen
+// con una mascara al acceder a la memoria, por eso el tamaño se ajusta
+// a potencia de 2.
+class PCMRingBuffer {
+private:
+    uint8_t* buffer = nullptr;
+    size_t bufferSize = 0;
+    size_t mask = 0;
+
+    std::atomic<uint32_t> head{0};      // Escrito por el productor
+    std::atomic<uint32_t> tail{0};      // Escrito por el consumidor
+    std::atomic<bool> discardRqt{false};
+    std::atomic<bool> consumerBusy{false};
+
+public:
+    bool begin(size_t size) {
+        // Ajustamos a la potencia de 2 inferior
+        while (size & (size - 1)) {
+            size &= size - 1;
+        }
+
+        buffer = (uint8_t*)ps_malloc(size);
+        bufferSize = (buffer != nullptr) ? size : 0;
+        mask = (bufferSize > 0) ? bufferSize - 1 : 0;
+        head.store(0);
+        tail.store(0);
+        return buffer != nullptr;
+    }
+
+    void end() {
+        // Sin consumidor el buffer no sirve: se libera y se sale directo
+        free(buffer);
+        buffer = nullptr;
+        bufferSize = 0;
+        mask = 0;
+    }
+
+    bool isReady() const {
+        return buffer != nullptr;
+    }
+
+    size_t getAvailable() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    size_t getFreeSpace() const {
+        return bufferSize - getAvailable();
+    }
+
+    size_t getSize() const {
+        return bufferSize;
+    }
+
+    // ------------------------------------------------------------------
+    // Productor
+    // ------------------------------------------------------------------
+    void write(const uint8_t* data, size_t len) {
+        // Escritura bloqueante. Si no hay sitio esperamos a que el
+        // consumidor libere espacio.
+        while (len > 0) {
+            size_t freeSpace = getFreeSpace();
+            if (freeSpace == 0) {
+                vTaskDelay(1);
+                continue;
+            }
+
+            size_t toWrite = min(len, freeSpace);
+            uint32_t h = head.load(std::memory_order_relaxed);
+            size_t pos = h & mask;
+            size_t first = min(toWrite, bufferSize - pos);
+
+            memcpy(buffer + pos, data, first);
+            if (toWrite > first) {
+                memcpy(buffer, data + first, toWrite - first);
+            }
+
+            head.store(h + toWrite, std::memory_order_release);
+            data += toWrite;
+            len -= toWrite;
+        }
+    }
+
+    void discard() {
+        // Pide al consumidor que descarte lo pendiente (STOP / PAUSE)
+        discardRqt.store(true, std::memory_order_release);
+    }
+
+    void drain() {
+        // Espera a que el consumidor haya volcado todo en el stream.
+        // Necesario antes de cambiar el sampling rate del codec.
+        while (getAvailable() > 0 || consumerBusy.load(std::memory_order_acquire)) {
+            vTaskDelay(1);
+        }
+    }
+
+    // ------------------------------------------------------------------
+    // Consumidor
+    // ------------------------------------------------------------------
+    size_t peek(uint8_t* &ptr, size_t maxLen) {
+        // Devuelve un tramo contiguo listo para leer, sin copiarlo
+        if (discardRqt.load(std::memory_order_acquire)) {
+            tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+            discardRqt.store(false, std::memory_order_release);
+        }
+
+        size_t avail = getAvailable();
+        if (avail == 0) {
+            return 0;
+        }
+
+        consumerBusy.store(true, std::memory_order_release);
+
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        size_t pos = t & mask;
+        size_t len = min(min(avail, maxLen), bufferSize - pos);
+
+        ptr = buffer + pos;
+        return len;
+    }
+
+    void skipPending() {
+        // Descarta en el acto lo pendiente, sin esperar al siguiente peek
+        discardRqt.store(false, std::memory_order_release);
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    void consume(size_t len) {
+        tail.store(tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+        consumerBusy.store(false, std::memory_order_release);
+    }
+};
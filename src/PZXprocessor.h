@@ -41,6 +41,7 @@
 class PZXprocessor {
 private:
   tPZX _myPZX;
+  int _capacity = 0; // Descriptores reservados en _myPZX.descriptor
   File _mFile;
   int _sizePZX;
   int _rlen;
@@ -49,8 +50,140 @@ private:
   ZXProcessor _zxp;
   HMI _hmi;
 
+  // Los bloques PULS / DATA / CSW se reducen a la lista de flancos
+  EdgeList _edges;
+
+  // Lectura anticipada. Al abrir recorre las cabeceras de los bloques y al
+  // reproducir los pulsos de PULS y los bytes de DATA
+  FileWindowReader _reader;
+
+#ifdef DEBUGMODE
+  // Tiempo pasado en renderEdges (salida PCM, marcada por el audio)
+  unsigned long _renderMicros = 0;
+#endif
+
+  void renderEdges() {
+#ifdef DEBUGMODE
+    unsigned long t0 = micros();
+#endif
+    _zxp.renderEdges(_edges.data(), _edges.size());
+    _edges.clear();
+#ifdef DEBUGMODE
+    _renderMicros += micros() - t0;
+#endif
+  }
+
+  void renderEdgesIfFull() {
+    if (_edges.size() >= EDGE_LIST_CHUNK) {
+      renderEdges();
+    }
+  }
+
+  bool pushEdge(uint32_t tstates, uint8_t mode = EDGE_TOGGLE) {
+    // Sin memoria para la lista de flancos el bloque no puede seguir
+    if (!_edges.push(tstates, mode)) {
+      logln("Error: no memory for edge list");
+      return false;
+    }
+    return true;
+  }
+
+  bool appendEdges(const uint32_t *edges, int count) {
+    if (!_edges.append(edges, count)) {
+      logln("Error: no memory for edge list");
+      return false;
+    }
+    return true;
+  }
+
+  // Plantillas de los bloques DATA. Para cada valor de byte se guardan los
+  // semi-pulsos de sus 8 bits ya codificados (EDGE_TOGGLE), uno detrás de
+  // otro: _byteStart[b] .. _byteStart[b + 1]. Un byte completo se añade a la
+  // lista de flancos con un solo append. Se reutiliza mientras los símbolos
+  // no cambien, que es lo normal entre bloques DATA de una misma cinta.
+  uint32_t *_byteEdges = nullptr;
+  int _byteEdgesCapacity = 0;
+  uint32_t _byteStart[257];
+  const tPZXBlockDescriptor *_byteTableOf = nullptr;
+
+  static bool sameSymbols(const tPZXBlockDescriptor &a,
+                          const tPZXBlockDescriptor &b) {
+    return a.data_p0_count == b.data_p0_count &&
+           a.data_p1_count == b.data_p1_count &&
+           memcmp(a.data_s0_pulses, b.data_s0_pulses,
+                  a.data_p0_count * sizeof(uint16_t)) == 0 &&
+           memcmp(a.data_s1_pulses, b.data_s1_pulses,
+                  a.data_p1_count * sizeof(uint16_t)) == 0;
+  }
+
+  bool buildByteTable(const tPZXBlockDescriptor &d) {
+    // Cada byte tiene 8 bits y cada valor de bit aparece 1024 veces en la
+    // tabla: 1024 * (p0 + p1) semi-pulsos en total
+    if (d.data_p0_count + d.data_p1_count > PZX_BYTE_TABLE_MAX_PULSES ||
+        d.data_bit_count < PZX_BYTE_TABLE_MIN_BITS) {
+      return false;
+    }
+    if (_byteTableOf != nullptr && sameSymbols(*_byteTableOf, d)) {
+      _byteTableOf = &d;
+      return true;
+    }
+
+    int total = 1024 * (d.data_p0_count + d.data_p1_count);
+    if (total > _byteEdgesCapacity) {
+      uint32_t *edges =
+          (uint32_t *)ps_realloc(_byteEdges, total * sizeof(uint32_t));
+      if (edges == nullptr) {
+        _byteTableOf = nullptr;
+        return false;
+      }
+      _byteEdges = edges;
+      _byteEdgesCapacity = total;
+    }
+
+    int n = 0;
+    for (int b = 0; b < 256; b++) {
+      _byteStart[b] = n;
+      for (int bit = 7; bit >= 0; bit--) {
+        const uint16_t *s = ((b >> bit) & 1) ? d.data_s1_pulses
+                                             : d.data_s0_pulses;
+        int count = ((b >> bit) & 1) ? d.data_p1_count : d.data_p0_count;
+        for (int p = 0; p < count; p++) {
+          _byteEdges[n++] = EDGE_MAKE(s[p], EDGE_TOGGLE);
+        }
+      }
+    }
+    _byteStart[256] = n;
+    _byteTableOf = &d;
+    return true;
+  }
+
+  void freeByteTable() {
+    free(_byteEdges);
+    _byteEdges = nullptr;
+    _byteEdgesCapacity = 0;
+    _byteTableOf = nullptr;
+  }
+
+  bool pushDataBit(const tPZXBlockDescriptor &d, uint8_t bit, uint8_t &mode) {
+    // Un bit suelto: el primero del bloque (nivel inicial) o los del final
+    const uint16_t *s = bit ? d.data_s1_pulses : d.data_s0_pulses;
+    int count = bit ? d.data_p1_count : d.data_p0_count;
+    for (int p = 0; p < count; p++) {
+      if (!pushEdge(s[p], mode)) {
+        return false;
+      }
+      mode = EDGE_TOGGLE;
+    }
+    return true;
+  }
+
   // --- Funciones de ayuda para leer datos Little-Endian ---
+  // Con la ventana abierta se leen de ella; si no, seek + read
   int getWORD(File mFile, int offset) {
+    if (_reader.isOpen()) {
+      return _reader.getWORD(offset);
+    }
+
     uint8_t buffer[2];
 
     mFile.seek(offset);
@@ -59,8 +192,11 @@ private:
     return (buffer[1] << 8) | buffer[0]; // Little-endian
   }
 
-  // ✅ VERSIÓN OPTIMIZADA - CON BUFFER ESTÁTICO
   int getBYTE(File mFile, int offset) {
+    if (_reader.isOpen()) {
+      return _reader.getBYTE(offset);
+    }
+
     uint8_t buffer[1];
 
     mFile.seek(offset);
@@ -69,31 +205,39 @@ private:
     return buffer[0];
   }
 
-  // ✅ VERSIÓN OPTIMIZADA DE getNBYTE
-  int getNBYTE(File mFile, int offset, int n) {
+  uint32_t getNBYTE(File mFile, int offset, int n) {
     if (n > 4)
-      return 0; // Máximo 4 bytes para un int
+      return 0; // Máximo 4 bytes
+
+    if (_reader.isOpen()) {
+      return _reader.getNBYTE(offset, n);
+    }
 
     uint8_t buffer[4];
 
     mFile.seek(offset);
     mFile.read(buffer, n);
 
-    int result = 0;
+    uint32_t result = 0;
     for (int i = 0; i < n; i++) {
-      result |= (buffer[i] << (8 * i));
+      result |= ((uint32_t)buffer[i] << (8 * i));
     }
 
     return result;
   }
 
-  char *readTag(File &mFile, int offset) {
-    static char tag[5] = {0};
+  void getBlock(File &mFile, uint8_t *dst, int offset, int n) {
+    if (_reader.isOpen()) {
+      _reader.read(offset, dst, n);
+    } else {
+      mFile.seek(offset);
+      mFile.read(dst, n);
+    }
+  }
 
-    mFile.seek(offset);
-    mFile.read((uint8_t *)tag, 4);
+  void readTag(File &mFile, int offset, char (&tag)[5]) {
+    getBlock(mFile, (uint8_t *)tag, offset, 4);
     tag[4] = '\0';
-    return tag;
   }
 
   // --- Analizadores para cada tipo de bloque PZX ---
@@ -124,77 +268,15 @@ private:
           " TStates");
   }
 
-  void analyzePULS0(File &mFile, tPZXBlockDescriptor &descriptor) {
-    strncpy(descriptor.typeName, "PZX Pulse Sequence", 35);
-    descriptor.playeable = true;
-    descriptor.initial_level = 0; // Por defecto es LOW
-
-    // 1. Contar cuántos pulsos hay para reservar memoria
-    int pulse_count = 0;
-    int current_pos = descriptor.offset + 8;
-    while (current_pos < (descriptor.offset + 8 + descriptor.size)) {
-      pulse_count++;
-      uint16_t val1 = getNBYTE(mFile, current_pos, 2);
-      current_pos += 2;
-      if (val1 >= 0x8000) { // Tiene repeat count
-        uint16_t val2 = getNBYTE(mFile, current_pos, 2);
-        current_pos += 2;
-        if (val2 >= 0x8000) { // Duración de 32 bits
-          current_pos += 2;
-        }
-      } else { // No tiene repeat, puede tener duración de 32 bits
-        if (val1 >= 0x8000) { // Duración de 32 bits
-          current_pos += 2;
-        }
-      }
-    }
-
-    if (pulse_count == 0)
-      return;
-
-    descriptor.timming.pzx_num_pulses = pulse_count;
-    descriptor.timming.pzx_pulse_data =
-        (tRlePulse *)ps_calloc(pulse_count, sizeof(tRlePulse));
-    if (!descriptor.timming.pzx_pulse_data)
-      return;
-
-    // 2. Llenar la estructura de pulsos
-    current_pos = descriptor.offset + 8;
-    for (int i = 0; i < pulse_count; ++i) {
-      uint32_t duration;
-      uint16_t count = 1;
-
-      uint16_t val1 = getNBYTE(mFile, current_pos, 2);
-      current_pos += 2;
-
-      if (val1 >= 0x8000) {
-        count = val1 & 0x7FFF;
-        duration = getNBYTE(mFile, current_pos, 2);
-        current_pos += 2;
-      } else {
-        duration = val1;
-      }
-
-      if (duration >= 0x8000) {
-        duration &= 0x7FFF;
-        duration <<= 16;
-        duration |= getNBYTE(mFile, current_pos, 2);
-        current_pos += 2;
-      }
-
-      descriptor.timming.pzx_pulse_data[i].pulse_len = duration;
-      descriptor.timming.pzx_pulse_data[i].repeat = count;
-    }
-  }
-
   void analyzePULS(File &mFile, tPZXBlockDescriptor &descriptor) {
+    // Los pulsos no se leen al abrir: se decodifican del fichero al
+    // reproducir (ver nextPulsEntry). La memoria no depende del bloque
     strncpy(descriptor.typeName, "PZX Pulse Sequence", 35);
-    descriptor.playeable = true;
+    descriptor.playeable = descriptor.size >= 2;
     descriptor.initial_level = 0;
+  }
 
-    int block_start = descriptor.offset + 8;
-    int block_end = block_start + descriptor.size;
-
+  bool nextPulsEntry(int &pos, int block_end, tRlePulse &entry) {
     // =============================================
     // Formato PULS (corregido basado en análisis de archivos CSW->PZX):
     //
@@ -207,137 +289,51 @@ private:
     // - Si bit15=0: duración directa de 15 bits
     // - Si bit15=1: duración 31-bit = ((word & 0x7FFF) << 16) | siguiente_word
     // =============================================
-
-    // PASO 1: Contar entradas
-    int pulse_count = 0;
-    int pos = block_start;
-
-    while (pos < block_end - 1) {
-      uint16_t val = getNBYTE(mFile, pos, 2);
-      pos += 2;
-
-      if ((val & 0x8000) == 0) {
-        // bit15=0: duración directa, count=1
-        pulse_count++;
-      } else {
-        // bit15=1
-        uint16_t repeat = val & 0x7FFF;
-
-        if (repeat == 0) {
-          // 0x8000: repeat=1, duración 16-bit completa sigue
-          pulse_count++;
-          pos += 2; // Skip duration word
-        } else {
-          // repeat > 0: repeat count, duración sigue
-          pulse_count++;
-          if (pos >= block_end)
-            break;
-          uint16_t dur_word = getNBYTE(mFile, pos, 2);
-          pos += 2;
-
-          if (dur_word & 0x8000) {
-            pos += 2; // Skip extra 16 bits for 31-bit duration
-          }
-        }
-      }
+    if (pos >= block_end - 1) {
+      return false;
     }
 
-    if (pulse_count == 0) {
-      logln("PULS: No pulses found");
-      return;
-    }
-
-    logln("PULS: Found " + String(pulse_count) + " pulse entries");
+    uint16_t val = _reader.getWORD(pos);
+    pos += 2;
 
-    // PASO 2: Reservar memoria
-    descriptor.timming.pzx_num_pulses = pulse_count;
-    descriptor.timming.pzx_pulse_data =
-        (tRlePulse *)ps_calloc(pulse_count, sizeof(tRlePulse));
-
-    if (!descriptor.timming.pzx_pulse_data) {
-      logln("ERROR: Failed to allocate PULS memory");
-      descriptor.timming.pzx_num_pulses = 0;
-      return;
+    if ((val & 0x8000) == 0) {
+      // bit15=0: duración directa de 15 bits, repeat=1
+      entry.pulse_len = val;
+      entry.repeat = 1;
+      return true;
     }
 
-    // PASO 3: Llenar la estructura de pulsos
-    pos = block_start;
-    int idx = 0;
+    uint16_t repeat_raw = val & 0x7FFF;
+    if (pos >= block_end) {
+      return false;
+    }
 
-    while (pos < block_end - 1 && idx < pulse_count) {
-      uint16_t val = getNBYTE(mFile, pos, 2);
+    if (repeat_raw == 0) {
+      // 0x8000: repeat=1, duración 16-bit completa en siguiente word
+      entry.repeat = 1;
+      entry.pulse_len = _reader.getWORD(pos);
       pos += 2;
-
-      uint32_t duration = 0;
-      uint16_t repeat = 1;
-
-      if ((val & 0x8000) == 0) {
-        // bit15=0: duración directa de 15 bits, repeat=1
-        duration = val;
-        repeat = 1;
-      } else {
-        // bit15=1
-        uint16_t repeat_raw = val & 0x7FFF;
-
-        if (repeat_raw == 0) {
-          // 0x8000: repeat=1, duración 16-bit completa en siguiente word
-          repeat = 1;
-          if (pos >= block_end)
-            break;
-          duration = getNBYTE(mFile, pos, 2); // Duración completa 16-bit
-          pos += 2;
-        } else {
-          // repeat > 0: repeat count, duración sigue
-          repeat = repeat_raw;
-
-          if (pos >= block_end)
-            break;
-          uint16_t dur_word = getNBYTE(mFile, pos, 2);
-          pos += 2;
-
-          if (dur_word & 0x8000) {
-            // Duración 31-bit: (dur_word & 0x7FFF) es HIGH, siguiente es LOW
-            duration = (uint32_t)(dur_word & 0x7FFF) << 16;
-            if (pos >= block_end)
-              break;
-            duration |= getNBYTE(mFile, pos, 2);
-            pos += 2;
-          } else {
-            // Duración 15-bit directa
-            duration = dur_word;
-          }
-        }
-      }
-
-      descriptor.timming.pzx_pulse_data[idx].pulse_len = duration;
-      descriptor.timming.pzx_pulse_data[idx].repeat = repeat;
-
-      // Debug: mostrar los primeros pulsos
-      if (idx < 10) {
-        logln("  PULS[" + String(idx) + "]: duration=" + String(duration) +
-              " T, repeat=" + String(repeat));
-      }
-
-      idx++;
+      return true;
     }
 
-    // Actualizar el conteo real
-    descriptor.timming.pzx_num_pulses = idx;
+    // repeat > 0: repeat count, duración sigue
+    entry.repeat = repeat_raw;
+    uint16_t dur_word = _reader.getWORD(pos);
+    pos += 2;
 
-    // Calcular estadísticas
-    uint32_t total_pulses = 0;
-    for (int i = 0; i < idx; i++) {
-      total_pulses += descriptor.timming.pzx_pulse_data[i].repeat;
+    if (dur_word & 0x8000) {
+      // Duración 31-bit: (dur_word & 0x7FFF) es HIGH, siguiente es LOW
+      if (pos >= block_end) {
+        return false;
+      }
+      entry.pulse_len = ((uint32_t)(dur_word & 0x7FFF) << 16) |
+                        _reader.getWORD(pos);
+      pos += 2;
+    } else {
+      // Duración 15-bit directa
+      entry.pulse_len = dur_word;
     }
-    logln("PULS: " + String(idx) + " entries, " + String(total_pulses) +
-          " total pulses");
-  }
-
-  uint8_t getByte(File &mFile, int offset) {
-    uint8_t b;
-    mFile.seek(offset);
-    mFile.read(&b, 1);
-    return b;
+    return true;
   }
 
   void analyzeDATA(File &mFile, tPZXBlockDescriptor &descriptor) {
@@ -351,13 +347,13 @@ private:
 
     descriptor.data_tail_pulse = getNBYTE(mFile, data_offset + 4, 2);
     // ✅ CORRECCIÓN: Usar una función de ayuda para leer un solo byte
-    descriptor.data_p0_count = getByte(mFile, data_offset + 6);
-    descriptor.data_p1_count = getByte(mFile, data_offset + 7);
+    descriptor.data_p0_count = getBYTE(mFile, data_offset + 6);
+    descriptor.data_p1_count = getBYTE(mFile, data_offset + 7);
 
     int s0_offset = data_offset + 8;
     if (descriptor.data_p0_count > 0) {
       descriptor.data_s0_pulses =
-          (uint16_t *)ps_malloc(descriptor.data_p0_count * sizeof(uint16_t));
+          parseArena.allocArray<uint16_t>(descriptor.data_p0_count);
       if (descriptor.data_s0_pulses) { // Comprobar si la asignación tuvo éxito
         for (int i = 0; i < descriptor.data_p0_count; ++i) {
           descriptor.data_s0_pulses[i] = getNBYTE(mFile, s0_offset + i * 2, 2);
@@ -368,7 +364,7 @@ private:
     int s1_offset = s0_offset + descriptor.data_p0_count * 2;
     if (descriptor.data_p1_count > 0) {
       descriptor.data_s1_pulses =
-          (uint16_t *)ps_malloc(descriptor.data_p1_count * sizeof(uint16_t));
+          parseArena.allocArray<uint16_t>(descriptor.data_p1_count);
       if (descriptor.data_s1_pulses) { // Comprobar si la asignación tuvo éxito
         for (int i = 0; i < descriptor.data_p1_count; ++i) {
           descriptor.data_s1_pulses[i] = getNBYTE(mFile, s1_offset + i * 2, 2);
@@ -382,8 +378,7 @@ private:
     // bytes)
     if (descriptor.data_bit_count / 8 >= 17) {
       uint8_t header_data[17];
-      mFile.seek(descriptor.data_stream_offset);
-      mFile.read(header_data, 17);
+      getBlock(mFile, header_data, descriptor.data_stream_offset, 17);
 
       // Comprobar si es una cabecera (flag 0x00) de tipo PROGRAM (tipo 0x00)
       if (header_data[0] == 0x00 && header_data[1] == 0x00) {
@@ -417,86 +412,18 @@ public:
     descriptor.initial_level = (flags >> 3) & 1;
     descriptor.pause_duration = getNBYTE(mFile, block_data_offset + 4, 2);
 
-    int compressed_data_offset = block_data_offset + 6;
-    int compressed_data_size = descriptor.size - 6;
+    // Los datos Z-RLE se descomprimen al reproducir (ver CSWStream). Aqui
+    // solo guardamos donde estan
+    descriptor.csw_data_offset = block_data_offset + 6;
+    descriptor.csw_data_size = descriptor.size - 6;
 
-    if (compressed_data_size <= 0) {
+    if (descriptor.csw_data_size <= 0) {
       logln("ERROR: CSW block has no data.");
       descriptor.playeable = false;
       return;
     }
 
-    // --- Descompresión Z-RLE ---
-    uint8_t *compressed_buffer = (uint8_t *)ps_malloc(compressed_data_size);
-    if (!compressed_buffer) {
-      logln("ERROR: Failed to alloc Z-RLE buffer");
-      return;
-    }
-
-    mFile.seek(compressed_data_offset);
-    mFile.read(compressed_buffer, compressed_data_size);
-
-    mz_ulong decompressed_size = compressed_data_size * 15; // Estimación segura
-    uint8_t *rle_data = (uint8_t *)ps_malloc(decompressed_size);
-    int rle_data_size = 0;
-
-    if (rle_data) {
-      int result = mz_uncompress(rle_data, &decompressed_size,
-                                 compressed_buffer, compressed_data_size);
-      if (result == MZ_OK) {
-        rle_data_size = decompressed_size;
-        logln("  - Decompressed to " + String(rle_data_size) +
-              " bytes of RLE data.");
-      } else {
-        logln("ERROR: miniz decompression failed with code: " + String(result));
-        free(rle_data);
-        rle_data = nullptr;
-      }
-    }
-    free(compressed_buffer);
-
-    if (!rle_data || rle_data_size == 0) {
-      logln("ERROR: No RLE data to process after decompression.");
-      if (rle_data)
-        free(rle_data);
-      descriptor.playeable = false;
-      return;
-    }
-
-    // --- Parseo de datos RLE a pulsos (similar a TZX ID 0x18) ---
-    int pulse_count = 0;
-    for (int i = 0; i < rle_data_size;) {
-      pulse_count++;
-      if (rle_data[i] == 0x00)
-        i += 2;
-      else
-        i += 1;
-    }
-
-    if (pulse_count > 0) {
-      descriptor.csw_num_pulses = pulse_count;
-      descriptor.csw_pulse_data =
-          (tRlePulse *)ps_calloc(pulse_count, sizeof(tRlePulse));
-      if (descriptor.csw_pulse_data) {
-        int current_pulse = 0;
-        uint8_t last_pulse_len = 0;
-        for (int i = 0; i < rle_data_size && current_pulse < pulse_count;) {
-          uint8_t value = rle_data[i];
-          if (value == 0x00) {
-            descriptor.csw_pulse_data[current_pulse].pulse_len = last_pulse_len;
-            descriptor.csw_pulse_data[current_pulse].repeat = rle_data[i + 1];
-            i += 2;
-          } else {
-            last_pulse_len = value;
-            descriptor.csw_pulse_data[current_pulse].pulse_len = last_pulse_len;
-            descriptor.csw_pulse_data[current_pulse].repeat = 1;
-            i += 1;
-          }
-          current_pulse++;
-        }
-      }
-    }
-    free(rle_data);
+    logln("  - Z-RLE data: " + String(descriptor.csw_data_size) + " bytes");
   }
 
   void analyzePZXBlock(File &mFile, int currentOffset,
@@ -508,8 +435,7 @@ public:
     char tag[5] = {0};
     uint32_t size = 0;
 
-    mFile.seek(currentOffset);
-    mFile.read((uint8_t *)tag, 4);
+    readTag(mFile, currentOffset, tag);
     size = getNBYTE(mFile, currentOffset + 4, 4);
 
     strncpy(descriptor.tag, tag, 5);
@@ -544,14 +470,41 @@ public:
     return strcmp(tag, "PZXT") == 0;
   }
 
-  // ... (código existente) ...
+  bool reservePZXDescriptors(int count) {
+    // La tabla crece según aparecen bloques (una sola pasada por el fichero)
+    if (count <= _capacity) {
+      return true;
+    }
+    int capacity = (_capacity == 0) ? 64 : _capacity * 2;
+    while (capacity < count) {
+      capacity *= 2;
+    }
+
+    tPZXBlockDescriptor *descriptor = (tPZXBlockDescriptor *)ps_realloc(
+        _myPZX.descriptor, capacity * sizeof(tPZXBlockDescriptor));
+    if (descriptor == nullptr) {
+      return false;
+    }
+    memset(descriptor + _capacity, 0,
+           (capacity - _capacity) * sizeof(tPZXBlockDescriptor));
+    _myPZX.descriptor = descriptor;
+    _capacity = capacity;
+    return true;
+  }
+
   void getBlockDescriptor(File &mFile) {
     int startOffset = 0; // Por defecto, empezamos en el offset 0
+    unsigned long t0 = millis();
+
+    // Una sola pasada: de cada bloque se lee la cabecera (tag + tamaño) y
+    // los pocos campos que necesita, a traves de la ventana de lectura
+    if (!_reader.begin(mFile)) {
+      logln("Warning: no memory for read-ahead window");
+    }
 
     // 1. Comprobar que el fichero empieza con la cabecera obligatoria 'PZXT'
     char file_tag[5] = {0};
-    mFile.seek(0);
-    mFile.read((uint8_t *)file_tag, 4);
+    readTag(mFile, 0, file_tag);
 
     if (strcmp(file_tag, "PZXT") != 0) {
       // Según la especificación, si no empieza con PZXT, no es un fichero
@@ -559,12 +512,12 @@ public:
       logln("Error: Not a valid PZX file. Missing 'PZXT' header at offset 0.");
       _myPZX.numBlocks = 0;
       TOTAL_BLOCKS = 0;
+      _reader.end();
       return;
     }
 
-    // ✅ CORRECCIÓN: Leer el tamaño real del bloque PZXT para saber dónde
-    // empieza el siguiente. El tamaño total del bloque PZXT es 8 (tag+size) +
-    // el valor del campo size.
+    // El tamaño total del bloque PZXT es 8 (tag+size) + el valor del campo
+    // size. Los bloques empiezan detras
     uint32_t pzxt_block_data_size = getNBYTE(mFile, 4, 4);
     startOffset = 8 + pzxt_block_data_size;
 
@@ -573,59 +526,48 @@ public:
 
     int currentOffset = startOffset;
     int blockCount = 0;
+    int fileSize = mFile.size();
+    _myPZX.descriptor = nullptr;
+    _capacity = 0;
 
-    // 2. Primer paso: contar bloques de datos (empezando DESPUÉS del bloque
-    // PZXT)
-    while (currentOffset < mFile.size()) {
-      blockCount++;
-
-      char *tag = readTag(mFile, currentOffset);
-      uint32_t blockSize = getNBYTE(mFile, currentOffset + 4, 4);
-
-      // logln("");
-      // logln("");
-      // log("PZX Block - " + String(tag) + " at offset: [");
-      // logHEX(currentOffset);
-      // log("] - Size: " + String(blockSize) + " bytes");
+    // 2. Analizar cada bloque (empezando DESPUÉS del bloque PZXT)
+    while (currentOffset + 8 <= fileSize) {
+      if (ABORT) {
+        break;
+      }
 
-      currentOffset += 8 + blockSize;
-    }
+      if (!reservePZXDescriptors(blockCount + 1)) {
+        logln("FATAL: Failed to allocate memory for PZX descriptors.");
+        break;
+      }
 
-    TOTAL_BLOCKS = blockCount + 1;
-    logln("Total PZX Data Blocks Found: " + String(blockCount));
+      tPZXBlockDescriptor &d = _myPZX.descriptor[blockCount];
+      analyzePZXBlock(mFile, currentOffset, d);
 
-    if (blockCount == 0) {
-      _myPZX.numBlocks = 0;
-      return;
-    }
+#ifdef DEBUGMODE
+      logln("PZX Block " + String(blockCount + 1) + " - " + String(d.tag) +
+            " at offset: " + String(d.offset) + " - Size: " +
+            String(d.size) + " bytes");
+#endif
 
-    // 3. Reservar memoria para el número correcto de bloques
-    _myPZX.numBlocks = blockCount;
-    _myPZX.descriptor = (tPZXBlockDescriptor *)ps_calloc(
-        blockCount, sizeof(tPZXBlockDescriptor));
-    if (_myPZX.descriptor == nullptr) {
-      logln("FATAL: Failed to allocate memory for PZX descriptors. ESP will "
-            "likely restart.");
-      return;
+      // Avanzar al siguiente bloque
+      currentOffset += 8 + d.size;
+      blockCount++;
     }
 
-    // 4. Segundo paso: analizar cada bloque y rellenar el descriptor
-    currentOffset =
-        startOffset; // Reiniciar el offset al primer bloque de datos
-    for (int i = 0; i < blockCount; ++i) {
-      // if (STOP || ABORT) break;
-
-      analyzePZXBlock(mFile, currentOffset, _myPZX.descriptor[i]);
+    SD_READS_LAST_OPEN = _reader.getReads();
+    _reader.end();
 
-      logln("TAg analyzed: " + String(_myPZX.descriptor[i].tag));
-      logln("Offset: ");
-      logHEX(_myPZX.descriptor[i].offset);
-      logln("Size: " + String(_myPZX.descriptor[i].size));
-      logln("Analyzed PZX Block " + String(i + 1) + "/" + String(blockCount) +
-            ": " + String(_myPZX.descriptor[i].typeName));
-
-      // Avanzar al siguiente bloque
-      currentOffset += 8 + _myPZX.descriptor[i].size;
+    TOTAL_BLOCKS = blockCount + 1;
+    _myPZX.numBlocks = blockCount;
+    logln("Total PZX Data Blocks Found: " + String(blockCount) + " in " +
+          String(millis() - t0) + " ms, SD reads: " +
+          String(SD_READS_LAST_OPEN));
+
+    if (blockCount == 0 && _myPZX.descriptor != nullptr) {
+      free(_myPZX.descriptor);
+      _myPZX.descriptor = nullptr;
+      _capacity = 0;
     }
   }
   // ... (resto del código) ...
@@ -754,8 +696,31 @@ public:
     if (_rlen != 0) {
       FILE_IS_OPEN = true;
 
+#ifdef DSC_INDEX_ENABLE
+      // Si ya tenemos el indice de este fichero no hace falta analizarlo
+      unsigned long t0 = millis();
+      int totalBlocks = 0;
+      if (dscIndex.loadPZX(path, pzxFile, _myPZX, totalBlocks)) {
+        set_file(pzxFile, _rlen);
+        TOTAL_BLOCKS = totalBlocks;
+        LAST_MESSAGE = "PZX ready.";
+        logln("Block index loaded in " + String(millis() - t0) + " ms");
+        return;
+      }
+#endif
+
       proccessingDescriptor(pzxFile);
       logln("All blocks captured from PZX file");
+
+#ifdef DSC_INDEX_ENABLE
+      if (!ABORT && _myPZX.descriptor != nullptr && _myPZX.numBlocks > 0) {
+        if (dscIndex.savePZX(path, pzxFile, _myPZX, TOTAL_BLOCKS)) {
+          logln("Block index saved");
+        } else {
+          logln("Warning: block index not saved");
+        }
+      }
+#endif
     } else {
       FILE_IS_OPEN = false;
       LAST_MESSAGE = "Error in PZX file has 0 bytes";
@@ -826,6 +791,20 @@ public:
 
     bool pause_from_stop_block = false;
 
+    // Los pulsos de PULS y los bytes de DATA se leen del fichero a medida que
+    // se reproducen
+    if (!_reader.begin(_mFile)) {
+      // Sin PSRAM para la ventana grande, con una pequeña. Sin ninguna no
+      // se puede reproducir PULS ni DATA
+      logln("Warning: no memory for PZX read-ahead window, using 512 bytes");
+      if (!_reader.begin(_mFile, 512)) {
+        LAST_MESSAGE = "Error. Not enough memory for PZX";
+        PLAY = false;
+        _zxp.closePulseBlock();
+        return;
+      }
+    }
+
     // Inicializamos el nivel de la señal según la polarización seleccionada
     // EDGE_EAR_IS = INVERSETRAIN ? POLARIZATION ^ 1: POLARIZATION;
 
@@ -929,100 +908,112 @@ public:
           0, 0, _myPZX.descriptor[i].name, _myPZX.descriptor[i].typeName,
           _myPZX.descriptor[i].size, _myPZX.descriptor[i].playeable);
 
-      if (strcmp(_myPZX.descriptor[i].tag, "PULS") == 0) {
+      if (strcmp(_myPZX.descriptor[i].tag, "PULS") == 0 &&
+          _reader.isOpen()) {
         // logln(" - Playing PZX PULS Block");
+        _edges.clear();
 
-        for (int p = 0; p < _myPZX.descriptor[i].timming.pzx_num_pulses; ++p) {
+        int block_start = _myPZX.descriptor[i].offset + 8;
+        int block_end = block_start + _myPZX.descriptor[i].size;
+        int pos = block_start;
+        tRlePulse entry;
+        bool edgesOk = true;
+
+        while (edgesOk && nextPulsEntry(pos, block_end, entry)) {
           if (STOP || EJECT || PAUSE)
             break;
 
-          uint32_t pulse_len =
-              _myPZX.descriptor[i].timming.pzx_pulse_data[p].pulse_len;
-          uint16_t repeat =
-              _myPZX.descriptor[i].timming.pzx_pulse_data[p].repeat;
-
           // Un pulso de duración 0 significa "cambio de nivel instantáneo"
-          // Se usa para ajustar la polaridad inicial
-          if (pulse_len == 0) {
-            // Cambiar el nivel sin generar audio
-            EDGE_EAR_IS ^= 1;
+          // Se usa para ajustar la polaridad inicial. En la lista de flancos
+          // es un semi-pulso de 0 T-states, que no genera audio.
+          if (entry.pulse_len == 0) {
+            edgesOk = pushEdge(0);
             continue;
           }
 
-          for (int r = 0; r < repeat; ++r) {
+          for (int r = 0; r < entry.repeat && edgesOk; ++r) {
+            edgesOk = pushEdge(entry.pulse_len);
+            renderEdgesIfFull();
             if (STOP || EJECT || PAUSE)
               break;
-            _zxp.pulse(pulse_len);
           }
+
+          PROGRESS_BAR_BLOCK_VALUE =
+              (int)(((int64_t)(pos - block_start) * 100) /
+                    _myPZX.descriptor[i].size);
         }
-      } else if (strcmp(_myPZX.descriptor[i].tag, "DATA") == 0) {
+
+        if (STOP || EJECT || PAUSE || !edgesOk) {
+          _edges.clear();
+        } else {
+          renderEdges();
+        }
+      } else if (strcmp(_myPZX.descriptor[i].tag, "DATA") == 0 &&
+                 _reader.isOpen()) {
         // el primer pulso lo rige initial_level
         CHANGE_PZX_LEVEL = false;
 
         // logln(" - Playing PZX DATA Block");
-        int data_byte_len = (_myPZX.descriptor[i].data_bit_count + 7) / 8;
-        uint8_t *data_buffer = (uint8_t *)ps_malloc(data_byte_len);
-
-        if (data_buffer) {
-          _mFile.seek(_myPZX.descriptor[i].data_stream_offset);
-          _mFile.read(data_buffer, data_byte_len);
-
-          // ✅ Aplicar el bit 31: nivel inicial del primer pulso del bloque
-          // DATA Según la especificación PZX: "The initial pulse level is
-          // specified by bit 31 of the count field.
-          //  For data saved with standard ROM routines, it should be always set
-          //  to high"
-          // bit 31 = 0 -> pulso LOW, bit 31 = 1 -> pulso HIGH
-          // if (_myPZX.descriptor[i].initial_level == 0) {
-          //     // Queremos que el primer pulso sea LOW
-          //     _zxp.forzeHighLevel = false;
-          //     _zxp.forzeLowLevel = true;
-          // } else {
-          //     // Queremos que el primer pulso sea HIGH
-          //     _zxp.forzeLowLevel = false;
-          //     _zxp.forzeHighLevel = true;
-          // }
-
-          for (int bit_num = 0; bit_num < _myPZX.descriptor[i].data_bit_count;
-               ++bit_num) {
-            if (STOP || EJECT || PAUSE)
-              break;
-            int byte_idx = bit_num / 8;
-            int bit_idx = 7 - (bit_num % 8);
-            uint8_t bit_value = (data_buffer[byte_idx] >> bit_idx) & 1;
-
-            if (bit_value == 0) // Tocar pulsos para '0'
-            {
-              // ✅ CORRECCIÓN: Iterar por el array de pulsos y llamar a pulse
-              // para cada uno
-              for (int p = 0; p < _myPZX.descriptor[i].data_p0_count; ++p) {
-                _zxp.pulsePZX(_myPZX.descriptor[i].data_s0_pulses[p],
-                              _myPZX.descriptor[i].initial_level == 0);
-              }
-            } else // Tocar pulsos para '1'
-            {
-              // ✅ CORRECCIÓN: Iterar por el array de pulsos y llamar a pulse
-              // para cada uno
-              for (int p = 0; p < _myPZX.descriptor[i].data_p1_count; ++p) {
-                _zxp.pulsePZX(_myPZX.descriptor[i].data_s1_pulses[p],
-                              _myPZX.descriptor[i].initial_level == 0);
-              }
-            }
+        const tPZXBlockDescriptor &d = _myPZX.descriptor[i];
+        // Los bytes se leen de la ventana según se necesitan
+        int data_offset = d.data_stream_offset;
+        int bits = d.data_bit_count;
+        uint8_t data_byte = 0;
+
+        // El primer semi-pulso del bloque fija el nivel inicial, el
+        // resto alternan. Bit 31 del campo count: 0 LOW, 1 HIGH
+        uint8_t mode = (d.initial_level == 0) ? EDGE_LOW : EDGE_HIGH;
+        _edges.clear();
+
+        bool byteTable = buildByteTable(d);
+#ifdef DEBUGMODE
+        unsigned long tBlock = micros();
+        _renderMicros = 0;
+#endif
 
-            // BYTES_LOADED = BYTES_LOADED + (bit_num / 8);
-            PROGRESS_BAR_BLOCK_VALUE =
-                (int)(((float)(bit_num + 1) /
-                       _myPZX.descriptor[i].data_bit_count) *
-                      100.0);
+        int bit_num = 0;
+        bool edgesOk = true;
+        while (edgesOk && bit_num < bits && !(STOP || EJECT || PAUSE)) {
+          if (byteTable && mode == EDGE_TOGGLE && (bit_num & 7) == 0 &&
+              bit_num + 8 <= bits) {
+            // Byte completo desde la tabla
+            data_byte = _reader.getBYTE(data_offset + bit_num / 8);
+            edgesOk = appendEdges(_byteEdges + _byteStart[data_byte],
+                                  _byteStart[data_byte + 1] -
+                                      _byteStart[data_byte]);
+            bit_num += 8;
+          } else {
+            int bit_idx = 7 - (bit_num & 7);
+            if (bit_idx == 7) {
+              data_byte = _reader.getBYTE(data_offset + bit_num / 8);
+            }
+            edgesOk = pushDataBit(d, (data_byte >> bit_idx) & 1, mode);
+            bit_num++;
           }
-          free(data_buffer);
 
-          if (_myPZX.descriptor[i].data_tail_pulse > 0) {
-            // ✅ CORRECCIÓN: Usar semiPulse para el pulso de cola
-            _zxp.pulsePZX(_myPZX.descriptor[i].data_tail_pulse,
-                          _myPZX.descriptor[i].initial_level == 0);
-          }
+          renderEdgesIfFull();
+
+          PROGRESS_BAR_BLOCK_VALUE = (int)(((int64_t)bit_num * 100) / bits);
+        }
+
+        if (STOP || EJECT || PAUSE || !edgesOk) {
+          _edges.clear();
+        } else if (d.data_tail_pulse > 0 &&
+                   !pushEdge(d.data_tail_pulse, mode)) {
+          // Pulso de cola
+          _edges.clear();
+        } else {
+          renderEdges();
         }
+#ifdef DEBUGMODE
+        // Lo que cuesta montar los flancos frente a lo que dura la señal
+        // (el render va al ritmo del audio)
+        logln("PZX DATA " + String(bits) + " bits, byte table " +
+              String(byteTable ? "yes" : "no") + ", edges built in " +
+              String((micros() - tBlock - _renderMicros) / 1000) +
+              " ms, signal " + String(_renderMicros / 1000) + " ms");
+#endif
+        CHANGE_PZX_LEVEL = true;
       } else if (strcmp(_myPZX.descriptor[i].tag, "PAUS") == 0) {
         // logln(" - Playing PZX PAUS Block");
         //  El silencio está en TStates
@@ -1043,13 +1034,7 @@ public:
 
         logln("Playing PZX CSW Block");
         if (_myPZX.csw_sampling_rate > 0 &&
-            _myPZX.descriptor[i].csw_num_pulses > 0) {
-          // Factor para convertir la duración del pulso CSW a T-States
-          // de 3.5MHz
-          float conversion_factor =
-              (float)DfreqCPU / (float)_myPZX.csw_sampling_rate;
-
-          // Usar _zxp.pulse() en un bucle
+            _myPZX.descriptor[i].csw_data_size > 0) {
 
           // Opcional: Si el nivel inicial es alto, generamos un pulso de
           // duración 0 para establecerlo. La implementación de _zxp.pulse()
@@ -1061,34 +1046,23 @@ public:
             _zxp.pulse(0);
           }
 
-          // 1. Iterar a través de los pulsos decodificados del RLE
-          for (int p = 0; p < _myPZX.descriptor[i].csw_num_pulses; ++p) {
-            if (STOP)
-              break;
-
-            tRlePulse &pulse = _myPZX.descriptor[i].csw_pulse_data[p];
-
-            // 2. Convertir la duración del pulso a T-States
-            uint32_t pulse_len_tstates =
-                round((float)pulse.pulse_len * conversion_factor);
-
-            // 3. Repetir la llamada a _zxp.pulse() para cada repetición
-            for (int r = 0; r < pulse.repeat; ++r) {
-              if (STOP)
-                break;
-              _zxp.pulse(pulse_len_tstates);
-            }
-
-            // Actualizar barra de progreso aquí:
-            PROGRESS_BAR_BLOCK_VALUE =
-                (int)(((float)(p + 1) / _myPZX.descriptor[i].csw_num_pulses) *
-                      100.0);
+          // Los pulsos se descomprimen del fichero a medida que se
+          // reproducen, con memoria fija sea cual sea el tamaño del bloque
+          CSWStream csw;
+          if (csw.begin(_mFile, _myPZX.descriptor[i].csw_data_offset,
+                        _myPZX.descriptor[i].csw_data_size, true)) {
+            PROGRESS_BAR_BLOCK_VALUE = 0;
+            _zxp.playCSW(csw, _myPZX.csw_sampling_rate);
+            csw.end();
+          } else {
+            logln("ERROR: Failed to alloc CSW stream buffers");
           }
-          // ✅ FIN DE LA CORRECCIÓN
         }
         _zxp.silence(_myPZX.descriptor[i].pause_duration);
 
-      } else if (strcmp(_myPZX.descriptor[i].tag, "STOP") == 0) {
+      } else if (strcmp(_myPZX.descriptor[i].tag, "STOP") == 0 &&
+                 OFFLINE_RENDER == OFFLINE_NONE) {
+        // Convirtiendo no hay nadie que pulse PLAY y se sigue
         logln(" - Executing PZX STOP Block. Pausing tape.");
         pause_from_stop_block = true;
         PLAY = false;
@@ -1133,7 +1107,11 @@ public:
                                    _myPZX.descriptor[BLOCK_SELECTED].playeable);
     }
 
+    _reader.end();
+    freeByteTable();
+
     // Cerrando
+    _zxp.closePulseBlock();
   }
 
   tPZX getDescriptor() { return _myPZX; }
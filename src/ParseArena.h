@@ -0,0 +1,103 @@
+#pragma once
+
+// Memoria de los datos que cuelgan de los descriptores del fichero abierto.
+//
+// Los analizadores de bloques hacen cientos de reservas pequeñas (secuencias
+// de pulsos, tablas de símbolos del ID 0x19, pulsos CSW...) que viven
+// exactamente lo mismo que el fichero. En vez de pedir cada una al heap se
+// sirven de trozos de PARSE_ARENA_CHUNK en PSRAM, uno detras de otro, y al
+// expulsar la cinta se devuelven todos los trozos con reset(). No hay que
+// recorrer los descriptores para liberar y el heap no se fragmenta de un
+// fichero a otro.
+//
+// Nada de lo que sale de aqui se libera con free().
+
+struct tArenaChunk {
+  tArenaChunk *prev = nullptr;
+  size_t size = 0; // Bytes de datos del trozo
+  size_t used = 0;
+};
+
+struct tArenaMark {
+  tArenaChunk *chunk = nullptr;
+  size_t used = 0;
+};
+
+class ParseArena {
+private:
+  // Los datos empiezan alineados a 8 bytes detras de la cabecera
+  static const size_t HEADER = (sizeof(tArenaChunk) + 7) & ~(size_t)7;
+
+  tArenaChunk *_head = nullptr;
+  size_t _usedBytes = 0;
+  size_t _reservedBytes = 0;
+
+  uint8_t *data(tArenaChunk *c) { return (uint8_t *)c + HEADER; }
+
+  void releaseChunk(tArenaChunk *c) {
+    _usedBytes -= c->used;
+    _reservedBytes -= c->size;
+    free(c);
+  }
+
+public:
+  void *alloc(size_t n) {
+    // Igual que ps_calloc: memoria a cero o nullptr si no hay
+    if (n == 0) {
+      return nullptr;
+    }
+    n = (n + 7) & ~(size_t)7;
+
+    if (_head == nullptr || _head->used + n > _head->size) {
+      // Trozo nuevo. Las reservas grandes llevan el suyo propio
+      size_t size = (n > PARSE_ARENA_CHUNK) ? n : PARSE_ARENA_CHUNK;
+      tArenaChunk *c = (tArenaChunk *)ps_malloc(HEADER + size);
+      if (c == nullptr) {
+        return nullptr;
+      }
+      c->prev = _head;
+      c->size = size;
+      c->used = 0;
+      _head = c;
+      _reservedBytes += size;
+    }
+
+    void *p = data(_head) + _head->used;
+    _head->used += n;
+    _usedBytes += n;
+    memset(p, 0, n);
+    return p;
+  }
+
+  template <typename T> T *allocArray(int count) {
+    return (count > 0) ? (T *)alloc(count * sizeof(T)) : nullptr;
+  }
+
+  tArenaMark mark() {
+    tArenaMark m;
+    m.chunk = _head;
+    m.used = (_head != nullptr) ? _head->used : 0;
+    return m;
+  }
+
+  void rollback(const tArenaMark &m) {
+    // Devuelve todo lo reservado despues de mark()
+    while (_head != nullptr && _head != m.chunk) {
+      tArenaChunk *prev = _head->prev;
+      releaseChunk(_head);
+      _head = prev;
+    }
+    if (_head != nullptr) {
+      _usedBytes -= _head->used - m.used;
+      _head->used = m.used;
+    }
+  }
+
+  void reset() {
+    rollback(tArenaMark());
+  }
+
+  size_t getUsedBytes() const { return _usedBytes; }
+
+  size_t getReservedBytes() const { return _reservedBytes; }
+};
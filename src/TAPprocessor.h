@@ -64,6 +64,9 @@ class TAPprocessor
         int _sizeTAP;
         int _rlen;
 
+        // Lectura anticipada mientras se analizan los bloques
+        FileWindowReader _reader;
+
         int CURRENT_LOADING_BLOCK = 0;
 
         // Creamos el contenedor de bloques. Descriptor de bloques
@@ -78,9 +81,10 @@ class TAPprocessor
 
             if (tapFileName != 0)
             {
-                // La cabecera son 19 bytes
-                uint8_t* bBlock = (uint8_t*)ps_calloc(19+1,sizeof(uint8_t));
-                readFileRange(tapFileName,bBlock,0,19,true);
+                // Basta con la longitud (19) y el flag de la primera cabecera
+                uint8_t bBlock[3] = {0, 0, 0};
+                tapFileName.seek(0);
+                tapFileName.read(bBlock, 3);
 
                 // Obtenemos la firma del TAP
                 char signTAPHeader[4];
@@ -103,9 +107,6 @@ class TAPprocessor
 
                     rtn = false;
                 }
-
-                // Liberamos memoria
-                free(bBlock);
             }
             else
             { 
@@ -163,33 +164,6 @@ class TAPprocessor
             return rtn;
         }
 
-        uint8_t calculateChecksum(uint8_t* bBlock, int startByte, int numBytes)
-        {
-            // Calculamos el checksum de un bloque de bytes
-            uint8_t newChk = 0;
-
-            #if LOG>3
-            // //SerialHW.println("");
-            // //SerialHW.println("Block len: ");
-            // //SerialHW.print(sizeof(bBlock)/sizeof(uint8_t*));
-            #endif
-
-            // Calculamos el checksum (no se contabiliza el ultimo numero que es precisamente el checksum)
-            
-            for (int n=startByte;n<(startByte+numBytes);n++)
-            {
-                newChk = newChk ^ bBlock[n];
-            }
-
-            #if LOG>3
-            // //SerialHW.println("");
-            // //SerialHW.println("Checksum: " + String(newChk));
-            #endif
-
-            return newChk;
-        }
-
-
         bool isCorrectHeader(uint8_t* header, int startByte)
         {
             // Verifica que es una cabecera
@@ -200,7 +174,7 @@ class TAPprocessor
             if (header[startByte]==19 && header[startByte+1]==0 && header[startByte+2]==0)
             {
                 checksum = header[startByte+20];
-                calcBlockChk = calculateChecksum(header,startByte,18);
+                calcBlockChk = xorChecksum(header+startByte,18);
 
                 if (checksum == calcBlockChk)
                 {
@@ -223,7 +197,7 @@ class TAPprocessor
                 if (header[startByte+3]==0)
                 {
                     checksum = header[startByte+20];
-                    calcBlockChk = calculateChecksum(header,startByte,18);
+                    calcBlockChk = xorChecksum(header+startByte,18);
 
                     if (checksum == calcBlockChk)
                     {
@@ -334,17 +308,17 @@ class TAPprocessor
             return (char*)(header+2);             
         }
   
-        bool getInformationOfHead(tTAPBlockDescriptor &tB, int flagByte, int typeBlock, int startBlock, int sizeB, char (&nameTAP)[11])
+        bool getInformationOfHead(tTAPBlockDescriptor &tB, const uint8_t* hdr, int startBlock, int sizeB, char (&nameTAP)[11])
         {
         
-            // Obtenemos informacion de la cabecera
+            // Obtenemos informacion de la cabecera. "hdr" son los primeros
+            // bytes del bloque (flag, tipo y nombre) ya leidos por el analizador
 
             bool blockNameDetected = false;
             int state = 0;
 
-            uint8_t* ptr;
-            uint8_t* ptr1;
-            uint8_t* ptr2;
+            int flagByte = hdr[0];
+            int typeBlock = hdr[1];
 
             if (flagByte < 128)
             {
@@ -352,6 +326,13 @@ class TAPprocessor
                 // Inicializamos                    
                 tB.type = 0;
                 strncpy(tB.typeName,"",10);
+
+                // El nombre está en los bytes del 2 al 11 del bloque
+                if (typeBlock <= 3)
+                {
+                    memcpy(tB.name,hdr+2,10);
+                    tB.name[10] = '\0';
+                }
                 
                 // Es una CABECERA
                 if (typeBlock==0)
@@ -363,18 +344,9 @@ class TAPprocessor
 
                     blockNameDetected = true;
 
-                    // Almacenamos el nombre
-                    //getBlockName(tB.name,sdm.readFileRange32(_mFile,startBlock,19,false),0);
-                    uint8_t* ptr = (uint8_t*)ps_calloc(19+1,sizeof(uint8_t));
-                    readFileRange(_mFile,ptr,startBlock,19,false);
-                    strncpy(tB.name,getBlockName(tB.name,ptr,0),10);
-                    free(ptr);
-
                     //Cogemos el nombre del TAP de la primera cabecera
                     if (startBlock < 23)
                     {
-                        //nameTAP = (String)bDscr[numBlocks].name;
-                        //nameTAP = bDscr[numBlocks].name;
                         strncpy(nameTAP,tB.name,10);
                     }
 
@@ -383,22 +355,12 @@ class TAPprocessor
                 else if (typeBlock==1)
                 {
                     // Array num header
-                    // Almacenamos el nombre
-                    uint8_t* ptr = (uint8_t*)ps_calloc(19+1,sizeof(uint8_t));
-                    readFileRange(_mFile,ptr,startBlock,19,false);
-                    strncpy(tB.name,getBlockName(tB.name,ptr,0),10);
-                    free(ptr);
                     tB.type = HARRAYNUM;    
 
                 }
                 else if (typeBlock==2)
                 {
                     // Array char header
-                    // Almacenamos el nombre
-                    uint8_t* ptr = (uint8_t*)ps_calloc(19+1,sizeof(uint8_t));
-                    readFileRange(_mFile,ptr,startBlock,19,false);
-                    strncpy(tB.name,getBlockName(tB.name,ptr,0),10);
-                    free(ptr);
                     tB.type = HARRAYCHR;    
 
                 }
@@ -410,21 +372,8 @@ class TAPprocessor
                     // para ello temporalmente vemos el tamaño del bloque de codigo. Si es 6914 bytes (incluido el checksum y el flag - 6912 + 2 bytes)
                     // es una pantalla SCREEN
                     blockNameDetected = true;
-                    
-                    // Almacenamos el nombre
-                    uint8_t* ptr = (uint8_t*)ps_calloc(19+1,sizeof(uint8_t));
-                    readFileRange(_mFile,ptr,startBlock,19,false);
-                    strncpy(tB.name,getBlockName(tB.name,ptr,0),10);
-                    free(ptr);
-
-                    uint8_t* ptr1= (uint8_t*)ps_calloc(1+1,sizeof(uint8_t));
-                    uint8_t* ptr2 = (uint8_t*)ps_calloc(1+1,sizeof(uint8_t));
 
-                    readFileRange(_mFile,ptr1,startBlock+sizeB+1,1,false);
-                    readFileRange(_mFile,ptr2,startBlock+sizeB,1,false);
-                    int tmpSizeBlock = (256*ptr1[0]) + ptr2[0];
-                    free(ptr1);
-                    free(ptr2);
+                    int tmpSizeBlock = _reader.getWORD(startBlock+sizeB);
 
                     if (tmpSizeBlock == 6914)
                     {
@@ -472,148 +421,73 @@ class TAPprocessor
             // obteniendo de este información relevante y los distintos bloques que lo
             // forman. De cada bloque almacenaremos la dirección de inicio ó 
             // posición en el fichero (offset) así como el tamaño.
+            //
+            // Cada bloque es TAMAÑO (2 bytes) + flag + datos + checksum. Se
+            // recorre en una sola pasada a traves de la ventana de lectura:
+            // longitud, cabecera y checksum salen de la misma lectura
+            // anticipada, sin reservas de memoria por campo.
             
-            // Para ello tenemos que ir leyendo el TAP poco a poco
-            // y llegando a los bytes que indican TAMAÑO(2 bytes) + 0xFF(1 uint8_t)
-
-            // Este procedimiento recorre el .TAP y devuelve el número de bloques que contiene
-            //int numBlks = getNumBlocks(mFile, sizeTAP);
-            
-            //if (!FILE_CORRUPTED)
-            //{
             // La reserva de memoria para el descriptor de bloques del TAP
             // se hace en powadcr.ino
             bool blockDescriptorOk = true;
             //  Inicializamos variables
             char nameTAP[11];
-            char typeName[11];
-            char blockName[11];
+            memset(nameTAP,0,sizeof(nameTAP));
 
             int startBlock = 0;
-            int lastStartBlock = 0;
-            int sizeB = 0;
-            int newSizeB = 0;
-            int chk = 0;
-            int blockChk = 0;
             int numBlocks = 0;
-            int state = 0;    
+            int badBlocks = 0;
+            unsigned long t0 = millis();
 
-            bool blockNameDetected = false;                
-            bool reachEndByte = false;
-
-            uint8_t* ptr;
-            uint8_t* ptr1;
-            uint8_t* ptr2;
-
-            //Entonces recorremos el TAP. 
-            // //SerialHW.println("");
-            // //SerialHW.println("Analyzing TAP file. Please wait ...");
-            
-            // La primera cabecera SIEMPRE debe darse.
-            // Los dos primeros bytes son el tamaño a contar
-            ptr1 = (uint8_t*)ps_calloc(1+1,sizeof(uint8_t));
-            ptr2 = (uint8_t*)ps_calloc(1+1,sizeof(uint8_t));
-            readFileRange(_mFile,ptr1,startBlock+1,1,false);
-            readFileRange(_mFile,ptr2,startBlock,1,false);
-            sizeB = (256*ptr1[0]) + ptr2[0];
-            free(ptr1);
-            free(ptr2);            
-
-            startBlock = 2;
+            if (!_reader.begin(mFile))
+            {
+                // Sin PSRAM para la ventana grande, con una pequeña
+                if (!_reader.begin(mFile,512))
+                {
+                    LAST_MESSAGE = "Error. Not enough memory for TAP";
+                    return false;
+                }
+            }
 
             // Recorremos ahora el fichero
-            while(reachEndByte==false && sizeB!=0)
+            while(startBlock + 2 <= sizeTAP)
             {
-                // Inicializamos
-                blockNameDetected = false;
-                
-                // Cogemos el bloque completo, para poder calcular su checksum
-                ptr = (uint8_t*)ps_calloc(sizeB,sizeof(uint8_t));
-                readFileRange(_mFile,ptr,startBlock,sizeB-1,false);
-                // Calculamos el checksum
-                chk = calculateChecksum(ptr,0,sizeB-1);
-                // Liberamos
-                free(ptr);
-                
-                // Obtenemos el valor de checksum de la cabecera del bloque
-                ptr = (uint8_t*)ps_calloc(1+1,sizeof(uint8_t));
-                readFileRange(_mFile,ptr,startBlock+sizeB-1,1,false); 
-                blockChk =ptr[0];         
-                free(ptr);
-
-                // Comparamos para asegurarnos que el bloque es correcto
-                if (blockChk == chk)
+                // Los dos primeros bytes son el tamaño a contar
+                int sizeB = _reader.getWORD(startBlock);
+                if (sizeB == 0)
                 {
-                    // Si es correcto entonces, prosigo obteniendo información
-                    // Almaceno el inicio del bloque
-                    _myTAP.descriptor[numBlocks].offset = startBlock;
-                    // Almaceno el tamaño del bloque
-                    _myTAP.descriptor[numBlocks].size = sizeB;
-                    // Almaceno el checksum calculado
-                    _myTAP.descriptor[numBlocks].chk = chk;        
-
-                    // Cogemos mas info del bloque
-                    
-                    // Flagbyte
-                    // 0x00 - HEADER
-                    // 0xFF - DATA BLOCK
-                    ptr = (uint8_t*)ps_calloc(1+1,sizeof(uint8_t));
-                    readFileRange(_mFile,ptr,startBlock,1,false);
-                    int flagByte = ptr[0];
-                    free(ptr);
-
-                    // Typeblock
-                    // 0x00 - PROGRAM
-                    // 0x01 - ARRAY NUM
-                    // 0x02 - ARRAY CHAR
-                    // 0x03 - CODE FILE
-                    ptr = (uint8_t*)ps_calloc(1+1,sizeof(uint8_t));
-                    readFileRange(_mFile,ptr,startBlock+1,1,false);
-                    int typeBlock = ptr[0];
-                    free(ptr);
-                    
-                    // Vemos si el bloque es una cabecera o un bloque de datos (bien BASIC o CM)
-                    blockNameDetected = getInformationOfHead(_myTAP.descriptor[numBlocks],flagByte,typeBlock,startBlock,sizeB,nameTAP);
+                    break;
+                }
 
-                    strncpy(_myTAP.descriptor[numBlocks].typeName,getTypeTAPBlock(_myTAP.descriptor[numBlocks].type),12)                       ;                      
+                int lastStartBlock = startBlock;
+                // El bloque comienza 2 bytes mas adelante (nos saltamos 13 00 ó FF 00)
+                startBlock = startBlock + 2;
 
-                    // Si el bloque contenia nombre, se indica
-                    if (blockNameDetected)
-                    {                                     
-                        _myTAP.descriptor[numBlocks].nameDetected = true;                                      
-                    }
-                    else
-                    {
-                        _myTAP.descriptor[numBlocks].nameDetected = false;
-                    }
+                if (numBlocks >= MAX_BLOCKS_IN_TAP)
+                {
+                    LAST_MESSAGE = "Warning. Only " + String(MAX_BLOCKS_IN_TAP) + " blocks loaded";
+                    logln("TAP: more than " + String(MAX_BLOCKS_IN_TAP) + " blocks");
+                    break;
+                }
 
-                    // Siguiente bloque
-                    // Direcion de inicio (offset)
-                    startBlock = startBlock + sizeB;
-                    // Tamaño
-                    ptr1 = (uint8_t*)ps_calloc(1+1,sizeof(uint8_t));
-                    ptr2 = (uint8_t*)ps_calloc(1+1,sizeof(uint8_t));
-                    readFileRange(_mFile,ptr1,startBlock+1,1,false);
-                    readFileRange(_mFile,ptr2,startBlock,1,false);
-                    newSizeB = (256*ptr1[0]) + ptr2[0];
-                    free(ptr1);
-                    free(ptr2);  
-                    // Pasamos al siguiente bloque
-                    numBlocks++;
-                    // Ahora el tamaño es el nuevo tamaño calculado
-                    sizeB = newSizeB;
-                    // El inicio de bloque comienza 2 bytes mas adelante (nos saltamos 13 00 ó FF 00)
-                    startBlock = startBlock + 2;
+                // Flag, tipo y nombre (los 12 primeros bytes) 
+                uint8_t hdr[12];
+                memset(hdr,0,sizeof(hdr));
+                _reader.read(startBlock,hdr,min(sizeB,(int)sizeof(hdr)));
 
-                }
-                else
+                // Checksum del bloque (no se contabiliza el ultimo byte, que
+                // es precisamente el checksum)
+                int chk = _reader.checksum(startBlock,sizeB-1);
+                int blockChk = _reader.getBYTE(startBlock+sizeB-1);
+
+                // Un bloque cortado por el final del fichero no se puede
+                // reproducir
+                if (startBlock + sizeB > sizeTAP)
                 {
-                    // Si los checksum no coinciden. Indicamos que hemos acabado
-                    // y decimos que hay un error (debug)
-                    reachEndByte = true;
-                    // //SerialHW.println("Error in checksum. Block --> " + String(numBlocks) + " - offset: " + String(lastStartBlock));
-                    LAST_MESSAGE = "Error in checksum. Block --> " + String(numBlocks) + " - offset: " + String(lastStartBlock);
+                    // Indicamos que hemos acabado y decimos que hay un error
+                    LAST_MESSAGE = "Error in block. Block --> " + String(numBlocks) + " - offset: " + String(lastStartBlock);
                     blockDescriptorOk = false;
+                    _reader.end();
                     delay(3000);                
                     
                     // Añadimos información importante
@@ -624,19 +498,56 @@ class TAPprocessor
                     return blockDescriptorOk;
                 }
 
-                // ¿Hemos llegado al ultimo byte? Entonces lo indicamos reachEndByte = true
-                if (startBlock > sizeTAP)                
+                tTAPBlockDescriptor &tB = _myTAP.descriptor[numBlocks];
+
+                // Un checksum incorrecto se marca (se ve en el navegador de
+                // bloques) pero el bloque se reproduce tal cual, como haria
+                // la cinta
+                tB.corrupted = (blockChk != chk);
+                if (tB.corrupted)
                 {
-                    // Con esto en la siguiente vuelta, salimos del while
-                    reachEndByte = true;
-                    //break;
-                    // //SerialHW.println("");
-                    // //SerialHW.println("Success. End: ");
+                    badBlocks++;
+                    logln("TAP: checksum error in block " + String(numBlocks) + " - offset: " + String(lastStartBlock));
                 }
 
+                // Almaceno el inicio del bloque
+                tB.offset = startBlock;
+                // Almaceno el tamaño del bloque
+                tB.size = sizeB;
+                // Almaceno el checksum calculado
+                tB.chk = chk;        
+
+                // Vemos si el bloque es una cabecera o un bloque de datos (bien BASIC o CM)
+                // Flagbyte
+                // 0x00 - HEADER
+                // 0xFF - DATA BLOCK
+                // Typeblock
+                // 0x00 - PROGRAM
+                // 0x01 - ARRAY NUM
+                // 0x02 - ARRAY CHAR
+                // 0x03 - CODE FILE
+                tB.nameDetected = getInformationOfHead(tB,hdr,startBlock,sizeB,nameTAP);
+
+                strncpy(tB.typeName,getTypeTAPBlock(tB.type),12);
+
+                // Siguiente bloque
+                startBlock = startBlock + sizeB;
+                numBlocks++;
+
                 TOTAL_BLOCKS = numBlocks + 1;
             }
 
+            // Fin del analisis. Liberamos la ventana e informamos de los
+            // accesos a la SD que ha necesitado
+            SD_READS_LAST_OPEN = _reader.getReads();
+            _reader.end();
+            logln("TAP scan: " + String(numBlocks) + " blocks in " + String(millis() - t0) + " ms, SD reads: " + String(SD_READS_LAST_OPEN));
+
+            if (badBlocks > 0)
+            {
+                LAST_MESSAGE = "Warning. " + String(badBlocks) + " blocks with checksum error";
+            }
+
             // Añadimos información importante
             strncpy(_myTAP.name,nameTAP,sizeof(nameTAP));
             _myTAP.size = sizeTAP;
@@ -865,6 +776,9 @@ class TAPprocessor
             _myTAP.numBlocks = 0;
             _myTAP.size = 0; 
             _myTAP.descriptor = nullptr;    
+            #ifdef BLOCK_CACHE_ENABLE
+                blockCache.clear();
+            #endif
         }
 
         bool proccess_tap(File tapFileName)
@@ -873,6 +787,11 @@ class TAPprocessor
             // Verificamos que sea un TAP correcto.
             // if (isFileTAP(tapFileName))
             // {
+            #ifdef BLOCK_CACHE_ENABLE
+                // Los bloques cacheados son del fichero anterior
+                blockCache.clear();
+            #endif
+
             // Analizamos el .TAP y obtenemos el descriptor de bloques
             if (!getBlockDescriptor(_mFile, _sizeTAP))
             {
@@ -1200,6 +1119,17 @@ class TAPprocessor
                             log(String(_myTAP.descriptor[i].size) + " bytes");
                         #endif
 
+                        #ifdef BLOCK_CACHE_ENABLE
+                            // Si el bloque ya se reprodujo con los mismos ajustes lo
+                            // repetimos desde la cache, sin leer la SD
+                            if (_zxp.playCachedBlock(i, _myTAP.descriptor[i].offset, _myTAP.descriptor[i].size))
+                            {
+                                BLOCK_PLAYED = true;
+                                continue;
+                            }
+                            _zxp.beginBlockCapture(i);
+                        #endif
+
                         // Reproducimos el fichero
                         if (_myTAP.descriptor[i].type == 0) 
                         {
@@ -1333,12 +1263,19 @@ class TAPprocessor
                             }
                         }
 
+                        #ifdef BLOCK_CACHE_ENABLE
+                            _zxp.endBlockCapture();
+                        #endif
+
                         BLOCK_PLAYED = true;
                     }
 
                     // //SerialHW.println("");
                     // //SerialHW.println("Playing was finish.");
 
+                    // Volcamos lo pendiente del renderizador de pulsos
+                    _zxp.closePulseBlock();
+
                     // En el caso de no haber parado manualmente, 
                     // Lanzamos el AUTO-STOP
                     if (LOADING_STATE == 1) 
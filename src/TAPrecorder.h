@@ -302,20 +302,6 @@ private:
     _hmi.writeString("tape.recIndicator.bco=32768");
   }
 
-  uint8_t calculateChecksum(uint8_t *bBlock, int startByte, int numBytes) {
-    // Calculamos el checksum de un bloque de bytes
-    uint8_t newChk = 0;
-
-    // Calculamos el checksum (no se contabiliza el ultimo numero que es
-    // precisamente el checksum)
-
-    for (int n = startByte; n < (startByte + numBytes); n++) {
-      newChk = newChk ^ bBlock[n];
-    }
-
-    return newChk;
-  }
-
   void proccesByteCaptured(int byteCount, uint8_t byteRead) {
 
     // Flag para indicar DATA o HEAD
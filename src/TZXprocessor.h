@@ -36,35 +36,15 @@
 #include "globales.h"
 #include <Arduino.h>
 #include <FS.h>
-#include <miniz.h>
 
 class TZXprocessor {
 
 private:
-  const char ID10STR[35] = "ID 10 - Standard block            ";
-  const char ID11STR[35] = "ID 11 - Speed block               ";
-  const char ID12STR[35] = "ID 12 - Pure tone                 ";
-  const char ID13STR[35] = "ID 13 - Pulse seq.                ";
-  const char ID14STR[35] = "ID 14 - Pure data                 ";
-  const char ID15STR[35] = "ID 15 - Direct recording          ";
-  const char ID18STR[35] = "ID 18 - CSW recording             ";
-  const char ID19STR[35] = "ID 19 - GDB                       ";
-  const char ID20STR[35] = "ID 20 - Pause or Stop             ";
-  const char ID21STR[35] = "ID 21 - Group start               ";
-  const char ID22STR[35] = "ID 22 - Group end                 ";
-  const char ID23STR[35] = "ID 23 - Jump to block             ";
-  const char ID24STR[35] = "ID 24 - Loop start                ";
-  const char ID25STR[35] = "ID 25 - Loop end                  ";
-  const char ID26STR[35] = "ID 26 - Call sequence             ";
-  const char ID27STR[35] = "ID 27 - Return from sequence      ";
-  const char ID28STR[35] = "ID 28 - Select block              ";
-  const char ID2ASTR[35] = "ID 2A - Stop TAPE (48k mode)      ";
-  const char ID2BSTR[35] = "ID 2B - Set signal level          ";
-  const char ID4BSTR[35] = "ID 4B - TSX Block                 ";
-  const char ID5ASTR[35] = "ID 5A - Glue block                ";
-  const char IDXXSTR[35] = "Information block                 ";
-
-  const int maxAllocationBlocks = 4000;
+  // Variantes de la familia TZX. Se elige por la extension del fichero
+  static const uint8_t DIALECT_TZX = 0x01;
+  static const uint8_t DIALECT_TSX = 0x02; // MSX
+  static const uint8_t DIALECT_CDT = 0x04; // Amstrad CPC
+  static const uint8_t DIALECT_ALL = 0x07;
 
   // Procesador de audio output
   ZXProcessor _zxp;
@@ -80,6 +60,40 @@ private:
   int _sizeTZX;
   int _rlen;
 
+  // Lectura anticipada mientras se analizan los bloques
+  FileWindowReader _reader;
+
+  // Copia de la tabla que lee el resto del programa (HMI, FFWD/RWD...).
+  // Con el analisis en paralelo se actualiza cada vez que se publican bloques
+  tTZX *_mirror = nullptr;
+  // Variante del fichero abierto (DIALECT_xxx)
+  uint8_t _dialect = DIALECT_TZX;
+  // Tablas sustituidas al crecer durante el analisis en paralelo. Se liberan
+  // al expulsar, cuando ya nadie puede estar leyendolas
+  tTZXBlockDescriptor *_retired[32];
+  int _numRetired = 0;
+  // Flanco con el que empezo el ultimo bloque reproducido (para PAUSE)
+  int _edgeBlock = -1;
+  uint8_t _edgeAtBlockStart = POLARIZATION;
+  // Resultados del analisis. La tarea del analizador no toca globales ni la
+  // pantalla: los deja aqui o en los descriptores y la tarea que abrio el
+  // fichero los aplica (applyParseResults / finishParseResults)
+  const char *_parseMessage = nullptr;
+  int _groupCount = 1;
+  bool _parseEndedWhilePlaying = false;
+  int _appliedBlocks = 0;
+  // El analisis no ha llegado al final del fichero (cancelado o con un ID
+  // desconocido). Solo el cancelado deja la cinta sin preparar
+  bool _parseAborted = false;
+  bool _parseCancelled = false;
+
+  bool cancelRequested() {
+    // En la tarea de analisis solo se para al expulsar o cambiar de fichero.
+    // ABORT es de la reproduccion (STOP, PAUSE, bloque "stop the tape") y
+    // solo cuenta cuando el analisis va antes de PLAY
+    return TZX_PARSE_CANCEL || (ABORT && !TZX_PARSE_RUNNING);
+  }
+
   // Audio HW
   AudioInfo new_sr;
   // AudioInfo new_sr2;
@@ -104,31 +118,6 @@ private:
     return false;
   }
 
-  uint8_t calculateChecksum(uint8_t *bBlock, int startByte, int numBytes) {
-    // Calculamos el checksum de un bloque de bytes
-    uint8_t newChk = 0;
-
-#if LOG > 3
-    ////SerialHW.println("");
-    ////SerialHW.println("Block len: ");
-    ////SerialHW.print(sizeof(bBlock)/sizeof(uint8_t*));
-#endif
-
-    // Calculamos el checksum (no se contabiliza el ultimo numero que es
-    // precisamente el checksum)
-
-    for (int n = startByte; n < (startByte + numBytes); n++) {
-      newChk = newChk ^ bBlock[n];
-    }
-
-#if LOG > 3
-    ////SerialHW.println("");
-    ////SerialHW.println("Checksum: " + String(newChk));
-#endif
-
-    return newChk;
-  }
-
   char *getNameFromStandardBlock(uint8_t *header) {
     // Obtenemos el nombre del bloque cabecera
     static char prgName[11];
@@ -248,6 +237,10 @@ private:
 
   // ✅ VERSIÓN OPTIMIZADA DE getWORD
   int getWORD(File mFile, int offset) {
+    if (_reader.isOpen()) {
+      return _reader.getWORD(offset);
+    }
+
     uint8_t buffer[2];
 
     mFile.seek(offset);
@@ -269,6 +262,10 @@ private:
 
   // ✅ VERSIÓN OPTIMIZADA - CON BUFFER ESTÁTICO
   int getBYTE(File mFile, int offset) {
+    if (_reader.isOpen()) {
+      return _reader.getBYTE(offset);
+    }
+
     uint8_t buffer[1];
 
     mFile.seek(offset);
@@ -279,6 +276,10 @@ private:
 
   // ✅ AÑADIR getDWORD
   uint32_t getDWORD(File mFile, int offset) {
+    if (_reader.isOpen()) {
+      return _reader.getDWORD(offset);
+    }
+
     uint8_t buffer[4];
 
     mFile.seek(offset);
@@ -308,6 +309,10 @@ private:
     if (n > 4)
       return 0; // Máximo 4 bytes para un int
 
+    if (_reader.isOpen()) {
+      return (int)_reader.getNBYTE(offset, n);
+    }
+
     uint8_t buffer[4];
 
     mFile.seek(offset);
@@ -329,21 +334,34 @@ private:
     return ID;
   }
 
-  void getBlock(File mFile, uint8_t *&block, int offset, int size) {
+  void getBlock(File mFile, uint8_t *block, int offset, int size) {
     // Entonces recorremos el TZX.
     //  La primera cabecera SIEMPRE debe darse.
-    readFileRange(mFile, block, offset, size, false);
+    if (_reader.isOpen()) {
+      _reader.read(offset, block, size);
+    } else {
+      readFileRange(mFile, block, offset, size, false);
+    }
   }
 
   bool verifyChecksum(File mFile, int offset, int size) {
     // Vamos a verificar que el bloque cumple con el checksum
     // Cogemos el checksum del bloque
     uint8_t chk = getBYTE(mFile, offset + size - 1);
+    uint8_t calcChk = 0;
 
-    uint8_t *block = (uint8_t *)ps_calloc(size + 1, sizeof(uint8_t));
-    getBlock(mFile, block, offset, size - 1);
-    uint8_t calcChk = calculateChecksum(block, 0, size - 1);
-    free(block);
+    if (_reader.isOpen()) {
+      // Directamente sobre la ventana de lectura
+      calcChk = _reader.checksum(offset, size - 1);
+    } else {
+      uint8_t chunk[GDB_STREAM_CHUNK];
+      for (int done = 0; done < size - 1;) {
+        int n = min(size - 1 - done, GDB_STREAM_CHUNK);
+        getBlock(mFile, chunk, offset + done, n);
+        calcChk = xorChecksum(chunk, n, calcChk);
+        done += n;
+      }
+    }
 
     if (chk == calcChk) {
       return true;
@@ -456,10 +474,8 @@ private:
         // {
         uint8_t *block = (uint8_t *)ps_calloc(19 + 1, sizeof(uint8_t));
         getBlock(mFile, block, _myTZX.descriptor[currentBlock].offsetData, 19);
+        // El nombre del programa lo publica applyParseResults() desde aqui
         gName = getNameFromStandardBlock(block);
-        PROGRAM_NAME = String(gName);
-        LAST_PROGRAM_NAME = PROGRAM_NAME;
-        PROGRAM_NAME_DETECTED = true;
         free(block);
         strncpy(_myTZX.descriptor[currentBlock].name, gName, 14);
         // }
@@ -772,7 +788,7 @@ private:
 
     // Reservamos memoria.
     _myTZX.descriptor[currentBlock].timming.pulse_seq_array =
-        (int *)ps_calloc(num_pulses + 1, sizeof(int));
+        parseArena.allocArray<int>(num_pulses + 1);
 
     // Tomamos ahora las longitudes
     int coff = currentOffset + 2;
@@ -1002,139 +1018,23 @@ private:
                    ? "RLE"
                    : "Z-RLE"));
 
-    int dataOffset = currentOffset + 16;
-    int compressedDataSize = _myTZX.descriptor[currentBlock].size - 15;
-    uint8_t *rleData = nullptr;
-    size_t rleDataSize = 0;
-    bool zrle_fallback_needed = false; // ✅ Flag para controlar el fallback
-
-    // 2. GESTIONAR LA COMPRESIÓN
-    if (_myTZX.descriptor[currentBlock].timming.csw_compression_type ==
-        2) // Z-RLE
-    {
-      logln("  - Z-RLE detected. Attempting decompression with miniz...");
-      uint8_t *zrle_buffer = (uint8_t *)ps_malloc(compressedDataSize);
-      if (!zrle_buffer) {
-        logln("ERROR: Failed to alloc Z-RLE buffer");
-        return;
-      }
-      mFile.seek(dataOffset);
-      mFile.read(zrle_buffer, compressedDataSize);
-
-      mz_ulong decompressed_size = compressedDataSize * 10; // Estimación segura
-      rleData = (uint8_t *)ps_malloc(decompressed_size);
-
-      if (rleData) {
-        int result = mz_uncompress(rleData, &decompressed_size, zrle_buffer,
-                                   compressedDataSize);
-
-        if (result == MZ_OK) {
-          rleDataSize = decompressed_size;
-          logln("  - Decompressed to " + String(rleDataSize) +
-                " bytes of RLE data.");
-          uint8_t *final_rle_data = (uint8_t *)ps_realloc(rleData, rleDataSize);
-          if (final_rle_data)
-            rleData = final_rle_data;
-        } else {
-          logln("ERROR: miniz decompression failed with code: " +
-                String(result));
-          free(rleData);
-          rleData = nullptr;
-          // ✅ Si el error es de datos, activamos el fallback a RLE simple
-          if (result == MZ_DATA_ERROR) {
-            logln("WARNING: Data error suggests this is not a valid ZLIB "
-                  "stream. Falling back to RLE mode.");
-            zrle_fallback_needed = true;
-          }
-        }
-      } else {
-        logln("ERROR: Failed to alloc initial RLE buffer");
-      }
-      free(zrle_buffer);
-    }
+    // Los datos se leen al reproducir (ver CSWStream). Aqui solo guardamos
+    // donde estan. Cabecera: longitud (4), pausa (2), sampling rate (3),
+    // compresion (1) y numero de pulsos (4)
+    _myTZX.descriptor[currentBlock].timming.csw_num_pulses =
+        getDWORD(mFile, currentOffset + 11);
+    _myTZX.descriptor[currentBlock].timming.csw_data_offset =
+        currentOffset + 15;
+    _myTZX.descriptor[currentBlock].timming.csw_data_size =
+        _myTZX.descriptor[currentBlock].size - 10;
 
-    // Si es RLE (Tipo 1) o si el Z-RLE falló y necesita fallback
-    if (_myTZX.descriptor[currentBlock].timming.csw_compression_type == 1 ||
-        zrle_fallback_needed) {
-      if (zrle_fallback_needed) {
-        logln("  - Executing fallback: Reading data as plain RLE.");
-        _myTZX.descriptor[currentBlock].playeable = false;
-      } else {
-        logln("  - RLE detected. Reading directly.");
-      }
-      rleDataSize = compressedDataSize;
-      rleData = (uint8_t *)ps_malloc(rleDataSize);
-      if (!rleData) {
-        logln("ERROR: Failed to alloc RLE buffer");
-        return;
-      }
-      mFile.seek(dataOffset);
-      mFile.read(rleData, rleDataSize);
-    }
+    logln("  - Stored pulses: " +
+          String(_myTZX.descriptor[currentBlock].timming.csw_num_pulses));
 
-    if (!rleData || rleDataSize == 0) {
+    if (_myTZX.descriptor[currentBlock].timming.csw_data_size <= 0) {
       logln("ERROR: No RLE data to process.");
-      if (rleData)
-        free(rleData);
-      return;
-    }
-
-    // 3. PARSEAR LOS DATOS RLE Y CREAR LA SECUENCIA DE PULSOS
-    // (El resto de la función no necesita cambios)
-    // ... (código de parseo de RLE existente) ...
-    int pulseCount = 0;
-    uint8_t last_pulse = 0;
-    for (size_t i = 0; i < rleDataSize;) {
-      pulseCount++;
-      uint8_t value = rleData[i];
-      if (value == 0x00) {
-        i += 2;
-      } else {
-        last_pulse = value;
-        i += 1;
-      }
-    }
-    logln("  - Found " + String(pulseCount) + " RLE pulse sequences.");
-
-    if (pulseCount > 0) {
-      _myTZX.descriptor[currentBlock].timming.csw_num_pulses = pulseCount;
-      _myTZX.descriptor[currentBlock].timming.csw_pulse_data =
-          (tRlePulse *)ps_calloc(pulseCount, sizeof(tRlePulse));
-
-      if (!_myTZX.descriptor[currentBlock].timming.csw_pulse_data) {
-        logln("ERROR: Failed to alloc RLE pulse array");
-        free(rleData);
-        return;
-      }
-
-      int currentPulse = 0;
-      last_pulse = 0;
-      for (size_t i = 0; i < rleDataSize && currentPulse < pulseCount;) {
-        uint8_t value = rleData[i];
-        if (value == 0x00) {
-          uint8_t repeat = rleData[i + 1];
-          _myTZX.descriptor[currentBlock]
-              .timming.csw_pulse_data[currentPulse]
-              .pulse_len = last_pulse;
-          _myTZX.descriptor[currentBlock]
-              .timming.csw_pulse_data[currentPulse]
-              .repeat = repeat;
-          i += 2;
-        } else {
-          last_pulse = value;
-          _myTZX.descriptor[currentBlock]
-              .timming.csw_pulse_data[currentPulse]
-              .pulse_len = last_pulse;
-          _myTZX.descriptor[currentBlock]
-              .timming.csw_pulse_data[currentPulse]
-              .repeat = 1;
-          i += 1;
-        }
-        currentPulse++;
-      }
+      _myTZX.descriptor[currentBlock].playeable = false;
     }
-
-    free(rleData);
   }
 
   void analyzeID25(File mFile, int currentOffset, int currentBlock) {
@@ -1168,132 +1068,136 @@ private:
     _myTZX.descriptor[currentBlock].pauseAfterThisBlock =
         (double)getWORD(mFile, currentOffset + 5);
 
+    // Tablas de simbolos. Solo los ID 0x19 llevan esta parte del descriptor
+    _myTZX.descriptor[currentBlock].symbol =
+        parseArena.allocArray<tSymbol>(1);
+    if (_myTZX.descriptor[currentBlock].symbol == nullptr) {
+      SerialHW.println("Error: Failed to allocate GDB symbol table");
+      return;
+    }
+    tSymbol &sym = *_myTZX.descriptor[currentBlock].symbol;
+
     // Leer TOTP (DWORD) - offset +7
-    _myTZX.descriptor[currentBlock].symbol.TOTP =
+    sym.TOTP =
         getDWORD(mFile, currentOffset + 7);
 
     // Leer NPP (BYTE) - offset +11
-    _myTZX.descriptor[currentBlock].symbol.NPP =
+    sym.NPP =
         getBYTE(mFile, currentOffset + 11);
 
     // Leer ASP (BYTE) - offset +12
-    _myTZX.descriptor[currentBlock].symbol.ASP =
+    sym.ASP =
         getBYTE(mFile, currentOffset + 12);
-    if (_myTZX.descriptor[currentBlock].symbol.ASP == 0)
-      _myTZX.descriptor[currentBlock].symbol.ASP = 256;
+    if (sym.ASP == 0)
+      sym.ASP = 256;
 
     // Leer TOTD (DWORD) - offset +13
-    _myTZX.descriptor[currentBlock].symbol.TOTD =
+    sym.TOTD =
         getDWORD(mFile, currentOffset + 13);
 
     // Leer NPD (BYTE) - offset +17
-    _myTZX.descriptor[currentBlock].symbol.NPD =
+    sym.NPD =
         getBYTE(mFile, currentOffset + 17);
 
     // Leer ASD (BYTE) - offset +18
-    _myTZX.descriptor[currentBlock].symbol.ASD =
+    sym.ASD =
         getBYTE(mFile, currentOffset + 18);
-    if (_myTZX.descriptor[currentBlock].symbol.ASD == 0)
-      _myTZX.descriptor[currentBlock].symbol.ASD = 256;
+    if (sym.ASD == 0)
+      sym.ASD = 256;
 
     // Los datos variables empiezan en offset +19
     int offset = currentOffset + 19;
 
     // Leer SYMDEF para pilot/sync si TOTP > 0
-    if (_myTZX.descriptor[currentBlock].symbol.TOTP > 0) {
-      _myTZX.descriptor[currentBlock].symbol.symDefPilot = (tSymDef *)ps_calloc(
-          _myTZX.descriptor[currentBlock].symbol.ASP, sizeof(tSymDef));
-      if (_myTZX.descriptor[currentBlock].symbol.symDefPilot == NULL) {
+    if (sym.TOTP > 0) {
+      sym.symDefPilot = parseArena.allocArray<tSymDef>(sym.ASP);
+      if (sym.symDefPilot == NULL) {
         SerialHW.println("Error: Failed to allocate symDefPilot");
         return;
       }
-      for (int i = 0; i < _myTZX.descriptor[currentBlock].symbol.ASP; i++) {
+      for (int i = 0; i < sym.ASP; i++) {
         if (offset + 1 > maxOffset) {
           SerialHW.println(
               "Error: Offset out of bounds in symDefPilot symbolFlag");
           return;
         }
-        _myTZX.descriptor[currentBlock].symbol.symDefPilot[i].symbolFlag =
+        sym.symDefPilot[i].symbolFlag =
             getBYTE(mFile, offset);
         offset += 1;
-        _myTZX.descriptor[currentBlock].symbol.symDefPilot[i].pulse_array =
-            (int *)ps_calloc(_myTZX.descriptor[currentBlock].symbol.NPP,
-                             sizeof(int));
-        if (_myTZX.descriptor[currentBlock].symbol.symDefPilot[i].pulse_array ==
+        sym.symDefPilot[i].pulse_array =
+            parseArena.allocArray<int>(sym.NPP);
+        if (sym.symDefPilot[i].pulse_array ==
             NULL) {
           SerialHW.println(
               "Error: Failed to allocate pulse_array for symDefPilot");
           return;
         }
-        for (int j = 0; j < _myTZX.descriptor[currentBlock].symbol.NPP; j++) {
+        for (int j = 0; j < sym.NPP; j++) {
           if (offset + 2 > maxOffset) {
             SerialHW.println(
                 "Error: Offset out of bounds in symDefPilot pulse_array");
             return;
           }
-          _myTZX.descriptor[currentBlock].symbol.symDefPilot[i].pulse_array[j] =
+          sym.symDefPilot[i].pulse_array[j] =
               getWORD(mFile, offset);
           offset += 2;
         }
       }
 
       // Leer PRLE para pilot/sync
-      _myTZX.descriptor[currentBlock].symbol.pilotStream = (tPrle *)ps_calloc(
-          _myTZX.descriptor[currentBlock].symbol.TOTP, sizeof(tPrle));
-      if (_myTZX.descriptor[currentBlock].symbol.pilotStream == NULL) {
+      sym.pilotStream = parseArena.allocArray<tPrle>(sym.TOTP);
+      if (sym.pilotStream == NULL) {
         SerialHW.println("Error: Failed to allocate pilotStream");
         return;
       }
-      for (int i = 0; i < _myTZX.descriptor[currentBlock].symbol.TOTP; i++) {
+      for (int i = 0; i < sym.TOTP; i++) {
         if (offset + 1 > maxOffset) {
           SerialHW.println("Error: Offset out of bounds in pilotStream symbol");
           return;
         }
-        _myTZX.descriptor[currentBlock].symbol.pilotStream[i].symbol =
+        sym.pilotStream[i].symbol =
             getBYTE(mFile, offset);
         offset += 1;
         if (offset + 2 > maxOffset) {
           SerialHW.println("Error: Offset out of bounds in pilotStream repeat");
           return;
         }
-        _myTZX.descriptor[currentBlock].symbol.pilotStream[i].repeat =
+        sym.pilotStream[i].repeat =
             getWORD(mFile, offset);
         offset += 2;
       }
     }
 
     // Leer SYMDEF para data
-    _myTZX.descriptor[currentBlock].symbol.symDefData = (tSymDef *)ps_calloc(
-        _myTZX.descriptor[currentBlock].symbol.ASD, sizeof(tSymDef));
-    if (_myTZX.descriptor[currentBlock].symbol.symDefData == NULL) {
+    sym.symDefData = parseArena.allocArray<tSymDef>(sym.ASD);
+    if (sym.symDefData == NULL) {
       SerialHW.println("Error: Failed to allocate symDefData");
       return;
     }
-    for (int i = 0; i < _myTZX.descriptor[currentBlock].symbol.ASD; i++) {
+    for (int i = 0; i < sym.ASD; i++) {
       if (offset + 1 > maxOffset) {
         SerialHW.println(
             "Error: Offset out of bounds in symDefData symbolFlag");
         return;
       }
-      _myTZX.descriptor[currentBlock].symbol.symDefData[i].symbolFlag =
+      sym.symDefData[i].symbolFlag =
           getBYTE(mFile, offset);
       offset += 1;
-      _myTZX.descriptor[currentBlock].symbol.symDefData[i].pulse_array =
-          (int *)ps_calloc(_myTZX.descriptor[currentBlock].symbol.NPD,
-                           sizeof(int));
-      if (_myTZX.descriptor[currentBlock].symbol.symDefData[i].pulse_array ==
+      sym.symDefData[i].pulse_array =
+          parseArena.allocArray<int>(sym.NPD);
+      if (sym.symDefData[i].pulse_array ==
           NULL) {
         SerialHW.println(
             "Error: Failed to allocate pulse_array for symDefData");
         return;
       }
-      for (int j = 0; j < _myTZX.descriptor[currentBlock].symbol.NPD; j++) {
+      for (int j = 0; j < sym.NPD; j++) {
         if (offset + 2 > maxOffset) {
           SerialHW.println(
               "Error: Offset out of bounds in symDefData pulse_array");
           return;
         }
-        _myTZX.descriptor[currentBlock].symbol.symDefData[i].pulse_array[j] =
+        sym.symDefData[i].pulse_array[j] =
             getWORD(mFile, offset);
         offset += 2;
       }
@@ -1301,38 +1205,33 @@ private:
 
     // Calcular NB = ceil(Log2(ASD))
     int NB = 0;
-    int temp = _myTZX.descriptor[currentBlock].symbol.ASD;
+    int temp = sym.ASD;
     while (temp > 1) {
       temp >>= 1;
       NB++;
     }
-    if ((1 << NB) < _myTZX.descriptor[currentBlock].symbol.ASD)
+    if ((1 << NB) < sym.ASD)
       NB++;
 
     // Calcular DS = ceil(NB * TOTD / 8)
-    int DS = ((NB * _myTZX.descriptor[currentBlock].symbol.TOTD) + 7) / 8;
+    int DS = ((NB * sym.TOTD) + 7) / 8;
 
-    // Leer data stream
-    _myTZX.descriptor[currentBlock].symbol.dataStream =
-        (uint8_t *)ps_calloc(DS, sizeof(uint8_t));
-    if (_myTZX.descriptor[currentBlock].symbol.dataStream == NULL) {
-      SerialHW.println("Error: Failed to allocate dataStream");
-      return;
-    }
-    // The data stream is at the end of the block
+    // El data stream ocupa los últimos DS bytes del bloque. No se lee
+    // ahora: ZXProcessor::playGDB() lo va leyendo al reproducir
     // El bloque termina en: currentOffset + 1 + 4 + blockLength
-    // El dataStream ocupa los últimos DS bytes del bloque
     int dataStreamOffset = currentOffset + 1 + 4 + blockLength - DS;
-    for (int i = 0; i < DS; i++) {
-      _myTZX.descriptor[currentBlock].symbol.dataStream[i] =
-          getBYTE(mFile, dataStreamOffset + i);
-    }
 
     // Guardar offsets
     // Los SYMDEF/PRLE empiezan en offset +19
-    _myTZX.descriptor[currentBlock].symbol.offsetPilotDataStream =
+    sym.offsetPilotDataStream =
         currentOffset + 19;
-    _myTZX.descriptor[currentBlock].symbol.offsetDataStream = dataStreamOffset;
+    sym.offsetDataStream = dataStreamOffset;
+
+    // Plantillas de flancos de los símbolos. Se generan aquí, en la tarea
+    // del analizador, que es la única que reserva de la arena
+    if (!_zxp.prepareGDB(&sym)) {
+      SerialHW.println("Error: Failed to build GDB symbol templates");
+    }
 
     // Esto es para que tome los bloques como especiales
     _myTZX.descriptor[currentBlock].type = 99;
@@ -1349,6 +1248,12 @@ private:
     // Obtenemos el valor de la pausa
     _myTZX.descriptor[currentBlock].pauseAfterThisBlock =
         getWORD(mFile, currentOffset + 1);
+
+#ifdef DEBUGMODE
+    log("ID 0x20 - PAUSE / STOP TAPE");
+    log("-- value: " +
+        String(_myTZX.descriptor[currentBlock].pauseAfterThisBlock));
+#endif
   }
 
   void analyzeID40(File mFile, int currentOffset, int currentBlock) {
@@ -1456,8 +1361,8 @@ private:
     _myTZX.descriptor[currentBlock].ID = 33;
     _myTZX.descriptor[currentBlock].playeable = false;
     _myTZX.descriptor[currentBlock].offset = currentOffset + 2;
-    _myTZX.descriptor[currentBlock].group = MULTIGROUP_COUNT;
-    MULTIGROUP_COUNT++;
+    _myTZX.descriptor[currentBlock].group = _groupCount;
+    _groupCount++;
 
     // Tomamos el tamaño del nombre del Grupo
     sizeTextInformation = getBYTE(mFile, currentOffset + 1);
@@ -1471,7 +1376,7 @@ private:
 
     uint8_t *grpN =
         (uint8_t *)ps_calloc(sizeTextInformation + 5, sizeof(uint8_t));
-    readFileRange(mFile, grpN, currentOffset + 2, sizeTextInformation, false);
+    getBlock(mFile, grpN, currentOffset + 2, sizeTextInformation);
     char groupName[32];
     // Limpiamos de basura todo el buffer
     strcpy(groupName, "                             ");
@@ -1585,732 +1490,659 @@ private:
     _myTZX.descriptor[currentBlock].type = 99;
   }
 
-  void analyzeBlockUnknow(int id_num, int currentOffset, int currentBlock) {
-    _myTZX.descriptor[currentBlock].ID = id_num;
+  // ---------------------------------------------------------------------
+  // Bloques no reproducibles que solo guardan un campo o nada
+  // ---------------------------------------------------------------------
+
+  void analyzeNoData(File mFile, int currentOffset, int currentBlock) {
+    // 0x22 Group end, 0x27 Return, 0x2A Stop 48K, 0x5A Glue
     _myTZX.descriptor[currentBlock].playeable = false;
     _myTZX.descriptor[currentBlock].offset = currentOffset;
   }
 
-  bool getTZXBlock(File mFile, int currentBlock, int currentID,
-                   int currentOffset, int &nextIDoffset) {
-    bool res = true;
-
-    // Inicializamos el descriptor
-    _myTZX.descriptor[currentBlock].group = 0;
-    _myTZX.descriptor[currentBlock].chk = 0;
-    _myTZX.descriptor[currentBlock].delay = 1000;
-    _myTZX.descriptor[currentBlock].hasMaskLastByte = false;
-    _myTZX.descriptor[currentBlock].header = false;
-    _myTZX.descriptor[currentBlock].ID = 0;
-    _myTZX.descriptor[currentBlock].lengthOfData = 0;
-    _myTZX.descriptor[currentBlock].loop_count = 0;
-    _myTZX.descriptor[currentBlock].maskLastByte = 8;
-    _myTZX.descriptor[currentBlock].nameDetected = false;
-    _myTZX.descriptor[currentBlock].offset = 0;
-    _myTZX.descriptor[currentBlock].jump_this_ID = false;
-    _myTZX.descriptor[currentBlock].signalLvl = false;
-
-    switch (currentID) {
-    // ID 10 - Standard Speed Data Block
-    case 16:
-
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID16(mFile, currentOffset, currentBlock);
-        nextIDoffset = currentOffset + _myTZX.descriptor[currentBlock].size + 5;
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID10STR, 35);
-      } else {
-        res = false;
-      }
-      break;
+  void analyzeID35(File mFile, int currentOffset, int currentBlock) {
+    // Jump to block. Relativo a este bloque y con signo. El destino lo
+    // resuelve tapeNav
+    analyzeNoData(mFile, currentOffset, currentBlock);
+    _myTZX.descriptor[currentBlock].jump_relative =
+        (int16_t)getWORD(mFile, currentOffset + 1);
+  }
 
-    // ID 11- Turbo Speed Data Block
-    case 17:
+  void analyzeID36(File mFile, int currentOffset, int currentBlock) {
+    // Loop start
+    analyzeNoData(mFile, currentOffset, currentBlock);
+    _myTZX.descriptor[currentBlock].loop_count =
+        getWORD(mFile, currentOffset + 1);
 
-      // TIMMING_STABLISHED = true;
+#ifdef DEBUGMODE
+    log("LOOP GET: " + String(_myTZX.descriptor[currentBlock].loop_count));
+#endif
+  }
 
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID17(mFile, currentOffset, currentBlock);
-        nextIDoffset =
-            currentOffset + _myTZX.descriptor[currentBlock].size + 19;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 11 - Speed block";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID11STR, 35);
+  void analyzeID37(File mFile, int currentOffset, int currentBlock) {
+    // Loop end. Los limites del bucle los lleva la reproduccion
+    analyzeNoData(mFile, currentOffset, currentBlock);
+  }
 
-      } else {
-        res = false;
+  void analyzeID38(File mFile, int currentOffset, int currentBlock) {
+    // Call sequence
+    analyzeNoData(mFile, currentOffset, currentBlock);
+
+    uint16_t num_calls = getWORD(mFile, currentOffset + 1);
+    _myTZX.descriptor[currentBlock].call_sequence_count = num_calls;
+
+    if (num_calls > 0) {
+      _myTZX.descriptor[currentBlock].call_sequence_array =
+          parseArena.allocArray<uint16_t>(num_calls);
+      if (_myTZX.descriptor[currentBlock].call_sequence_array) {
+        int data_offset = currentOffset + 3;
+        for (int i = 0; i < num_calls; i++) {
+          _myTZX.descriptor[currentBlock].call_sequence_array[i] =
+              getWORD(mFile, data_offset + (i * 2));
+        }
       }
-      break;
+    }
 
-    // ID 12 - Pure Tone
-    case 18:
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID18(mFile, currentOffset, currentBlock);
-        nextIDoffset = currentOffset + _myTZX.descriptor[currentBlock].size + 1;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 12 - Pure tone";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID12STR, 35);
+    // El tamaño del bloque es 2 (count) + count * 2 (array), sin el ID
+    _myTZX.descriptor[currentBlock].size = 2 + (num_calls * 2);
+  }
 
-      } else {
-        res = false;
-      }
-      break;
+  void analyzeID43(File mFile, int currentOffset, int currentBlock) {
+    // Set signal level
+    int signalLevel = getBYTE(mFile, currentOffset + 5);
+    _myTZX.descriptor[currentBlock].size = 5;
+    _myTZX.descriptor[currentBlock].offset = currentOffset + 6;
+    _myTZX.descriptor[currentBlock].playeable = false;
 
-    // ID 13 - Pulse sequence
-    case 19:
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID19(mFile, currentOffset, currentBlock);
-        nextIDoffset = currentOffset + _myTZX.descriptor[currentBlock].size + 1;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 13 - Pulse seq.";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID13STR, 35);
+    // Inversion de señal. Se aplica al reproducir el bloque
+    _myTZX.descriptor[currentBlock].signalLvl = signalLevel;
+  }
 
-      } else {
-        res = false;
+  // ---------------------------------------------------------------------
+  // Tabla de bloques
+  //
+  // Cada ID tiene su analizador y la forma de llegar al siguiente bloque:
+  //   siguiente = offset + fixed (+ size o + lengthOfData del descriptor)
+  // TZX, TSX (MSX) y CDT (Amstrad) comparten la tabla. "dialects" dice en
+  // que variantes es estandar el bloque.
+  // ---------------------------------------------------------------------
+
+  enum tNextBy : uint8_t { NEXT_FIXED, NEXT_SIZE, NEXT_LENGTH };
+
+  typedef void (TZXprocessor::*tAnalyzeFn)(File, int, int);
+
+  struct tTZXBlockHandler {
+    uint8_t id;
+    tAnalyzeFn analyze;
+    tNextBy nextBy;
+    uint8_t fixed;
+    bool info; // Los bloques de control de flujo pueden saltarlo
+    uint8_t dialects;
+    const char *typeName;
+  };
+
+  static uint8_t dialectOf(const char *path) {
+    String ext = String(path);
+    ext.toUpperCase();
+    if (ext.endsWith(".TSX")) {
+      return DIALECT_TSX;
+    } else if (ext.endsWith(".CDT")) {
+      return DIALECT_CDT;
+    }
+    return DIALECT_TZX;
+  }
+
+  static const tTZXBlockHandler *findBlockHandler(int id) {
+    static const tTZXBlockHandler handlers[] = {
+        {0x10, &TZXprocessor::analyzeID16, NEXT_SIZE, 5, false, DIALECT_ALL,
+         "ID 10 - Standard block            "},
+        {0x11, &TZXprocessor::analyzeID17, NEXT_SIZE, 19, false, DIALECT_ALL,
+         "ID 11 - Speed block               "},
+        {0x12, &TZXprocessor::analyzeID18, NEXT_SIZE, 1, false, DIALECT_ALL,
+         "ID 12 - Pure tone                 "},
+        {0x13, &TZXprocessor::analyzeID19, NEXT_SIZE, 1, false, DIALECT_ALL,
+         "ID 13 - Pulse seq.                "},
+        {0x14, &TZXprocessor::analyzeID20, NEXT_SIZE, 11, false, DIALECT_ALL,
+         "ID 14 - Pure data                 "},
+        {0x15, &TZXprocessor::analyzeID21, NEXT_LENGTH, 9, false, DIALECT_ALL,
+         "ID 15 - Direct recording          "},
+        {0x18, &TZXprocessor::analyzeID24, NEXT_SIZE, 5, false, DIALECT_ALL,
+         "ID 18 - CSW recording             "},
+        {0x19, &TZXprocessor::analyzeID25, NEXT_SIZE, 5, false, DIALECT_ALL,
+         "ID 19 - GDB                       "},
+        {0x20, &TZXprocessor::analyzeID32, NEXT_FIXED, 3, false, DIALECT_ALL,
+         "ID 20 - Pause or Stop             "},
+        {0x21, &TZXprocessor::analyzeID33, NEXT_SIZE, 2, true, DIALECT_ALL,
+         "ID 21 - Group start               "},
+        {0x22, &TZXprocessor::analyzeNoData, NEXT_FIXED, 1, true, DIALECT_ALL,
+         "ID 22 - Group end                 "},
+        {0x23, &TZXprocessor::analyzeID35, NEXT_FIXED, 3, false, DIALECT_ALL,
+         "ID 23 - Jump to block             "},
+        {0x24, &TZXprocessor::analyzeID36, NEXT_FIXED, 3, false, DIALECT_ALL,
+         "ID 24 - Loop start                "},
+        {0x25, &TZXprocessor::analyzeID37, NEXT_FIXED, 1, false, DIALECT_ALL,
+         "ID 25 - Loop end                  "},
+        {0x26, &TZXprocessor::analyzeID38, NEXT_SIZE, 1, false, DIALECT_ALL,
+         "ID 26 - Call sequence             "},
+        {0x27, &TZXprocessor::analyzeNoData, NEXT_FIXED, 1, false, DIALECT_ALL,
+         "ID 27 - Return from sequence      "},
+        {0x28, &TZXprocessor::analyzeID40, NEXT_SIZE, 1, false, DIALECT_ALL,
+         "ID 28 - Select block              "},
+        {0x2A, &TZXprocessor::analyzeNoData, NEXT_FIXED, 1, false, DIALECT_ALL,
+         "ID 2A - Stop TAPE (48k mode)      "},
+        {0x2B, &TZXprocessor::analyzeID43, NEXT_FIXED, 6, false, DIALECT_ALL,
+         "ID 2B - Set signal level          "},
+        {0x30, &TZXprocessor::analyzeID48, NEXT_SIZE, 1, true, DIALECT_ALL,
+         "Information block                 "},
+        {0x31, &TZXprocessor::analyzeID49, NEXT_SIZE, 2, true, DIALECT_ALL,
+         "Information block                 "},
+        {0x32, &TZXprocessor::analyzeID50, NEXT_SIZE, 3, true, DIALECT_ALL,
+         "Information block                 "},
+        {0x33, &TZXprocessor::analyzeID51, NEXT_SIZE, 3, true, DIALECT_ALL,
+         "Information block                 "},
+        {0x35, &TZXprocessor::analyzeID53, NEXT_SIZE, 0x15, true, DIALECT_ALL,
+         "Information block                 "},
+        {0x4B, &TZXprocessor::analyzeID75, NEXT_SIZE, 17, false, DIALECT_TSX,
+         "ID 4B - TSX Block                 "},
+        {0x5A, &TZXprocessor::analyzeNoData, NEXT_FIXED, 8, false, DIALECT_ALL,
+         "ID 5A - Glue block                "},
+    };
+
+    for (const tTZXBlockHandler &h : handlers) {
+      if (h.id == id) {
+        return &h;
       }
-      break;
+    }
+    return nullptr;
+  }
+
+  bool getTZXBlock(File mFile, int currentBlock, int currentID,
+                   int currentOffset, int &nextIDoffset) {
 
-    // ID 14 - Pure Data Block
-    case 20:
+    const tTZXBlockHandler *h = findBlockHandler(currentID);
+    if (h == nullptr) {
+#ifdef DEBUGMODE
+      Serial.print("ID unknow 0x");
+      Serial.println(currentID, HEX);
+#endif
+      // Si no está implementado, salimos
+      ID_NOT_IMPLEMENTED = true;
+      return false;
+    }
 
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID20(mFile, currentOffset, currentBlock);
+    if (_myTZX.descriptor == nullptr) {
+      return false;
+    }
 
-        nextIDoffset =
-            currentOffset + _myTZX.descriptor[currentBlock].size + 10 + 1;
+    tTZXBlockDescriptor &d = _myTZX.descriptor[currentBlock];
 
-        //"ID 14 - Pure Data block";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID14STR, 35);
+    // Inicializamos el descriptor
+    d.group = 0;
+    d.chk = 0;
+    d.delay = 1000;
+    d.hasMaskLastByte = false;
+    d.header = false;
+    d.lengthOfData = 0;
+    d.loop_count = 0;
+    d.maskLastByte = 8;
+    d.nameDetected = false;
+    d.offset = 0;
+    d.jump_this_ID = false;
+    d.signalLvl = false;
+    d.ID = currentID;
+
+    if ((h->dialects & _dialect) == 0) {
+      // Se reproduce igual, pero no es de esta variante
+      logln("Warning: ID 0x" + String(currentID, HEX) +
+            " is not standard in this file type");
+    }
 
-      } else {
-        res = false;
-      }
-      break;
+    (this->*(h->analyze))(mFile, currentOffset, currentBlock);
 
-    // ID 15 - Direct Recording
-    case 21:
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID21(mFile, currentOffset, currentBlock);
+    nextIDoffset = currentOffset + h->fixed;
+    if (h->nextBy == NEXT_SIZE) {
+      nextIDoffset += d.size;
+    } else if (h->nextBy == NEXT_LENGTH) {
+      nextIDoffset += d.lengthOfData;
+    }
 
-        nextIDoffset = currentOffset +
-                       _myTZX.descriptor[currentBlock].lengthOfData + 8 + 1;
-        logln("Next ID offset: 0x" + String(nextIDoffset, HEX));
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID15STR, 35);
+    strncpy(d.typeName, h->typeName, 35);
+    if (h->info) {
+      d.jump_this_ID = true;
+    }
 
-        // Informacion minima del fichero
-        // PROGRAM_NAME = "Audio block (WAV)";
-        LAST_SIZE = _myTZX.descriptor[currentBlock].size;
+    // Duracion y checksum con los datos aun en la ventana
+    d.durationTStates = blockTStates(mFile, d);
 
 #ifdef DEBUGMODE
-        log("ID 0x21 - DIRECT RECORDING");
+    if (h->nextBy == NEXT_LENGTH || currentID == 0x19) {
+      logln("Next ID offset: 0x" + String(nextIDoffset, HEX));
+    }
 #endif
-      } else {
-        res = false;
-      }
-      break;
+    return true;
+  }
 
-    // ID 18 - CSW Recording
-    case 24:
-      if (_myTZX.descriptor != nullptr) {
-        analyzeID24(mFile, currentOffset, currentBlock);
-        // ✅ CÁLCULO DE OFFSET CORREGIDO
-        // El siguiente bloque empieza después del ID (1), el campo de tamaño
-        // (4) y el tamaño de los datos.
-        nextIDoffset =
-            currentOffset + 1 + 4 + _myTZX.descriptor[currentBlock].size;
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID18STR, 35);
-      } else {
-        res = false;
-      }
-      break;
+  void getBlockDescriptor(File mFile, int sizeTZX, bool hasGroupBlocks) {
+    // Para ello tenemos que ir leyendo el TZX poco a poco
+    // Detectaremos los IDs a partir del byte 9 (empezando por offset = 0)
+    // Cada bloque empieza por un ID menos el primero
+    // que empieza por ZXTape!
+    // Ejemplo ID + bytes
+    //
+    int startOffset = 10; // Posición del primero ID, pero el offset
+                          // 0x00 de cada ID, sería el siguiente
+    int currentID = 0;
+    int nextIDoffset = 0;
+    int currentOffset = 0;
+    int lenghtDataBlock = 0;
+    int currentBlock = 1;
+    bool endTZX = false;
+    bool forzeEnd = false;
+    bool endWithErrors = false;
+    uint64_t totalTStates = 0;
 
-    // ID 19 - Generalized Data Block
-    case 25:
-      // ID_NOT_IMPLEMENTED = true;
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID25(mFile, currentOffset, currentBlock);
-        // Posición del siguiente bloque en el TZX
-        nextIDoffset =
-            currentOffset + _myTZX.descriptor[currentBlock].size + 4 + 1;
-        logln("Next ID offset: 0x" + String(nextIDoffset, HEX));
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID19STR, 35);
-      } else {
-        res = false;
-      }
-      break;
+    currentOffset = startOffset;
 
-    // ID 20 - Pause and Stop Tape
-    case 32:
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID32(mFile, currentOffset, currentBlock);
+    // Inicializamos
+    ID_NOT_IMPLEMENTED = false;
 
-        nextIDoffset = currentOffset + 3;
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID20STR, 35);
+    // Las cabeceras se leen en una sola pasada a traves de la ventana.
+    // Si no hay PSRAM para ella, se lee campo a campo como antes.
+    if (!_reader.begin(mFile)) {
+      logln("Warning: no memory for read-ahead window");
+    }
 
+// Le pasamos el path del fichero, la extension se le asigna despues en
+// la funcion createBlockDescriptorFile
+// _blDscTZX.createBlockDescriptorFileTZX();
 #ifdef DEBUGMODE
-        log("ID 0x20 - PAUSE / STOP TAPE");
-        log("-- value: " +
-            String(_myTZX.descriptor[currentBlock].pauseAfterThisBlock));
+    logln("Creating DSC file");
+    logln("Status of endTZX: " + String(endTZX));
+    logln("Status of forzeEnd: " + String(forzeEnd));
+    logln("Status of ID_NOT_IMPLEMENTED: " + String(ID_NOT_IMPLEMENTED));
 #endif
-      } else {
-        res = false;
-      }
-      break;
 
-    // ID 21 - Group start
-    case 33:
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID33(mFile, currentOffset, currentBlock);
-
-        nextIDoffset = currentOffset + 2 + _myTZX.descriptor[currentBlock].size;
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID21STR, 35);
+    while (!endTZX && !forzeEnd && !ID_NOT_IMPLEMENTED) {
 
-        // Esto le indica a los bloque de control de flujo que puede saltarse
-        _myTZX.descriptor[currentBlock].jump_this_ID = true;
+      if (cancelRequested()) {
+        _parseCancelled = true;
+        forzeEnd = true;
+        endWithErrors = true;
+        _parseMessage = "Aborting. No proccess complete.";
 
-        //_myTZX.descriptor[currentBlock].typeName = "ID 21 - Group start";
-      } else {
-        res = false;
+#ifdef DEBUGMODE
+        Serial.println("Aborting TZX reading");
+#endif
       }
-      break;
-
-    // ID 22 - Group end
-    case 34:
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        _myTZX.descriptor[currentBlock].ID = 34;
-        _myTZX.descriptor[currentBlock].playeable = false;
-        _myTZX.descriptor[currentBlock].offset = currentOffset;
 
-        nextIDoffset = currentOffset + 1;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 22 - Group end";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID22STR, 35);
-
-        // Esto le indica a los bloque de control de flujo que puede saltarse
-        _myTZX.descriptor[currentBlock].jump_this_ID = true;
+      // La tabla crece con el fichero. Siempre dejamos un descriptor
+      // vacio detras del ultimo bloque
+      if (!growDescriptorTable(currentBlock + 2)) {
+#ifdef DEBUGMODE
+        SerialHW.println("Error. TZX not possible to allocate in memory");
+#endif
 
-      } else {
-        res = false;
+        _parseMessage = "Error. Not enough memory for TZX/TSX/CDT";
+        endTZX = true;
+        endBlockScan();
+        // Salimos
+        return;
       }
-      break;
-
-    // ID 23 - Jump to block
-    case 35:
-      ID_NOT_IMPLEMENTED = true;
-      // analyzeBlockUnknow(currentID,currentOffset, currentBlock);
-      nextIDoffset = currentOffset + 2 + 1;
-
-      // _myTZX.descriptor[currentBlock].typeName = "ID 23 - Jump to block";
-      strncpy(_myTZX.descriptor[currentBlock].typeName, ID23STR, 35);
-      res = false;
-      break;
 
-    // ID 24 - Loop start
-    case 36:
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        _myTZX.descriptor[currentBlock].ID = 36;
-        _myTZX.descriptor[currentBlock].playeable = false;
-        _myTZX.descriptor[currentBlock].offset = currentOffset;
-        _myTZX.descriptor[currentBlock].loop_count =
-            getWORD(mFile, currentOffset + 1);
+      // El objetivo es ENCONTRAR IDs y ultimo byte, y analizar el bloque
+      // completo para el descriptor.
+      currentID = getID(mFile, currentOffset);
 
-#ifdef DEBUGMODE
-        log("LOOP GET: " + String(_myTZX.descriptor[currentBlock].loop_count));
-#endif
+      // Por defecto el bloque no es reproducible
+      _myTZX.descriptor[currentBlock].playeable = false;
 
-        nextIDoffset = currentOffset + 3;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 24 - Loop start";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID24STR, 35);
+      // Ahora dependiendo del ID analizamos. Los ID están en HEX
+      // y la rutina devolverá la posición del siguiente ID, así hasta
+      // completar todo el fichero
 
+      if (getTZXBlock(mFile, currentBlock, currentID, currentOffset,
+                      nextIDoffset)) {
+        // Copiamos la estructura del bloque, apuntando a ella
+        tTZXBlockDescriptor t = _myTZX.descriptor[currentBlock];
+        // Agregamos la informacion del bloque al fichero del descriptor .dsc
+        //_blDscTZX.putBlocksDescriptorTZX(dscFile,
+        // currentBlock,t,sizeTZX,hasGroupBlocks);
+        totalTStates += t.durationTStates;
+        // Incrementamos el bloque
+        currentBlock++;
+        publishBlocks(currentBlock);
       } else {
-        res = false;
+        _parseMessage = "ID block not implemented. Aborting";
+        forzeEnd = true;
+        endWithErrors = true;
       }
-      break;
-
-    // ID 25 - Loop end
-    case 37:
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        _myTZX.descriptor[currentBlock].ID = 37;
-        _myTZX.descriptor[currentBlock].playeable = false;
-        _myTZX.descriptor[currentBlock].offset = currentOffset;
-        LOOP_END = currentOffset;
 
-        nextIDoffset = currentOffset + 1;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 25 - Loop end";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID25STR, 35);
+      if (nextIDoffset >= sizeTZX) {
+        // Finalizamos
+        endTZX = true;
+        logln("END TZX analying");
 
       } else {
-        res = false;
+        currentOffset = nextIDoffset;
       }
-      break;
+    }
+    // Al terminar nos posicionamos en el bloque 1, salvo que ya se este
+    // reproduciendo (lo hace finishParseResults())
+    _parseEndedWhilePlaying = (LOADING_STATE == 1);
 
-    // ID 26 - Call sequence
-    case 38: {
-      ID_NOT_IMPLEMENTED = true;
+    _myTZX.numBlocks = currentBlock;
+    _myTZX.size = sizeTZX;
 
-      _myTZX.descriptor[currentBlock].ID = 38; // 0x26
-      _myTZX.descriptor[currentBlock].playeable = false;
-      _myTZX.descriptor[currentBlock].offset = currentOffset;
-
-      uint16_t num_calls = getWORD(mFile, currentOffset + 1);
-      _myTZX.descriptor[currentBlock].call_sequence_count = num_calls;
-
-      if (num_calls > 0) {
-        _myTZX.descriptor[currentBlock].call_sequence_array =
-            (uint16_t *)ps_calloc(num_calls, sizeof(uint16_t));
-        if (_myTZX.descriptor[currentBlock].call_sequence_array) {
-          int data_offset = currentOffset + 3;
-          for (int i = 0; i < num_calls; i++) {
-            _myTZX.descriptor[currentBlock].call_sequence_array[i] =
-                getWORD(mFile, data_offset + (i * 2));
-          }
-        }
-      }
+    _parseAborted = endWithErrors || ID_NOT_IMPLEMENTED;
+    logln("Block durations: " +
+          String((uint32_t)(totalTStates / (uint64_t)DfreqCPU)) +
+          " s of signal");
 
-      // El tamaño del bloque es 1 (ID) + 2 (count) + count * 2 (array)
-      _myTZX.descriptor[currentBlock].size = 2 + (num_calls * 2);
-      // analyzeBlockUnknow(currentID,currentOffset, currentBlock);
-      nextIDoffset = currentOffset + _myTZX.descriptor[currentBlock].size + 1;
+    endBlockScan();
+  }
 
-      // _myTZX.descriptor[currentBlock].typeName = "ID 26 - Call seq.";
-      strncpy(_myTZX.descriptor[currentBlock].typeName, ID26STR, 35);
-      res = false;
-      break;
+  uint64_t pauseTStates(double ms) {
+    // Igual que ZXProcessor::silence()
+    if (ms <= 0) {
+      return 0;
     }
-    // ID 27 - Return from sequence
-    case 39:
-      ID_NOT_IMPLEMENTED = true;
-      // analyzeBlockUnknow(currentID,currentOffset, currentBlock);
-      nextIDoffset = currentOffset + 1;
+    uint64_t t = (uint64_t)(ms * (DfreqCPU / 1000.0) + 0.5);
+    if (ms >= 1000) {
+      t += (uint64_t)(SILENCE_COMPENSATION_48K * DfreqCPU);
+    }
+    return t;
+  }
 
-      // _myTZX.descriptor[currentBlock].typeName = "ID 27 - Return from seq.";
-      strncpy(_myTZX.descriptor[currentBlock].typeName, ID27STR, 35);
-      res = false;
-      break;
+  uint32_t countOnes(File mFile, int offset, int len, int lastBits,
+                     uint8_t *chk = nullptr) {
+    // Bits a 1 de los datos tal y como se envian: del ultimo byte solo los
+    // "lastBits" de mas peso. Con "chk" se devuelve tambien el XOR de todos
+    // los bytes. Se llama al describir el bloque, asi que con la ventana los
+    // datos se recorren en la misma pasada que las cabeceras
+    uint32_t ones = 0;
+    uint8_t last = 0;
+    uint8_t x = 0;
+
+    if (len <= 0) {
+      return 0;
+    }
+
+    if (_reader.isOpen()) {
+      x = _reader.checksum(offset, len, &ones);
+      last = _reader.getBYTE(offset + len - 1);
+    } else {
+      uint8_t chunk[GDB_STREAM_CHUNK];
+      for (int done = 0; done < len;) {
+        int n = min(len - done, GDB_STREAM_CHUNK);
+        getBlock(mFile, chunk, offset + done, n);
+        for (int k = 0; k < n; k++) {
+          ones += __builtin_popcount(chunk[k]);
+        }
+        x = xorChecksum(chunk, n, x);
+        last = chunk[n - 1];
+        done += n;
+      }
+    }
 
-    // ID 28 - Select block
-    case 40:
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID40(mFile, currentOffset, currentBlock);
+    if (lastBits < 8) {
+      ones -= __builtin_popcount(last & ((1 << (8 - lastBits)) - 1));
+    }
+    if (chk != nullptr) {
+      *chk = x;
+    }
+    return ones;
+  }
 
-        nextIDoffset = currentOffset + _myTZX.descriptor[currentBlock].size + 1;
+  uint64_t dataTStates(File mFile, tTZXBlockDescriptor &d) {
+    // Datos de 0x10, 0x11 y 0x14. Cada bit son dos semi-pulsos
+    if (d.lengthOfData <= 0) {
+      return 0;
+    }
+    int lastBits = d.hasMaskLastByte ? d.maskLastByte : 8;
+    uint64_t bits = (uint64_t)(d.lengthOfData - 1) * 8 + lastBits;
+
+    // 0x10 y 0x11 son bloques de la ROM (flag + datos + checksum): con la
+    // misma lectura se verifica el checksum. El XOR de todo el bloque es 0
+    uint8_t x = 0;
+    bool verify = (d.ID == 16 || d.ID == 17) && lastBits == 8 &&
+                  d.lengthOfData >= 2;
+    uint64_t ones = countOnes(mFile, d.offsetData, d.lengthOfData, lastBits,
+                              verify ? &x : nullptr);
+    d.chkStatus = !verify ? BLOCK_CHK_NONE
+                          : (x == 0 ? BLOCK_CHK_OK : BLOCK_CHK_BAD);
+    return 2 * (ones * d.timming.bit_1 + (bits - ones) * d.timming.bit_0);
+  }
 
-        //"ID 28 -Select block";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID28STR, 35);
+  uint64_t msxTStates(File mFile, const tTZXBlockDescriptor &d) {
+    // ID 0x4B. Mismos campos que usa ZXProcessor::buildMSXTable()
+    const tTimming &t = d.timming;
+    int pulses[2] = {((t.bitcfg & 0xF0) >> 4) / 2 * 2, (t.bitcfg & 0x0F) / 2 * 2};
+    int width[2] = {t.bit_0, t.bit_1};
+    int nlb = (t.bytecfg & 0xC0) >> 6;
+    int vlb = (t.bytecfg & 0x20) >> 5;
+    int ntb = (t.bytecfg & 0x18) >> 3;
+    int vtb = (t.bytecfg & 0x04) >> 2;
+
+    uint64_t perByte = (uint64_t)nlb * pulses[vlb] * width[vlb] +
+                       (uint64_t)ntb * pulses[vtb] * width[vtb];
+    uint64_t bytes = d.lengthOfData > 0 ? d.lengthOfData : 0;
+    uint64_t ones = countOnes(mFile, d.offsetData, (int)bytes, 8);
+    uint64_t zeros = bytes * 8 - ones;
+
+    return (uint64_t)t.pilot_len * t.pilot_num_pulses + bytes * perByte +
+           ones * pulses[1] * width[1] + zeros * pulses[0] * width[0];
+  }
 
-      } else {
-        res = false;
+  uint64_t symbolTStates(const tSymDef &def, int maxPulses) {
+    // Un pulso de 0 termina el simbolo (ver buildSymbolTemplates)
+    uint64_t sum = 0;
+    for (int p = 0; def.pulse_array != nullptr && p < maxPulses; p++) {
+      if (def.pulse_array[p] == 0) {
+        break;
       }
-      break;
+      sum += def.pulse_array[p];
+    }
+    return sum;
+  }
 
-    // ID 2A - Stop the tape if in 48K mode
-    case 42:
-      analyzeBlockUnknow(currentID, currentOffset, currentBlock);
-      nextIDoffset = currentOffset + 1;
+  uint64_t gdbTStates(File mFile, const tSymbol *sym) {
+    // ID 0x19: pilot/sync por repeticiones y data stream simbolo a simbolo
+    if (sym == nullptr) {
+      return 0;
+    }
 
-      //_myTZX.descriptor[currentBlock].typeName = "ID 2A - Stop TAPE (48k
-      // mode)";
-      strncpy(_myTZX.descriptor[currentBlock].typeName, ID2ASTR, 35);
+    uint64_t total = 0;
+    for (int i = 0; i < sym->TOTP && sym->pilotStream != nullptr; i++) {
+      int k = sym->pilotStream[i].symbol;
+      if (k < sym->ASP && sym->symDefPilot != nullptr) {
+        total += (uint64_t)sym->pilotStream[i].repeat *
+                 symbolTStates(sym->symDefPilot[k], sym->NPP);
+      }
+    }
 
-      break;
+    if (sym->TOTD <= 0 || sym->symDefData == nullptr || sym->ASD > 256) {
+      return total;
+    }
 
-    // ID 2B - Set signal level
-    case 43:
-      if (_myTZX.descriptor != nullptr) {
-        int signalLevel = getBYTE(mFile, currentOffset + 5);
-        _myTZX.descriptor[currentBlock].ID = 43;
-        _myTZX.descriptor[currentBlock].size = 5;
-        _myTZX.descriptor[currentBlock].offset = currentOffset + 6;
-        _myTZX.descriptor[currentBlock].playeable = false;
+    uint32_t symT[256];
+    for (int k = 0; k < sym->ASD; k++) {
+      symT[k] = (uint32_t)symbolTStates(sym->symDefData[k], sym->NPD);
+    }
 
-        // Inversion de señal
-        INVERSETRAIN = signalLevel;
-        hmi.writeString("menuAudio2.polValue.val=" + String(INVERSETRAIN));
-        _myTZX.descriptor[currentBlock].signalLvl = INVERSETRAIN;
-
-        _hmi.refreshPulseIcons(INVERSETRAIN, ZEROLEVEL);
+    // Mismo orden de bits que playGDB(): NB bits por simbolo, MSB primero
+    int NB = 0;
+    while ((1 << NB) < sym->ASD) {
+      NB++;
+    }
+    int DS = ((NB * sym->TOTD) + 7) / 8;
+    uint32_t symMask = (1 << NB) - 1;
+
+    uint8_t chunk[GDB_STREAM_CHUNK];
+    uint8_t *ptr = chunk;
+    int chunkPos = 0;
+    int chunkLen = 0;
+    uint32_t bits = 0;
+    int numBits = 0;
+    int byteIdx = 0;
+
+    for (int i = 0; i < sym->TOTD; i++) {
+      while (numBits < NB && byteIdx < DS) {
+        if (chunkPos == chunkLen) {
+          chunkLen = min(DS - byteIdx, GDB_STREAM_CHUNK);
+          getBlock(mFile, ptr, sym->offsetDataStream + byteIdx, chunkLen);
+          chunkPos = 0;
+        }
+        bits = (bits << 8) | chunk[chunkPos++];
+        byteIdx++;
+        numBits += 8;
+      }
+      numBits -= NB;
+      uint32_t k = (bits >> numBits) & symMask;
+      if ((int)k < sym->ASD) {
+        total += symT[k];
+      }
+    }
+    return total;
+  }
 
-        nextIDoffset = currentOffset + 6;
+  uint64_t cswTStates(File mFile, const tTimming &t) {
+    // ID 0x18. En RLE cada byte es un pulso en muestras (0: el pulso va en
+    // el DWORD siguiente), asi que se suma en la misma pasada. Z-RLE habria
+    // que descomprimirlo entero al abrir: su duracion queda como
+    // desconocida (0) y el bloque no cuenta en el tiempo de la cinta
+    if (t.csw_sampling_rate <= 0 || t.csw_compression_type != 1) {
+      return 0;
+    }
 
-        //_myTZX.descriptor[currentBlock].typeName = "ID 2B - Set signal level";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID2BSTR, 35);
-      } else {
-        res = false;
+    uint8_t chunk[GDB_STREAM_CHUNK];
+    uint64_t samples = 0;
+    uint32_t longPulse = 0;
+    int pending = 0; // Bytes que faltan del DWORD
+
+    for (int done = 0; done < t.csw_data_size;) {
+      int n = min(t.csw_data_size - done, GDB_STREAM_CHUNK);
+      getBlock(mFile, chunk, t.csw_data_offset + done, n);
+      for (int k = 0; k < n; k++) {
+        if (pending > 0) {
+          longPulse |= (uint32_t)chunk[k] << (8 * (4 - pending));
+          if (--pending == 0) {
+            samples += longPulse;
+          }
+        } else if (chunk[k] == 0) {
+          pending = 4;
+          longPulse = 0;
+        } else {
+          samples += chunk[k];
+        }
       }
-      break;
+      done += n;
+    }
+    return samples * (uint64_t)DfreqCPU / t.csw_sampling_rate;
+  }
 
-    // ID 30 - Text description
-    case 48:
-      // No hacemos nada solamente coger el siguiente offset
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID48(mFile, currentOffset, currentBlock);
-        // Siguiente ID
-        nextIDoffset = currentOffset + _myTZX.descriptor[currentBlock].size + 1;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 30 - Information";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, IDXXSTR, 35);
-        // Esto le indica a los bloque de control de flujo que puede saltarse
-        _myTZX.descriptor[currentBlock].jump_this_ID = true;
-      } else {
-        res = false;
-      }
+  uint64_t blockTStates(File mFile, tTZXBlockDescriptor &d) {
+    // Duracion exacta del bloque en T-states, sin generar audio. Es
+    // aritmetica sobre los tiempos del descriptor y, donde hace falta, los
+    // bits a 1 de los datos. Se calcula al describir el bloque
+    const tTimming &t = d.timming;
+    uint64_t dur = 0;
+
+    switch (d.ID) {
+    case 16: // 0x10
+    case 17: // 0x11
+      dur = (uint64_t)t.pilot_len * t.pilot_num_pulses + t.sync_1 + t.sync_2 +
+            dataTStates(mFile, d) + pauseTStates(d.pauseAfterThisBlock);
       break;
-
-    // ID 31 - Message block
-    case 49:
-      // No hacemos nada solamente coger el siguiente offset
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID49(mFile, currentOffset, currentBlock);
-        // Siguiente ID
-        nextIDoffset = currentOffset + _myTZX.descriptor[currentBlock].size + 2;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 30 - Information";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, IDXXSTR, 35);
-        // Esto le indica a los bloque de control de flujo que puede saltarse
-        _myTZX.descriptor[currentBlock].jump_this_ID = true;
-      } else {
-        res = false;
-      }
+    case 18: // 0x12
+      dur = (uint64_t)t.pure_tone_len * t.pure_tone_num_pulses;
       break;
-
-    // ID 32 - Archive info
-    case 50:
-      // No hacemos nada solamente coger el siguiente offset
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID50(mFile, currentOffset, currentBlock);
-
-        // Siguiente ID
-        nextIDoffset = currentOffset + 3 + _myTZX.descriptor[currentBlock].size;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 32 - Archive info";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, IDXXSTR, 35);
-        // Esto le indica a los bloque de control de flujo que puede saltarse
-        _myTZX.descriptor[currentBlock].jump_this_ID = true;
-      } else {
-        res = false;
+    case 19: // 0x13
+      for (int p = 0; t.pulse_seq_array != nullptr &&
+                      p < t.pulse_seq_num_pulses;
+           p++) {
+        dur += t.pulse_seq_array[p];
       }
       break;
-
-    // ID 33 - Hardware type
-    case 51:
-      // No hacemos nada solamente coger el siguiente offset
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID51(mFile, currentOffset, currentBlock);
-
-        // Siguiente ID
-        nextIDoffset = currentOffset + 3 + _myTZX.descriptor[currentBlock].size;
-        //_myTZX.descriptor[currentBlock].typeName = "ID 33- Hardware type";
-        strncpy(_myTZX.descriptor[currentBlock].typeName, IDXXSTR, 35);
-        // Esto le indica a los bloque de control de flujo que puede saltarse
-        _myTZX.descriptor[currentBlock].jump_this_ID = true;
-      } else {
-        res = false;
-      }
+    case 20: // 0x14
+      dur = dataTStates(mFile, d) + pauseTStates(d.pauseAfterThisBlock);
       break;
-
-    // ID 35 - Custom info block
-    case 53:
-      analyzeID53(mFile, currentOffset, currentBlock);
-      nextIDoffset =
-          currentOffset + 0x15 + _myTZX.descriptor[currentBlock].size;
-
-      //_myTZX.descriptor[currentBlock].typeName = "ID 35 - Custom info block";
-      strncpy(_myTZX.descriptor[currentBlock].typeName, IDXXSTR, 35);
-
-      // Esto le indica a los bloque de control de flujo que puede saltarse
-      _myTZX.descriptor[currentBlock].jump_this_ID = true;
-
+    case 21: { // 0x15. Una muestra son "samplingRate" T-states
+      int lastBits = d.hasMaskLastByte ? d.maskLastByte : 8;
+      uint64_t samples =
+          d.lengthOfData > 0 ? (uint64_t)(d.lengthOfData - 1) * 8 + lastBits
+                             : 0;
+      dur = samples * d.samplingRate + pauseTStates(d.pauseAfterThisBlock);
       break;
-
-    // ID 4B - Standard Speed Data Block
-    case 75:
-
-      if (_myTZX.descriptor != nullptr) {
-        // Obtenemos la dirección del siguiente offset
-        analyzeID75(mFile, currentOffset, currentBlock);
-        nextIDoffset =
-            currentOffset + _myTZX.descriptor[currentBlock].size + 17;
-        strncpy(_myTZX.descriptor[currentBlock].typeName, ID4BSTR, 35);
-      } else {
-        res = false;
-      }
+    }
+    case 24: // 0x18
+      dur = cswTStates(mFile, t) + pauseTStates(d.pauseAfterThisBlock);
       break;
-
-    // ID 5A - "Glue" block (90 dec, ASCII Letter 'Z')
-    case 90:
-      analyzeBlockUnknow(currentID, currentOffset, currentBlock);
-      nextIDoffset = currentOffset + 8;
-
-      //_myTZX.descriptor[currentBlock].typeName = "ID 5A - Glue block";
-      strncpy(_myTZX.descriptor[currentBlock].typeName, ID5ASTR, 35);
+    case 25: // 0x19
+      dur = gdbTStates(mFile, d.symbol) + pauseTStates(d.pauseAfterThisBlock);
       break;
-
-    default:
-////SerialHW.println("");
-////SerialHW.println("ID unknow " + currentID);
-#ifdef DEBUGMODE
-      Serial.print("ID unknow 0x");
-      Serial.println(currentID, HEX);
-#endif
-      // Si no está implementado, salimos
-      ID_NOT_IMPLEMENTED = true;
-      res = false;
+    case 32: // 0x20. Pausa 0 es "stop the tape"
+      dur = pauseTStates(d.pauseAfterThisBlock);
+      break;
+    case 75: // 0x4B
+      dur = msxTStates(mFile, d) + pauseTStates(d.pauseAfterThisBlock);
       break;
     }
-
-    return res;
+    return dur;
   }
 
-  uint8_t *decompressCSW(uint8_t *compressedData, int compressedSize,
-                         int compressionType, int &decompressedSize) {
-    // Inicializar el tamaño de salida a 0
-    decompressedSize = 0;
-
-    // Validar entradas
-    if (!compressedData || compressedSize == 0) {
-      logln("ERROR (decompressCSW): Datos de entrada nulos o de tamaño cero.");
-      return nullptr;
-    }
-    if (compressionType != 1 && compressionType != 2) {
-      logln("ERROR (decompressCSW): Tipo de compresión no soportado: " +
-            String(compressionType));
-      return nullptr;
-    }
-
-    // 1. Preparar el buffer de destino con un tamaño inicial
-    int capacity = compressedSize * 2; // Una estimación inicial razonable
-    uint8_t *decompressedBuffer = (uint8_t *)ps_malloc(capacity);
-    if (!decompressedBuffer) {
-      logln("ERROR (decompressCSW): Fallo al alocar memoria inicial.");
-      return nullptr;
-    }
-
-    int readPtr = 0;  // Puntero de lectura en el buffer comprimido
-    int writePtr = 0; // Puntero de escritura en el buffer descomprimido
-
-    // 2. Bucle de descompresión
-    while (readPtr < compressedSize) {
-      // Re-alocar más memoria si el buffer de destino se está llenando
-      if (writePtr >= capacity - 256) { // Dejar un margen de seguridad
-        capacity *= 2;
-        uint8_t *newBuffer =
-            (uint8_t *)ps_realloc(decompressedBuffer, capacity);
-        if (!newBuffer) {
-          logln("ERROR (decompressCSW): Fallo al re-alocar memoria.");
-          free(decompressedBuffer);
-          return nullptr;
-        }
-        decompressedBuffer = newBuffer;
-      }
-
-      uint8_t value = compressedData[readPtr++];
-
-      // Lógica específica para Z-RLE (Tipo 2)
-      if (compressionType == 2 && value == 0) {
-        // Si el siguiente byte no existe, es un error en el fichero
-        if (readPtr >= compressedSize)
-          break;
-
-        uint8_t repeatCount = compressedData[readPtr++];
-
-        if (repeatCount == 0) {
-          // Marcador de fin de stream en Z-RLE
-          break;
-        } else {
-          // Secuencia de 'repeatCount' pulsos de 1 sample.
-          // En un contexto de contenedor, esto se traduce a 'repeatCount' bytes
-          // con valor 1.
-          for (int k = 0; k < repeatCount; k++) {
-            decompressedBuffer[writePtr++] = 1;
-          }
-        }
-      }
-      // Lógica para RLE (Tipo 1) y para pulsos normales de Z-RLE
-      else {
-        decompressedBuffer[writePtr++] = value;
-      }
+  bool growDescriptorTable(int count) {
+    // Con el analisis en paralelo la reproduccion puede estar leyendo la
+    // tabla, asi que la vieja se guarda en vez de liberarse
+    if (!TZX_PARSE_RUNNING || count <= _myTZX.capacity) {
+      return reserveTZXDescriptors(_myTZX, count);
     }
-
-    // 3. Ajustar el tamaño final del buffer y devolverlo
-    decompressedSize = writePtr;
-    uint8_t *finalBuffer =
-        (uint8_t *)ps_realloc(decompressedBuffer, decompressedSize);
-    if (!finalBuffer && decompressedSize > 0) {
-      logln("WARNING (decompressCSW): Fallo al ajustar el buffer final. Puede "
-            "haber memoria extra alocada.");
-      return decompressedBuffer; // Devolver el buffer original si el realloc
-                                 // falla
-    }
-
-    logln("CSW descompresión completa: " + String(compressedSize) +
-          " bytes -> " + String(decompressedSize) + " bytes.");
-    return finalBuffer;
-  }
-
-  // ... (después de la función decompressCSW) ...
-  /**
-   * @brief Descomprime un fichero CSW (RLE o Z-RLE) a otro fichero.
-   *
-   * @param compressedFile Fichero de entrada (comprimido), abierto en modo
-   * lectura.
-   * @param compressionType Tipo de compresión (1 para RLE, 2 para Z-RLE).
-   * @param outFile Fichero de salida (descomprimido), abierto en modo
-   * escritura.
-   * @return bool Devuelve true si la descompresión fue exitosa.
-   */
-  bool decompressCSWFile(File &compressedFile, int compressionType,
-                         File &outFile) {
-    if (!compressedFile || !outFile) {
-      logln("ERROR (decompressCSWFile): Ficheros de entrada o salida no "
-            "válidos.");
+    if (_numRetired >= 32) {
       return false;
     }
 
-    uint8_t read_buffer[512];
-    int bytes_read;
-
-    while ((bytes_read =
-                compressedFile.read(read_buffer, sizeof(read_buffer))) > 0) {
-      int readPtr = 0;
-      while (readPtr < bytes_read) {
-        uint8_t value = read_buffer[readPtr++];
-
-        if (compressionType == 2 && value == 0) {
-          if (readPtr >= bytes_read) { // Necesitamos leer el siguiente byte
-            if ((bytes_read = compressedFile.read(read_buffer,
-                                                  sizeof(read_buffer))) > 0) {
-              readPtr = 0;
-            } else {
-              break; // Fin del fichero
-            }
-          }
-          uint8_t repeatCount = read_buffer[readPtr++];
-
-          if (repeatCount == 0) { // Fin del stream Z-RLE
-            return true;
-          } else {
-            for (int k = 0; k < repeatCount; k++) {
-              uint8_t one = 1;
-              outFile.write(&one, 1);
-            }
-          }
-        } else {
-          outFile.write(&value, 1);
-        }
-      }
+    tTZXBlockDescriptor *old = nullptr;
+    if (!reserveTZXDescriptors(_myTZX, count, &old)) {
+      return false;
     }
+    _retired[_numRetired++] = old;
     return true;
   }
 
-  void getBlockDescriptor(File mFile, int sizeTZX, bool hasGroupBlocks) {
-    // Para ello tenemos que ir leyendo el TZX poco a poco
-    // Detectaremos los IDs a partir del byte 9 (empezando por offset = 0)
-    // Cada bloque empieza por un ID menos el primero
-    // que empieza por ZXTape!
-    // Ejemplo ID + bytes
-    //
-    int startOffset = 10; // Posición del primero ID, pero el offset
-                          // 0x00 de cada ID, sería el siguiente
-    int currentID = 0;
-    int nextIDoffset = 0;
-    int currentOffset = 0;
-    int lenghtDataBlock = 0;
-    int currentBlock = 1;
-    bool endTZX = false;
-    bool forzeEnd = false;
-    bool endWithErrors = false;
-
-    currentOffset = startOffset;
-
-    // Inicializamos
-    ID_NOT_IMPLEMENTED = false;
-
-// Le pasamos el path del fichero, la extension se le asigna despues en
-// la funcion createBlockDescriptorFile
-// _blDscTZX.createBlockDescriptorFileTZX();
-#ifdef DEBUGMODE
-    logln("Creating DSC file");
-    logln("Status of endTZX: " + String(endTZX));
-    logln("Status of forzeEnd: " + String(forzeEnd));
-    logln("Status of ID_NOT_IMPLEMENTED: " + String(ID_NOT_IMPLEMENTED));
-#endif
-
-    while (!endTZX && !forzeEnd && !ID_NOT_IMPLEMENTED) {
-
-      if (ABORT == true) {
-        forzeEnd = true;
-        endWithErrors = true;
-        LAST_MESSAGE = "Aborting. No proccess complete.";
-
-#ifdef DEBUGMODE
-        Serial.println("Aborting TZX reading");
-#endif
-      }
-
-      // El objetivo es ENCONTRAR IDs y ultimo byte, y analizar el bloque
-      // completo para el descriptor.
-      currentID = getID(mFile, currentOffset);
-
-      // Por defecto el bloque no es reproducible
-      _myTZX.descriptor[currentBlock].playeable = false;
-
-      // Ahora dependiendo del ID analizamos. Los ID están en HEX
-      // y la rutina devolverá la posición del siguiente ID, así hasta
-      // completar todo el fichero
-
-      if (getTZXBlock(mFile, currentBlock, currentID, currentOffset,
-                      nextIDoffset)) {
-        // Copiamos la estructura del bloque, apuntando a ella
-        tTZXBlockDescriptor t = _myTZX.descriptor[currentBlock];
-        // Agregamos la informacion del bloque al fichero del descriptor .dsc
-        //_blDscTZX.putBlocksDescriptorTZX(dscFile,
-        // currentBlock,t,sizeTZX,hasGroupBlocks);
-        // Incrementamos el bloque
-        currentBlock++;
-      } else {
-        LAST_MESSAGE = "ID block not implemented. Aborting";
-        forzeEnd = true;
-        endWithErrors = true;
-      }
-
-      if (currentBlock > maxAllocationBlocks) {
-#ifdef DEBUGMODE
-        SerialHW.println("Error. TZX not possible to allocate in memory");
-#endif
-
-        LAST_MESSAGE = "Error. Not enough memory for TZX/TSX/CDT";
-        endTZX = true;
-        // Salimos
-        return;
-      } else {
-      }
+  void freeRetiredTables() {
+    for (int k = 0; k < _numRetired; k++) {
+      free(_retired[k]);
+    }
+    _numRetired = 0;
+  }
 
-      if (nextIDoffset >= sizeTZX) {
-        // Finalizamos
-        endTZX = true;
-        logln("END TZX analying");
+  void publishBlocks(int count) {
+    // Los descriptores 0..count-1 ya estan completos. Primero la tabla (ha
+    // podido crecer) y despues el numero de bloques
+    if (_mirror != nullptr) {
+      _mirror->descriptor = _myTZX.descriptor;
+      _mirror->capacity = _myTZX.capacity;
+    }
+    TZX_BLOCKS_READY.store(count, std::memory_order_release);
+  }
 
-      } else {
-        currentOffset = nextIDoffset;
+  int programBlockIn(int from, int to) {
+    // Ultima cabecera PROGRAM de un ID 0x10 entre los bloques [from, to)
+    int found = -1;
+    for (int i = from; i < to; i++) {
+      const tTZXBlockDescriptor &d = _myTZX.descriptor[i];
+      if (d.ID == 16 && d.header && d.type == 0) {
+        found = i;
       }
-
-      TOTAL_BLOCKS = currentBlock;
     }
-    // Nos posicionamos en el bloque 1
-    BLOCK_SELECTED = 0;
-    _hmi.writeString("currentBlock.val=" + String(BLOCK_SELECTED));
+    return found;
+  }
 
-    _myTZX.numBlocks = currentBlock;
-    _myTZX.size = sizeTZX;
+  void endBlockScan() {
+    // Fin del analisis. Liberamos la ventana e informamos de los accesos a
+    // la SD que ha necesitado
+    SD_READS_LAST_OPEN = _reader.getReads();
+    logln("SD reads per open: " + String(SD_READS_LAST_OPEN));
+    _reader.end();
   }
 
   void process_tzx(File mfile) //, File &dscFile)
@@ -2322,11 +2154,15 @@ private:
 
     if (isFileTZX(mfile)) {
       logln("TZX file detected");
-      // Esto lo hacemos para poder abortar
-      ABORT = false;
+      // Esto lo hacemos para poder abortar. En la tarea de analisis ABORT
+      // es de la reproduccion y no se toca
+      if (!TZX_PARSE_RUNNING) {
+        ABORT = false;
+      }
       getBlockDescriptor(mfile, _sizeTZX, _myTZX.hasGroupBlocks);
     } else {
       logln("Error: Not a TZX file");
+      _parseAborted = true;
     }
   }
 
@@ -2391,6 +2227,19 @@ private:
 public:
   tTZXBlockDescriptor *getDescriptor() { return _myTZX.descriptor; }
 
+  int getCapacity() { return _myTZX.capacity; }
+
+  bool parseCancelled() { return _parseCancelled; }
+
+  bool edgeAtStartOf(int block, uint8_t &edge) {
+    // Flanco con el que empezo el bloque, si es el ultimo que ha sonado
+    if (block != _edgeBlock) {
+      return false;
+    }
+    edge = _edgeAtBlockStart;
+    return true;
+  }
+
   bool getPZXInfo(File mFile) {
     // (Lógica similar a getTZXInfo, pero para PZX)
     // ...
@@ -2409,6 +2258,8 @@ public:
 
   void setTZX(tTZX tzx) { _myTZX = tzx; }
 
+  void setMirror(tTZX *tzx) { _mirror = tzx; }
+
   void set_HMI(HMI hmi) { _hmi = hmi; }
 
   void set_file(File mFile, int sizeTZX) {
@@ -2419,26 +2270,21 @@ public:
 
   void proccessingDescriptor(File &tzxFile) {
 
-    LAST_MESSAGE = "Analyzing file. Capturing blocks";
-
     // if (SD_MMC.exists(pathDSC))
     // {
     //   SD_MMC.remove(pathDSC);
     // }
 
     //_blDscTZX.createBlockDescriptorFileTZX(dscFile,pathDSC);
-    // creamos un objeto TZXproccesor
-    set_file(tzxFile, _rlen);
+    // _mFile es el manejador de la reproduccion. Aqui solo el tamaño
+    _sizeTZX = _rlen;
     // Lo procesamos y creamos DSC
     process_tzx(tzxFile);
     // Cerramos para guardar los cambios
     // dscFile.close();
 
-    if (_myTZX.descriptor != nullptr && !ID_NOT_IMPLEMENTED) {
-      // Entregamos información por consola
-      strcpy(LAST_NAME, "              ");
-    } else {
-      LAST_MESSAGE = "Error in TZX/TSX/CDT or ID not supported";
+    if (_myTZX.descriptor == nullptr || ID_NOT_IMPLEMENTED) {
+      _parseMessage = "Error in TZX/TSX/CDT or ID not supported";
     }
   }
 
@@ -2447,11 +2293,20 @@ public:
     File tzxFile;
     File dscFile;
 
-    PROGRAM_NAME_DETECTED = false;
-    PROGRAM_NAME = "";
-    PROGRAM_NAME_2 = "";
+    // Con el analisis en paralelo esto corre en la tarea del analizador. Los
+    // globales del fichero los reinicia initialize()
+    _groupCount = 1;
+    _parseMessage = nullptr;
+    _parseEndedWhilePlaying = false;
 
-    MULTIGROUP_COUNT = 1;
+    _dialect = dialectOf(path);
+    _parseAborted = false;
+    _parseCancelled = false;
+
+#ifdef BLOCK_CACHE_ENABLE
+    // Los bloques cacheados son del fichero anterior
+    blockCache.clear();
+#endif
 
     // Abrimos el fichero
     tzxFile = SD_MMC.open(path, FILE_READ);
@@ -2466,25 +2321,188 @@ public:
     if (_rlen != 0) {
       FILE_IS_OPEN = true;
 
-      proccessingDescriptor(tzxFile);
+      // El analisis lleva su propio manejador del fichero: con el analisis en
+      // paralelo la reproduccion esta leyendo a la vez de _mFile
+      File parseFile = SD_MMC.open(path, FILE_READ);
+      if (!parseFile) {
+        parseFile = tzxFile;
+      }
+
+#ifdef DSC_INDEX_ENABLE
+      // Si ya tenemos el indice de este fichero no hace falta analizarlo
+      if (loadIndex(path, parseFile)) {
+        buildNavIndex();
+        closeParseFile(parseFile, tzxFile);
+        return;
+      }
+#endif
+
+      proccessingDescriptor(parseFile);
       logln("All blocks captured from TZX file");
+
+      if (!_parseAborted) {
+        buildNavIndex();
+      }
+
+#ifdef DSC_INDEX_ENABLE
+      if (!_parseAborted && _myTZX.numBlocks > 0) {
+        int p = programBlockIn(0, _myTZX.numBlocks);
+        if (dscIndex.saveTZX(path, parseFile, _myTZX, _myTZX.numBlocks,
+                             _groupCount,
+                             p >= 0 ? _myTZX.descriptor[p].name : "")) {
+          logln("Block index saved");
+        } else {
+          logln("Warning: block index not saved");
+        }
+      }
+#endif
+      closeParseFile(parseFile, tzxFile);
     } else {
       FILE_IS_OPEN = false;
-      LAST_MESSAGE = "Error in TZX/TSX/CDT file has 0 bytes";
+      _parseMessage = "Error in TZX/TSX/CDT file has 0 bytes";
+    }
+  }
+
+  bool waitForBlock(int block) {
+    // Con el analisis en paralelo solo se reproduce lo ya descrito. Si la
+    // reproduccion alcanza al analisis, espera
+    while (block >= TZX_BLOCKS_READY.load(std::memory_order_acquire)) {
+      if (!TZX_PARSE_RUNNING || stopOrPauseRequest()) {
+        return block < TZX_BLOCKS_READY.load(std::memory_order_acquire);
+      }
+      delay(1);
+    }
+    applyParseResults();
+    return true;
+  }
+
+  int jumpTargetOf(int block) {
+    // Sin indice (aun analizando) se calcula desde el descriptor
+    if (tapeNav.isReady()) {
+      return tapeNav.jumpTarget(block);
+    }
+    int t = block + _myTZX.descriptor[block].jump_relative;
+    return (t >= 0 && t != block) ? t : -1;
+  }
+
+  int callTargetOf(int block, int k) {
+    if (tapeNav.isReady()) {
+      return tapeNav.callTarget(block, k);
+    }
+    tTZXBlockDescriptor &d = _myTZX.descriptor[block];
+    if (k < 0 || k >= d.call_sequence_count ||
+        d.call_sequence_array == nullptr) {
+      return -1;
+    }
+    int t = block + (int16_t)d.call_sequence_array[k];
+    return (t >= 0 && t != block) ? t : -1;
+  }
+
+  void closeParseFile(File &parseFile, File &tzxFile) {
+    // Si no se pudo abrir un segundo manejador se uso el de reproduccion
+    if (parseFile != tzxFile) {
+      parseFile.close();
     }
   }
 
+  void buildNavIndex() {
+    // Grupos, bucles, saltos y tiempos de cada bloque
+    if (!tapeNav.build(_myTZX.descriptor, _myTZX.numBlocks)) {
+      logln("Warning: navigation index not built");
+      return;
+    }
+    logln("Navigation index: " + String(_myTZX.numBlocks) + " blocks, " +
+          String((uint32_t)(tapeNav.total() / (uint64_t)DfreqCPU)) + " s");
+  }
+
+#ifdef DSC_INDEX_ENABLE
+  bool loadIndex(char *path, File &tzxFile) {
+    // Descriptores desde el fichero .dsc
+    unsigned long t0 = millis();
+    int totalBlocks = 0;
+
+    if (!dscIndex.loadTZX(path, tzxFile, _myTZX, totalBlocks, _groupCount)) {
+      return false;
+    }
+
+    // El .dsc no guarda las plantillas de los ID 0x19: se regeneran antes
+    // de publicar los bloques
+    for (int i = 0; i < totalBlocks; i++) {
+      if (_myTZX.descriptor[i].ID == 25 &&
+          _myTZX.descriptor[i].symbol != nullptr &&
+          !_zxp.prepareGDB(_myTZX.descriptor[i].symbol)) {
+        logln("GDB: error building symbol templates for block " + String(i));
+      }
+    }
+
+    _sizeTZX = _rlen;
+    ID_NOT_IMPLEMENTED = false;
+    SD_READS_LAST_OPEN = 1;
+    _parseEndedWhilePlaying = false;
+    publishBlocks(totalBlocks);
+
+    logln("Block index loaded in " + String(millis() - t0) + " ms");
+    return true;
+  }
+#endif
+
   void initialize() {
 
     strncpy(_myTZX.name, "          ", 10);
     _myTZX.numBlocks = 0;
     _myTZX.size = 0;
+    _edgeBlock = -1;
+    TZX_BLOCKS_READY.store(0, std::memory_order_release);
+    freeRetiredTables();
 
     CURRENT_BLOCK_IN_PROGRESS = 1;
     BLOCK_SELECTED = 1;
     PROGRESS_BAR_BLOCK_VALUE = 0;
     PROGRESS_BAR_TOTAL_VALUE = 0;
     PROGRAM_NAME_DETECTED = false;
+    PROGRAM_NAME = "";
+    PROGRAM_NAME_2 = "";
+    MULTIGROUP_COUNT = 1;
+    _appliedBlocks = 0;
+  }
+
+  void applyParseResults() {
+    // Tarea que abrio el fichero. Publica lo que el analizador ha dejado en
+    // los bloques ya descritos. Con el analisis en paralelo se llama cada
+    // vez que se espera un bloque y desde tapeControl
+    int ready = TZX_BLOCKS_READY.load(std::memory_order_acquire);
+    if (ready <= _appliedBlocks) {
+      return;
+    }
+
+    int p = programBlockIn(_appliedBlocks, ready);
+    if (p >= 0) {
+      PROGRAM_NAME = String(_myTZX.descriptor[p].name);
+      LAST_PROGRAM_NAME = PROGRAM_NAME;
+      PROGRAM_NAME_DETECTED = true;
+    }
+
+    TOTAL_BLOCKS = ready;
+    _appliedBlocks = ready;
+  }
+
+  void finishParseResults() {
+    // Tarea que abrio el fichero, con el analisis ya terminado
+    applyParseResults();
+    MULTIGROUP_COUNT = _groupCount;
+
+    if (_parseMessage != nullptr) {
+      LAST_MESSAGE = _parseMessage;
+    } else {
+      strcpy(LAST_NAME, "              ");
+    }
+
+    // Nos posicionamos en el bloque 1, salvo que ya se estuviera
+    // reproduciendo al terminar
+    if (!_parseEndedWhilePlaying) {
+      BLOCK_SELECTED = 0;
+      _hmi.writeString("currentBlock.val=" + String(BLOCK_SELECTED));
+    }
   }
 
   void terminate() {
@@ -2494,8 +2512,13 @@ public:
     strncpy(_myTZX.name, "          ", 10);
     _myTZX.numBlocks = 0;
     _myTZX.size = 0;
+    TZX_BLOCKS_READY.store(0, std::memory_order_release);
+    freeRetiredTables();
     // free(_myTZX.descriptor);
     // _myTZX.descriptor = nullptr;
+#ifdef BLOCK_CACHE_ENABLE
+    blockCache.clear();
+#endif
   }
 
   void playBlock(tTZXBlockDescriptor descriptor) {
@@ -2645,6 +2668,31 @@ public:
     }
   }
 
+  static bool isCacheableID(int id) {
+    // Bloques de datos cuya señal depende solo del fichero y de los ajustes
+    // de salida. 0x10 / 0x11 van por playBlockCached()
+    return id == 20 || id == 25 || id == 75;
+  }
+
+  void playBlockCached(int i) {
+    // Bloques 0x10 / 0x11. Si ya se reprodujo con los mismos ajustes de
+    // salida se repite desde la cache de PSRAM; si no, se genera y se guarda.
+#ifdef BLOCK_CACHE_ENABLE
+    if (!DIRECT_RECORDING) {
+      if (_zxp.playCachedBlock(i, _myTZX.descriptor[i].offsetData,
+                               _myTZX.descriptor[i].size)) {
+        return;
+      }
+
+      _zxp.beginBlockCapture(i);
+      playBlock(_myTZX.descriptor[i]);
+      _zxp.endBlockCapture();
+      return;
+    }
+#endif
+    playBlock(_myTZX.descriptor[i]);
+  }
+
   bool isPlayeable(int id) {
     // Definimos los ID playeables (en decimal)
     bool res = false;
@@ -2660,142 +2708,6 @@ public:
     return res;
   }
 
-  void prepareID4B(int currentBlock, File mFile, int nlb, int vlb, int ntb,
-                   int vtb, int pzero, int pone, int offset, int ldatos,
-                   bool begin) {
-    // Generamos la señal de salida
-    int pulsosmaximos;
-    int npulses[2];
-    int vpulse[2];
-
-    npulses[0] = pzero / 2;
-    npulses[1] = pone / 2;
-    vpulse[0] = (_myTZX.descriptor[currentBlock].timming.bit_0);
-    vpulse[1] = (_myTZX.descriptor[currentBlock].timming.bit_1);
-    pulsosmaximos =
-        (_myTZX.descriptor[currentBlock].timming.pilot_num_pulses) +
-        ((npulses[vlb] * nlb) + 128 + (npulses[vtb] * ntb)) * ldatos;
-
-    // Reservamos memoria dinamica
-    _myTZX.descriptor[currentBlock].timming.pulse_seq_array =
-        (int *)ps_calloc(pulsosmaximos + 1, sizeof(int));
-    // _myTZX.descriptor[currentBlock].timming.pulse_seq_array = new
-    // int[pulsosmaximos + 1];
-
-#ifdef DEBUGMODE
-    logln("");
-    log(" - Numero de pulsos: " +
-        String(_myTZX.descriptor[currentBlock].timming.pilot_num_pulses));
-    logln("");
-    log(" - Pulsos maximos: " + String(pulsosmaximos));
-    logln("");
-    log(" - Longitud de los datos: " + String(ldatos));
-#endif
-
-    // metemos el pilot SOLO AL PRINCIPIO
-    int i;
-    int p;
-
-    if (begin) {
-      for (p = 0;
-           p < (_myTZX.descriptor[currentBlock].timming.pilot_num_pulses);
-           p++) {
-        _myTZX.descriptor[currentBlock].timming.pulse_seq_array[p] =
-            _myTZX.descriptor[currentBlock].timming.pilot_len;
-      }
-
-      i = p;
-    } else {
-      i = 0;
-    }
-
-#ifdef DEBUGMODE
-    log(">> Bucle del pilot - Iteraciones: " + String(p));
-#endif
-
-    // metemos los datos
-    uint8_t *bRead = (uint8_t *)ps_calloc(ldatos + 1, sizeof(uint8_t));
-    int lenPulse;
-
-    // Leemos el bloque definido por la particion (ldatos) del fichero
-    getBlock(mFile, bRead, offset, ldatos);
-
-    for (int i2 = 0; i2 < ldatos; i2++) // por cada byte
-    {
-
-      for (int i3 = 0; i3 < nlb; i3++) // por cada bit de inicio
-      {
-        for (int i4 = 0; i4 < npulses[vlb]; i4++) {
-          lenPulse = vpulse[vlb];
-          _myTZX.descriptor[currentBlock].timming.pulse_seq_array[i] = lenPulse;
-
-          i++;
-          _myTZX.descriptor[currentBlock].timming.pulse_seq_array[i] = lenPulse;
-
-          i++;
-        }
-      }
-
-      // metemos el byte leido
-      for (int n = 0; n < 8; n++) {
-        // Obtenemos el bit a transmitir
-        uint8_t bitMasked = bitRead(bRead[i2], 0 + n);
-
-        // Si el bit leido del BYTE es un "1"
-        if (bitMasked == 1) {
-          // Procesamos "1"
-          for (int b1 = 0; b1 < npulses[1]; b1++) {
-            _myTZX.descriptor[currentBlock].timming.pulse_seq_array[i] =
-                vpulse[1];
-
-            i++;
-            _myTZX.descriptor[currentBlock].timming.pulse_seq_array[i] =
-                vpulse[1];
-
-            i++;
-          }
-        } else {
-          // En otro caso
-          // procesamos "0"
-          for (int b0 = 0; b0 < npulses[0]; b0++) {
-            _myTZX.descriptor[currentBlock].timming.pulse_seq_array[i] =
-                vpulse[0];
-
-            i++;
-            _myTZX.descriptor[currentBlock].timming.pulse_seq_array[i] =
-                vpulse[0];
-
-            i++;
-          }
-        }
-      }
-
-      for (int i3 = 0; i3 < ntb; i3++) {
-        for (int i4 = 0; i4 < npulses[vtb]; i4++) {
-          lenPulse = vpulse[vtb];
-          _myTZX.descriptor[currentBlock].timming.pulse_seq_array[i] = lenPulse;
-
-          i++;
-          _myTZX.descriptor[currentBlock].timming.pulse_seq_array[i] = lenPulse;
-
-          i++;
-        }
-      }
-    }
-
-    _myTZX.descriptor[currentBlock].timming.pulse_seq_num_pulses = i;
-
-#ifdef DEBUGMODE
-    logln("datos: " + String(ldatos));
-    logln("pulsos: " + String(i));
-
-    logln("--------------------------------------------------------------------"
-          "-");
-#endif
-
-    free(bRead);
-  }
-
   int getIDAndPlay(int i, bool is_pzx = false) {
     // Inicializamos el buffer de reproducción. Memoria dinamica
     uint8_t *bufferPlay = nullptr;
@@ -2830,7 +2742,6 @@ public:
     DIRECT_RECORDING = false;
 
     double sr = 0.0;
-    double divd = 0.0;
 
     // EDGE_EAR_IS ^= 1; // Alternamos la señal EAR
 
@@ -2840,41 +2751,21 @@ public:
     {
       DIRECT_RECORDING = true;
 
-      // 1. Calcula el SR de entrada como ya lo haces
-      // double divd = double(_myTZX.descriptor[i].samplingRate) * (1.0 /
-      // DfreqCPU); int input_sr = divd > 0 ? round(1.0 / divd) : BASE_SR;
-
-      // 2. NO cambies la configuración de kitStream. Déjala fija en 32150Hz.
-      new_sr = kitStream.audioInfo();
-      // Calculamos el sampling rate desde el bloque ID 0x15
-      divd = double(_myTZX.descriptor[i].samplingRate) * (1.0 / DfreqCPU);
-
-      sr = divd > 0 ? 1.0 / divd : 0; // antes 44.1KHz (20/12/2025)
-
-      if (sr <= 1.0) {
+      // El codec se queda a SAMPLING_RATE. Cada muestra del bloque dura
+      // "samplingRate" T-states y el reloj de T-states la lleva a la
+      // frecuencia de la sesión, sin reconfigurar el hardware.
+      if (_myTZX.descriptor[i].samplingRate == 0) {
         LAST_MESSAGE = "Error in sampling rate. Abort.";
         return 0;
       }
 
-      //
-      // logln("Value in TZX srate: " +
-      // String(_myTZX.descriptor[i].samplingRate)); logln("Custom sampling
-      // rate: " + String(sr));
-
-      // Si el sampling rate es menor de 8kHz, lo cambiamos a default
-      // if (sr < 8000)
-      // {
-      //   sr = BASE_SR;
-      //   logln("Error. Changing sampling rate: " + String(sr));
-      // }
-      // BIT_DR_0 =_myTZX.descriptor[i].samplingRate;
-      // BIT_DR_1 = _myTZX.descriptor[i].samplingRate;
-
-      // Cambiamos el sampling rate en el HW
-      new_sr.sample_rate = (float)sr;
-      kitStream.setAudioInfo(new_sr);
-
-      // 3. Lee los datos del bloque en un buffer
+      sr = double(DfreqCPU) / double(_myTZX.descriptor[i].samplingRate);
+      logln("Direct recording: " + String(sr, 0) + " Hz -> " +
+            String(SAMPLING_RATE, 0) + " Hz");
+
+      _zxp.beginDRBlock(_myTZX.descriptor[i].samplingRate);
+
+      // Lee los datos del bloque en un buffer
       int data_size = _myTZX.descriptor[i].lengthOfData;
 
       // Usamos un buffer temporal en el stack si el tamaño es razonable,
@@ -2885,7 +2776,7 @@ public:
         readFileRange(_mFile, bufferPlay, _myTZX.descriptor[i].offsetData,
                       data_size, true);
 
-        // 4. Llama a la nueva función de reproducción con remuestreo
+        // Reproducción al sampling rate de la sesión
         _zxp.playDRBlock2(bufferPlay, data_size, true);
 
       } else if (data_size >= 16384) {
@@ -2914,12 +2805,9 @@ public:
       }
 
       // Pausa después del bloque
-      _zxp.silenceDR(_myTZX.descriptor[i].pauseAfterThisBlock, sr);
-
-      // ✅ RESTAURAR el sampling rate original después del bloque Direct
-      // Recording
-      new_sr.sample_rate = (float)SAMPLING_RATE;
-      kitStream.setAudioInfo(new_sr);
+      if (!stopOrPauseRequest()) {
+        _zxp.silenceDR(_myTZX.descriptor[i].pauseAfterThisBlock);
+      }
 
       DIRECT_RECORDING = false;
 
@@ -2945,7 +2833,17 @@ public:
       log("------------------------------------------------------");
 #endif
 
-      if (LOOP_PLAYED < LOOP_COUNT) {
+      // Si se empezo a reproducir dentro del bucle no se ha pasado por el
+      // Loop start; el indice sabe cual es
+      int loopStart = tapeNav.loopStartOf(i);
+      if (loopStart >= 0 && loopStart != BL_LOOP_START) {
+        BL_LOOP_START = loopStart;
+        LOOP_COUNT = _myTZX.descriptor[loopStart].loop_count;
+        LOOP_PLAYED = 0;
+      }
+
+      // LOOP_COUNT es el numero total de pasadas, la primera ya se ha hecho
+      if (LOOP_PLAYED + 1 < LOOP_COUNT) {
         // Volvemos al primner bloque dentro del loop
         newPosition = BL_LOOP_START;
         LOOP_PLAYED++;
@@ -2953,6 +2851,39 @@ public:
       }
       break;
     }
+    case 35: {
+      // Jump to block ID 0x23. Restamos 1 porque el FOR lo incrementa
+      int target = jumpTargetOf(i);
+      if (target >= 0) {
+        newPosition = target - 1;
+      }
+      break;
+    }
+    case 38: {
+      // Call sequence ID 0x26. Se reproduce cada destino hasta su 0x27
+      int target = callTargetOf(i, 0);
+      if (target >= 0) {
+        CALL_BLOCK = i;
+        CALL_PLAYED = 0;
+        newPosition = target - 1;
+      }
+      break;
+    }
+    case 39: {
+      // Return from sequence ID 0x27. Sin llamada en curso se ignora
+      if (CALL_BLOCK >= 0) {
+        CALL_PLAYED++;
+        int target = callTargetOf(CALL_BLOCK, CALL_PLAYED);
+        if (target >= 0) {
+          newPosition = target - 1;
+        } else {
+          // Seguimos detras del Call sequence
+          newPosition = CALL_BLOCK;
+          CALL_BLOCK = -1;
+        }
+      }
+      break;
+    }
     case 32: {
       // ******************************************************************************
       // ID 0x20 - Pause (silence) or 'Stop the Tape' command
@@ -2981,6 +2912,11 @@ public:
 
         LAST_GROUP = "[STOP BLOCK]";
 
+        if (OFFLINE_RENDER != OFFLINE_NONE) {
+          // Convirtiendo no hay nadie que pulse PLAY. Se sigue
+          break;
+        }
+
         // Lanzamos una PAUSA automatica
         AUTO_PAUSE = true;
         _hmi.verifyCommand("PAUSE");
@@ -2989,7 +2925,7 @@ public:
         CURRENT_BLOCK_IN_PROGRESS++;
         BLOCK_SELECTED++;
 
-        if (BLOCK_SELECTED >= _myTZX.numBlocks) {
+        if (BLOCK_SELECTED >= TZX_BLOCKS_READY.load()) {
           // Reiniciamos
           CURRENT_BLOCK_IN_PROGRESS = 1;
           BLOCK_SELECTED = 1;
@@ -3021,7 +2957,8 @@ public:
       break;
     }
     case 43: {
-      // Inversion de señal
+      // Inversion de señal. El analizador solo la deja en el descriptor
+      INVERSETRAIN = _myTZX.descriptor[i].signalLvl;
       if (INVERSETRAIN) {
         // Para que empiece en DOWN tiene que ser POLARIZATION = UP
         // esto seria una señal invertida
@@ -3101,6 +3038,7 @@ public:
           LOOP_END = 0;
           BL_LOOP_START = 0;
           BL_LOOP_END = 0;
+          CALL_BLOCK = -1;
 
           // return newPosition;
         }
@@ -3118,14 +3056,14 @@ public:
           //
           switch (_myTZX.descriptor[i].ID) {
           case 16: {
-            // Standard data - ID-10
-            _myTZX.descriptor[i].timming.pilot_len = DPILOT_LEN;
-            playBlock(_myTZX.descriptor[i]);
+            // Standard data - ID-10. El timing de la ROM ya lo fija
+            // analyzeID16()
+            playBlockCached(i);
             break;
           }
           case 17: {
             // Speed data - ID-11
-            playBlock(_myTZX.descriptor[i]);
+            playBlockCached(i);
             break;
           }
           }
@@ -3135,178 +3073,42 @@ public:
           //
           // int num_pulses = 0;
 
-          // Variables para el ID 0x4B (75)
-          int nlb;
-          int vlb;
-          int ntb;
-          int vtb;
-          int pzero;
-          int pone;
-
-          int ldatos;
-          int offset;
-
-          int bufferD;
-          int partitions;
-          int lastPartitionSize;
-          double silence;
-
-          bool begin = false;
+          // Los bloques de datos 0x14, 0x19 y 0x4B van por la cache igual
+          // que 0x10 / 0x11. Si se repiten desde ella no se entra al switch
+          bool fromCache = false;
+#ifdef BLOCK_CACHE_ENABLE
+          bool cacheable =
+              !DIRECT_RECORDING && isCacheableID(_myTZX.descriptor[i].ID);
+          if (cacheable) {
+            fromCache = _zxp.playCachedBlock(i, _myTZX.descriptor[i].offsetData,
+                                             _myTZX.descriptor[i].size);
+            if (!fromCache) {
+              _zxp.beginBlockCapture(i);
+            }
+          }
+#endif
 
-          switch (_myTZX.descriptor[i].ID) {
+          switch (fromCache ? -1 : _myTZX.descriptor[i].ID) {
 
           // Bloque 0x4B - MSX
           case 75: {
             BYTES_TOBE_LOAD = _myTZX.size;
 
-            // configuracion del byte
-            pzero = ((_myTZX.descriptor[i].timming.bitcfg & 0b11110000) >> 4);
-            pone = ((_myTZX.descriptor[i].timming.bitcfg & 0b00001111));
-            nlb = ((_myTZX.descriptor[i].timming.bytecfg & 0b11000000) >> 6);
-            vlb = ((_myTZX.descriptor[i].timming.bytecfg & 0b00100000) >> 5);
-            ntb = ((_myTZX.descriptor[i].timming.bytecfg & 0b00011000) >> 3);
-            vtb = ((_myTZX.descriptor[i].timming.bitcfg & 0b00000100) >> 2);
-
-#ifdef DEBUGMODE
-            logln("");
-            log("ID 0x4B:");
-            log("PULSES FOR ZERO = " + String(pzero));
-            log(" - " + String(_myTZX.descriptor[i].timming.bit_0) + " - ");
-            log(",PULSES FOR ONE = " + String(pone));
-            log(" - " + String(_myTZX.descriptor[i].timming.bit_1) + " - ");
-            log(",NUMBERS OF LEADING BITS = " + String(nlb));
-            log(",VALUE OF LEADING BITS = " + String(vlb));
-            log(",NUMBER OF TRAILING BITS = " + String(ntb));
-            log(",VALUE OF TRAILING BITS = " + String(vtb));
-#endif
-
-            // Conocemos la longitud total del bloque de datos a reproducir
-            ldatos = _myTZX.descriptor[i].lengthOfData;
-            // Nos quedamos con el offset inicial
-            offset = _myTZX.descriptor[i].offsetData;
-
             // Informacion para la barra de progreso
-            PRG_BAR_OFFSET_INI = offset; // offset del DATA
-            PRG_BAR_OFFSET_END = offset + _myTZX.descriptor[i].lengthOfData;
-
-            bufferD = 1024; // Buffer de BYTES de datos convertidos a samples
-
-            partitions = ldatos / bufferD;
-            lastPartitionSize = ldatos - (partitions * bufferD);
-
-            silence = _myTZX.descriptor[i].pauseAfterThisBlock;
-
-#ifdef DEBUGMODE
-            log(",SILENCE = " + String(silence) + " ms");
-
-            logln("");
-            log("Total data parts: " + String(partitions));
-            logln("");
-            log("----------------------------------------");
-#endif
-
-            // TSX_PARTITIONED = false;
+            PRG_BAR_OFFSET_INI = _myTZX.descriptor[i].offsetData;
+            PRG_BAR_OFFSET_END =
+                PRG_BAR_OFFSET_INI + _myTZX.descriptor[i].lengthOfData;
             PROGRESS_BAR_BLOCK_VALUE = 0;
 
-            if (ldatos > bufferD) {
-              // TSX_PARTITIONED = true;
-              for (int n = 0; n < partitions && !STOP && !PAUSE; n++) {
-                if (n == 0) {
-                  begin = true;
-                } else {
-                  begin = false;
-                }
+            // Pilot y bytes como plantillas de flancos, sin pasar por un
+            // array de pulsos
+            _zxp.playMSX(_myTZX.descriptor[i].timming, _mFile,
+                         _myTZX.descriptor[i].offsetData,
+                         _myTZX.descriptor[i].lengthOfData);
 
-#ifdef DEBUGMODE
-                logln("");
-                log("Part [" + String(n) + "] - offset: ");
-                logHEX(offset);
-#endif
-
-                prepareID4B(i, _mFile, nlb, vlb, ntb, vtb, pzero, pone, offset,
-                            bufferD, begin);
-                // ID 0x4B - Reproducimos una secuencia. Pulsos de longitud
-                // contenidos en un array y repetición
-
-                PRG_BAR_OFFSET_INI = 0;
-                PRG_BAR_OFFSET_END = ldatos;
-
-                _zxp.playCustomSequence(
-                    _myTZX.descriptor[i].timming.pulse_seq_array,
-                    _myTZX.descriptor[i].timming.pulse_seq_num_pulses, 0.0);
-                // Avanzamos el puntero por el fichero
-                offset += bufferD;
-
-                PROGRESS_BAR_BLOCK_VALUE =
-                    ((PRG_BAR_OFFSET_INI + (offset)) * 100) /
-                    PRG_BAR_OFFSET_END;
-
-                // Liberamos el array
-                free(_myTZX.descriptor[i].timming.pulse_seq_array);
-                // delete[] _myTZX.descriptor[i].timming.pulse_seq_array;
-              }
-
-              if (!STOP && !PAUSE) {
-                // Ultima particion
-                PRG_BAR_OFFSET_INI = 0;
-                PRG_BAR_OFFSET_END = ldatos;
-
-                PROGRESS_BAR_BLOCK_VALUE = 0;
-
-                prepareID4B(i, _mFile, nlb, vlb, ntb, vtb, pzero, pone, offset,
-                            lastPartitionSize, false);
-                // ID 0x4B - Reproducimos una secuencia. Pulsos de longitud
-                // contenidos en un array y repetición
-
-                _zxp.playCustomSequence(
-                    _myTZX.descriptor[i].timming.pulse_seq_array,
-                    _myTZX.descriptor[i].timming.pulse_seq_num_pulses, 0.0);
-                // Liberamos el array
-                free(_myTZX.descriptor[i].timming.pulse_seq_array);
-                // delete[] _myTZX.descriptor[i].timming.pulse_seq_array;
-                PROGRESS_BAR_BLOCK_VALUE =
-                    ((PRG_BAR_OFFSET_INI + (ldatos)) * 100) /
-                    PRG_BAR_OFFSET_END;
-                // Pausa despues de bloque
-                _zxp.silence(silence);
-              }
-
-#ifdef DEBUGMODE
-              logln("Finish");
-#endif
-
-            } else {
-#ifdef DEBUGMODE
-              logln(" - Only one data part");
-#endif
-
-              if (!STOP && !PAUSE) {
-
-                PRG_BAR_OFFSET_INI = 0;
-                PRG_BAR_OFFSET_END = ldatos;
-                PROGRESS_BAR_BLOCK_VALUE = 0;
-
-                // Una sola partiase 43ion
-                PRG_BAR_OFFSET_INI = _myTZX.descriptor[i].offsetData;
-
-                prepareID4B(i, _mFile, nlb, vlb, ntb, vtb, pzero, pone, offset,
-                            ldatos, true);
-
-                // ID 0x4B - Reproducimos una secuencia. Pulsos de longitud
-                // contenidos en un array y repetición
-                _zxp.playCustomSequence(
-                    _myTZX.descriptor[i].timming.pulse_seq_array,
-                    _myTZX.descriptor[i].timming.pulse_seq_num_pulses, 0);
-                PROGRESS_BAR_BLOCK_VALUE =
-                    ((PRG_BAR_OFFSET_INI + (ldatos)) * 100) /
-                    PRG_BAR_OFFSET_END;
-
-                // Liberamos el array
-                free(_myTZX.descriptor[i].timming.pulse_seq_array);
-                // delete[] _myTZX.descriptor[i].timming.pulse_seq_array;
-                // Pausa despues de bloque
-                _zxp.silence(silence);
-              }
+            if (!STOP && !PAUSE) {
+              // Pausa despues de bloque
+              _zxp.silence(_myTZX.descriptor[i].pauseAfterThisBlock);
             }
             break;
           }
@@ -3346,8 +3148,8 @@ public:
             //   // ID 0x19 - Generalized Data Block
             //   #ifdef DEBUGMODE
             //       logln("ID 0x19: Generalized Data Block");
-            //       logln("TOTP: " + String(_myTZX.descriptor[i].symbol.TOTP));
-            //       logln("TOTD: " + String(_myTZX.descriptor[i].symbol.TOTD));
+            //       logln("TOTP: " + String(_myTZX.descriptor[i].symbol->TOTP));
+            //       logln("TOTD: " + String(_myTZX.descriptor[i].symbol->TOTD));
             //   #endif
             //   _zxp.playGDB(&_myTZX.descriptor[i].symbol);
             //   _zxp.silence(_myTZX.descriptor[i].pauseAfterThisBlock);
@@ -3478,45 +3280,31 @@ public:
 
           case 24: {
             logln("Playing CSW Block (ID 0x18)");
-            int num_pulses = _myTZX.descriptor[i].timming.csw_num_pulses;
-            tRlePulse *pulse_data = _myTZX.descriptor[i].timming.csw_pulse_data;
-            float csw_sampling_rate =
-                (float)_myTZX.descriptor[i].timming.csw_sampling_rate;
+            uint32_t csw_sampling_rate =
+                _myTZX.descriptor[i].timming.csw_sampling_rate;
 
             if (csw_sampling_rate == 0) {
               logln("ERROR: CSW block has a sampling rate of 0.");
               break;
             }
 
-            // FÓRMULA DE CONVERSIÓN UNIVERSAL
-            // Calcula el factor para convertir la unidad de duración del CSW a
-            // T-States de 3.5MHz.
-            float conversion_factor = (float)DfreqCPU / csw_sampling_rate;
-            logln("  - CSW Conversion Factor to T-States: " +
-                  String(conversion_factor));
-
-            if (pulse_data && num_pulses > 0) {
-
-              ADD_ONE_SAMPLE_COMPENSATION = false;
-
-              for (int p = 0; p < num_pulses; p++) {
-                if (stopOrPauseRequest())
-                  break;
-
-                uint16_t repeat = pulse_data[p].repeat;
-
-                // Aplica el factor para obtener los T-States normalizados.
-                uint32_t pulse_len_tstates = (uint32_t)round(
-                    (float)pulse_data[p].pulse_len * conversion_factor);
+            // Los pulsos se leen (y descomprimen) del fichero a medida que
+            // se reproducen
+            CSWStream csw;
+            if (!csw.begin(
+                    _mFile, _myTZX.descriptor[i].timming.csw_data_offset,
+                    _myTZX.descriptor[i].timming.csw_data_size,
+                    _myTZX.descriptor[i].timming.csw_compression_type == 2)) {
+              logln("ERROR: Failed to alloc CSW stream buffers");
+              break;
+            }
 
-                if (pulse_len_tstates == 0)
-                  continue;
+            PROGRESS_BAR_BLOCK_VALUE = 0;
+            _zxp.playCSW(csw, csw_sampling_rate);
+            csw.end();
 
-                // Llama a playCustomSymbol con el valor en T-States.
-                // ZXProcessor se encargará de la conversión final a muestras de
-                // audio para 32150Hz.
-                _zxp.playCustomSymbol(pulse_len_tstates, repeat);
-              }
+            if (stopOrPauseRequest()) {
+              break;
             }
 
             _zxp.silence(_myTZX.descriptor[i].pauseAfterThisBlock);
@@ -3528,359 +3316,29 @@ public:
             logln("");
             logln("Playing generalized data block - ID 0x19");
             logln("Size: " + String(_myTZX.descriptor[i].size) + " bytes");
+            if (_myTZX.descriptor[i].symbol == nullptr) {
+              // No se pudo reservar la tabla de simbolos al analizarlo
+              logln("GDB: symbol table not available");
+              _zxp.silence(_myTZX.descriptor[i].pauseAfterThisBlock);
+              break;
+            }
+            logln("TOTP: " + String(_myTZX.descriptor[i].symbol->TOTP) +
+                  " - TOTD: " + String(_myTZX.descriptor[i].symbol->TOTD) +
+                  " - ASD: " + String(_myTZX.descriptor[i].symbol->ASD));
 
-            // Para ID 0x19
-            int TOTP = 0;
-            int NPP = 0;
-            int ASP = 0;
-            // Para data
-            int TOTD = 0;
-            int NPD = 0;
-            int ASD = 0;
-
-            int symbolID = 0;
-            int polarity = 0;
-            int pulseLength = 0;
-            int repeat = 0;
-
-            // Para pilot y sync
-            TOTP = _myTZX.descriptor[i].symbol.TOTP;
-            NPP = _myTZX.descriptor[i].symbol.NPP;
-            ASP = _myTZX.descriptor[i].symbol.ASP;
-
-            int totalSteps =
-                TOTP + TOTD; // El trabajo total es la suma de ambas fases
-            int completedSteps = 0;
             PROGRESS_BAR_BLOCK_VALUE = 0;
 
             // Inicializar offset para barra de progreso total
             PRG_BAR_OFFSET_INI = _myTZX.descriptor[i].offsetData;
             int gdbBlockSize = _myTZX.descriptor[i].size;
 
-#ifdef DEBUGMODE
-            logln("");
-            logln("Symbol definitions:");
-            logln("TOTP: " + String(TOTP));
-            logln("NPP: " + String(NPP));
-            logln("ASP: " + String(ASP));
-#endif
-
-            // Para data
-            TOTD = _myTZX.descriptor[i].symbol.TOTD;
-            NPD = _myTZX.descriptor[i].symbol.NPD;
-            ASD = _myTZX.descriptor[i].symbol.ASD;
-
-            // #ifdef DEBUGMODE
-            logln("");
-            logln("Data definitions:");
-            logln("TOTD: " + String(TOTD));
-            logln("NPD: " + String(NPD));
-            logln("ASD: " + String(ASD));
-            logln("");
-// #endif
-
-// Mostramos las definiciones de simbolos
-#ifdef DEBUGMODE
-            logln("Symbol definitions table:");
-            for (int k1 = 0; k1 < ASP; k1++) {
-              logln(
-                  "Symbol Def [" + String(k1) + "]: Polarity: " +
-                  String(
-                      _myTZX.descriptor[i].symbol.symDefPilot[k1].symbolFlag));
-              for (int s1 = 0; s1 < NPP; s1++) {
-                logln("  Pulse [" + String(s1) + "]: Length: " +
-                      String(_myTZX.descriptor[i]
-                                 .symbol.symDefPilot[k1]
-                                 .pulse_array[s1]));
-              }
-            }
-
-            for (int m1 = 0; m1 < TOTP; m1++) {
-              log(String(_myTZX.descriptor[i].symbol.pilotStream[m1].symbol) +
-                  "," +
-                  String(_myTZX.descriptor[i].symbol.pilotStream[m1].repeat) +
-                  "; ");
-            }
-            logln("");
-#endif
-
-            // PILOT / SYNC
-            // Recorremos el array de pulsos para
-            // -------------------------------------------------------------
-
-            ADD_ONE_SAMPLE_COMPENSATION = false;
-
             // El nivel inicial del bloque GDB depende del nivel final del
-            // bloque anterior. Solo se fuerza si el símbolo tiene polarity=2
-            // (force LOW) o polarity=3 (force HIGH). Con polarity=0 (opposite
-            // to current), simplemente alterna desde el nivel actual.
-
-            for (int j1 = 0; j1 < TOTP; j1++) {
-              // Cojo el ID del simbolo que necesito
-              symbolID = _myTZX.descriptor[i].symbol.pilotStream[j1].symbol;
-              // y las veces que se repite el SIMBOLO COMPLETO
-              repeat = _myTZX.descriptor[i].symbol.pilotStream[j1].repeat;
-
-              if (STOP || PAUSE)
-                break; // Comprobar parada/pausa antes de cada byte
-
-              // Verificamos que el simbolo es correcto
-              if (symbolID < ASP) {
-                // Ahora leo el simbolo de la tabla de definiciones
-                // para obtener sus características
-
-                // Obtenemos el tipo de polarización (solo bits 0-1 son válidos)
-                polarity = _myTZX.descriptor[i]
-                               .symbol.symDefPilot[symbolID]
-                               .symbolFlag &
-                           0x03;
-#ifdef DEBUGMODE
-                logln("[" + String(j1) + "] Symbol ID: " + String(symbolID) +
-                      " - Repeat: " + String(repeat) +
-                      " - Polarity: " + String(polarity));
-#endif
-
-                // ******************************************************************************
-                // CORRECCIÓN GDB: El símbolo COMPLETO se repite 'repeat' veces
-                // No cada pulso individual
-                // ******************************************************************************
-                for (int rep = 0; rep < repeat; rep++) {
-                  // CORRECCIÓN: La polaridad solo se aplica al PRIMER pulso de
-                  // cada repetición
-                  bool firstPulseOfSymbol = true;
-
-                  // Cada definición puede tener varios semi-pulsos
-                  // Leemos cada semi-pulso del simbolo
-                  for (int r = 0; r < NPP; r++) {
-                    // Cogemos la definición del ancho del pulso identificado en
-                    // el array
-                    pulseLength = _myTZX.descriptor[i]
-                                      .symbol.symDefPilot[symbolID]
-                                      .pulse_array[r];
-
-                    // Si el pulso es 0, indica fin del símbolo (spec TZX)
-                    if (pulseLength == 0)
-                      break;
-
-#ifdef DEBUGMODE
-                    logln("Pulse Length: " + String(pulseLength));
-#endif
-
-                    // La polaridad solo afecta al primer pulso de cada
-                    // repetición del símbolo
-                    if (firstPulseOfSymbol) {
-                      switch (polarity) {
-                      case 0: {
-                        // Toggle: cambiar nivel
-                        KEEP_CURRENT_EDGE = false;
-                        _zxp.playCustomSymbol(pulseLength, 1);
-                      } break;
-
-                      case 1: {
-                        // Same: mantener nivel actual
-                        KEEP_CURRENT_EDGE = true;
-                        _zxp.playCustomSymbol(pulseLength, 1);
-                      } break;
-
-                      case 2: {
-                        // Force low
-                        KEEP_CURRENT_EDGE = true;
-                        EDGE_EAR_IS = down;
-                        _zxp.playCustomSymbol(pulseLength, 1);
-                      } break;
-
-                      case 3: {
-                        // Force high
-                        KEEP_CURRENT_EDGE = true;
-                        EDGE_EAR_IS = up;
-                        _zxp.playCustomSymbol(pulseLength, 1);
-                      } break;
-                      }
-                      firstPulseOfSymbol = false;
-                    } else {
-                      // Pulsos siguientes: siempre alternar
-                      KEEP_CURRENT_EDGE = false;
-                      _zxp.playCustomSymbol(pulseLength, 1);
-                    }
-                  }
-                }
-              }
-            }
-
-            // ------------------------------------------------------------------
-            // DATA STREAM
-            //
-            // Recorremos el data stream bit a bit según NB (bits por símbolo)
-            // -------------------------------------------------------------------
-
-            // Calculamos cuántos bits necesita cada símbolo (mínimo NB tal que
-            // 2^NB >= ASD)
-            int NB = 0;
-            int tmpASD = ASD - 1;
-            while (tmpASD > 0) {
-              NB++;
-              tmpASD >>= 1;
-            }
-            int DS = ceil((float)(NB * TOTD) / 8.0);
-
-#ifdef DEBUGMODE
-            logln("Data stream:");
-            logln("  NB (bits per symbol): " + String(NB));
-            logln("  DS (stream bytes): " + String(DS));
-            logln("  TOTD (total symbols): " + String(TOTD));
-#endif
-
-            // Variables para lectura de bitstream
-            int current_byte_idx = 0;
-            int current_bit_pos = 7; // Comenzamos desde el MSB
-            int symbols_read = 0;
-            int max_bits = NB * TOTD; // Total bits a leer
-            int bit_index = 0;        // Índice global de bit
-
-            // Iteramos hasta leer TOTD símbolos (NO todos los bits del stream)
+            // bloque anterior. Cada símbolo aplica su polaridad al primer
+            // semi-pulso (ver ZXProcessor::buildSymbolTemplates).
+            _zxp.playGDB(_myTZX.descriptor[i].symbol, _mFile, gdbBlockSize);
 
-            ADD_ONE_SAMPLE_COMPENSATION = false;
-
-            while (symbols_read < TOTD && bit_index < max_bits) {
-              if (STOP || PAUSE)
-                break;
-
-#ifdef DEBUGMODE
-              logln("Leyendo símbolo #" + String(symbols_read) + ":");
-#endif
-              symbolID = 0;
-              for (int bit = 0; bit < NB && bit_index < max_bits; bit++) {
-                int byte_idx = bit_index / 8;
-                int bit_pos = 7 - (bit_index % 8); // MSB first from byte
-                uint8_t current_byte =
-                    _myTZX.descriptor[i].symbol.dataStream[byte_idx];
-                uint8_t bit_value = (current_byte >> bit_pos) & 1;
-#ifdef DEBUGMODE
-                logln("  Byte[" + String(byte_idx) + "] = 0x" +
-                      String(current_byte, HEX) + ", bit " + String(bit_pos) +
-                      " = " + String(bit_value));
-#endif
-                // CORRECCIÓN: El primer bit leído es el MSB del símbolo
-                // Desplazar symbolID a la izquierda y añadir el nuevo bit como
-                // LSB
-                symbolID = (symbolID << 1) | bit_value;
-                bit_index++;
-              }
-#ifdef DEBUGMODE
-              logln("  symbolID = " + String(symbolID));
-#endif
-
-// DEBUG: Mostrar bytes del datastream según se procesan
-// -------------------------------------------------------------
-#ifdef DEBUGMODE
-              if (bit_index % 8 == 0 && bit_index > 0) {
-                int completed_byte_idx = (bit_index / 8) - 1;
-                uint8_t original_byte =
-                    _myTZX.descriptor[i].symbol.dataStream[completed_byte_idx];
-                String hex = String(original_byte, HEX);
-                if (hex.length() == 1)
-                  hex = "0" + hex;
-                log("0x" + hex + ",");
-              }
-              // -------------------------------------------------------------
-#endif
-
-              // Verificamos que el símbolo es válido
-              if (symbolID < ASD) {
-                // Obtenemos la polaridad del símbolo
-                polarity = _myTZX.descriptor[i]
-                               .symbol.symDefData[symbolID]
-                               .symbolFlag &
-                           0x03;
-
-#ifdef DEBUGMODE
-                logln("Symbol #" + String(symbols_read) + ": ID=" +
-                      String(symbolID) + ", Polarity=" + String(polarity));
-#endif
-
-                // CORRECCIÓN: La polaridad solo se aplica al PRIMER pulso del
-                // símbolo Los pulsos siguientes alternan automáticamente (como
-                // polarity=0) Spec TZX: "The polarity of the first pulse of the
-                // first symbol of a block
-                //           is the polarity of the last pulse of the previous
-                //           block"
-
-                // Leemos cada semi-pulso que define el símbolo
-                for (int r1 = 0; r1 < NPD; r1++) {
-                  if (STOP || PAUSE)
-                    break;
-
-                  bool firstPulseOfSymbol = true;
-                  // Cogemos la longitud del pulso
-                  pulseLength = _myTZX.descriptor[i]
-                                    .symbol.symDefData[symbolID]
-                                    .pulse_array[r1];
-
-                  // Si el pulso es 0, indica fin del símbolo (spec TZX)
-                  if (pulseLength == 0)
-                    break;
-
-#ifdef DEBUGMODE
-                  log("  Pulse[" + String(r1) + "]: " + String(pulseLength) +
-                      "T");
-#endif
-
-                  // Reproducimos el pulso
-                  // La polaridad solo afecta al primer pulso del símbolo
-                  if (firstPulseOfSymbol) {
-                    switch (polarity) {
-                    case 0: {
-                      // Toggle: cambiar nivel respecto al actual
-                      KEEP_CURRENT_EDGE = false;
-                      _zxp.playCustomSymbol(pulseLength, 1);
-                    } break;
-
-                    case 1: {
-                      // Same: mantener el nivel actual (sin cambio)
-                      KEEP_CURRENT_EDGE = true;
-                      _zxp.playCustomSymbol(pulseLength, 1);
-                    } break;
-
-                    case 2: {
-                      // Force low: forzar nivel bajo para el primer pulso
-                      KEEP_CURRENT_EDGE = true;
-                      EDGE_EAR_IS = down;
-                      _zxp.playCustomSymbol(pulseLength, 1);
-                    } break;
-
-                    case 3: {
-                      // Force high: forzar nivel alto para el primer pulso
-                      KEEP_CURRENT_EDGE = true;
-                      EDGE_EAR_IS = up;
-                      _zxp.playCustomSymbol(pulseLength, 1);
-                    } break;
-                    }
-                    firstPulseOfSymbol = false;
-                  } else {
-                    // Pulsos siguientes: siempre alternar (toggle)
-                    KEEP_CURRENT_EDGE = false;
-                    _zxp.playCustomSymbol(pulseLength, 1);
-                  }
-                }
-              } else {
-#ifdef DEBUGMODE
-                logln("WARNING: Invalid symbolID " + String(symbolID) +
-                      " (ASD=" + String(ASD) + ")");
-#endif
-              }
-
-              symbols_read++;
-
-              // Actualizamos la barra de progreso
-              if (TOTD > 0) {
-                PROGRESS_BAR_BLOCK_VALUE = (symbols_read * 100) / TOTD;
-                // Calcular bytes equivalentes procesados dentro del bloque GDB
-                int block_bytes_processed =
-                    (gdbBlockSize * symbols_read) / TOTD;
-                PROGRESS_BAR_TOTAL_VALUE =
-                    ((PRG_BAR_OFFSET_INI + block_bytes_processed) * 100) /
-                    BYTES_TOBE_LOAD;
-              }
+            if (stopOrPauseRequest()) {
+              break;
             }
 
             // ✅ ASEGURAR QUE LA BARRA LLEGUE AL 100% AL FINALIZAR
@@ -3894,6 +3352,12 @@ public:
             break;
           }
           }
+
+#ifdef BLOCK_CACHE_ENABLE
+          if (cacheable && !fromCache) {
+            _zxp.endBlockCapture();
+          }
+#endif
         } else {
           //
           // Otros bloques de datos SIN cabecera no contemplados anteriormente -
@@ -3906,7 +3370,6 @@ public:
           case 16: {
             // BASE_SR = STANDARD_SR_8_BIT_MACHINE;
             //  ID 0x10
-            _myTZX.descriptor[i].timming.pilot_len = DPILOT_LEN;
             playBlock(_myTZX.descriptor[i]);
             break;
           }
@@ -3942,10 +3405,12 @@ public:
     LOOP_END = 0;
     BL_LOOP_START = 0;
     BL_LOOP_END = 0;
+    CALL_BLOCK = -1;
 
     if (_myTZX.descriptor != nullptr) {
-      // Entregamos información por consola
-      TOTAL_BLOCKS = _myTZX.numBlocks;
+      // Entregamos información por consola. Si el analisis sigue en marcha
+      // son los bloques descritos hasta ahora
+      TOTAL_BLOCKS = TZX_BLOCKS_READY.load();
       strcpy(LAST_NAME, "              ");
 
       // Ahora reproducimos todos los bloques desde el seleccionado (para cuando
@@ -3959,7 +3424,7 @@ public:
 // Recorremos ahora todos los bloques que hay en el descriptor
 //-------------------------------------------------------------
 #ifdef DEBUGMODE
-      logln("Total blocks " + String(_myTZX.numBlocks));
+      logln("Total blocks " + String(TZX_BLOCKS_READY.load()));
       logln("First block " + String(firstBlockToBePlayed));
       logln("");
 #endif
@@ -3967,7 +3432,17 @@ public:
       // Inicializamos el nivel de la señal según la polarización seleccionada
       // EDGE_EAR_IS = INVERSETRAIN ? POLARIZATION ^ 1: POLARIZATION;
 
-      for (int i = firstBlockToBePlayed; i < _myTZX.numBlocks; i++) {
+      // Tiempo de cinta para el HMI. Se empieza donde empieza el bloque
+      TAPE_TOTAL_T = tapeNav.total();
+      TAPE_ELAPSED_T = tapeNav.startOf(firstBlockToBePlayed);
+
+      for (int i = firstBlockToBePlayed; waitForBlock(i); i++) {
+
+        // El indice se termina de construir con la cinta ya sonando
+        if (TAPE_TOTAL_T == 0 && tapeNav.isReady()) {
+          TAPE_TOTAL_T = tapeNav.total();
+          TAPE_ELAPSED_T = tapeNav.startOf(i);
+        }
 
         KEEP_CURRENT_EDGE =
             false; // Por defecto, cada bloque puede cambiar el nivel de la
@@ -3975,10 +3450,11 @@ public:
                    // expresamente (polarity 1 en GDB o flag correspondiente en
                    // otros bloques)
 
-        ADD_ONE_SAMPLE_COMPENSATION = false;
 
-        // Lo guardo por si hago PAUSE y vuelvo a reproducir el bloque
-        _myTZX.descriptor[i].edge = EDGE_EAR_IS;
+        // Lo guardo por si hago PAUSE y vuelvo a reproducir el bloque. No va
+        // en el descriptor: la tabla la comparte el analizador
+        _edgeBlock = i;
+        _edgeAtBlockStart = EDGE_EAR_IS;
 
         BLOCK_SELECTED = i;
 
@@ -3992,16 +3468,32 @@ public:
             _myTZX.descriptor[i].ID, _myTZX.descriptor[i].group,
             _myTZX.descriptor[i].name, _myTZX.descriptor[i].typeName,
             _myTZX.descriptor[i].size, _myTZX.descriptor[i].playeable);
+
+        TAPE_BLOCK_T = _myTZX.descriptor[i].durationTStates;
+        uint64_t renderedT0 = TSTATE_CLOCK_TOTAL_T;
+
         int new_i = getIDAndPlay(i);
-        // Entonces viene cambiada de un loop
-        if (new_i != -1) {
-          i = new_i;
-        }
 
         if (LOADING_STATE == 2 || LOADING_STATE == 3) {
           break;
         }
 
+#ifdef DEBUGMODE
+        // La duracion calculada al analizar debe coincidir con lo generado
+        if (TSTATE_CLOCK_TOTAL_T >= renderedT0) {
+          logln("Bl: " + String(i) + " duration " +
+                String((double)TAPE_BLOCK_T, 0) + " T / rendered " +
+                String((double)(TSTATE_CLOCK_TOTAL_T - renderedT0), 0) + " T");
+        }
+#endif
+        TAPE_ELAPSED_T += TAPE_BLOCK_T;
+        TAPE_BLOCK_T = 0;
+
+        // Entonces viene cambiada de un loop
+        if (new_i != -1) {
+          i = new_i;
+        }
+
         if (stopOrPauseRequest()) {
           // Forzamos la salida
           i = _myTZX.numBlocks + 1;
@@ -4060,6 +3552,7 @@ public:
       }
 
       // Cerrando
+      _zxp.closePulseBlock();
       // reiniciamos el edge del ultimo pulse
       LOOP_PLAYED = 0;
       // EDGE_EAR_IS = down;
@@ -4068,6 +3561,10 @@ public:
       LOOP_COUNT = 0;
       BL_LOOP_START = 0;
       BL_LOOP_END = 0;
+      CALL_BLOCK = -1;
+      TAPE_TOTAL_T = 0;
+      TAPE_ELAPSED_T = 0;
+      TAPE_BLOCK_T = 0;
       MULTIGROUP_COUNT = 1;
       WAITING_FOR_USER_ACTION = false;
     } else {
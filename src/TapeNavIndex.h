@@ -0,0 +1,296 @@
+#pragma once
+
+// Indice de navegacion de los bloques de un TZX/CDT/TSX.
+//
+// Se construye una vez al abrir el fichero (tanto si se analiza como si se
+// carga del .dsc) y resuelve de antemano todo lo que antes se buscaba
+// recorriendo descriptores: la pareja de cada Group start / Group end, el
+// Loop start de cada bloque que está dentro de un bucle, el destino de cada
+// Jump (0x23) y Call (0x26), y el instante de inicio de cada bloque medido
+// en T-states siguiendo el orden real de reproduccion (saltos, bucles y
+// llamadas incluidos). La duracion de cada bloque la calcula el analizador
+// (tTZXBlockDescriptor::durationTStates).
+//
+// Con esto, ir al bloque N, ir al instante T y saltar grupos son consultas
+// directas sobre la tabla.
+
+struct tNavEntry {
+  int groupStart = -1; // Group start (0x21) que contiene al bloque
+  int groupEnd = -1;   // Su Group end (0x22)
+  int loopStart = -1;  // Loop start (0x24) que contiene al bloque
+  int loopEnd = -1;    // Su Loop end (0x25)
+  int target = -1;     // Destino de un 0x23
+  uint64_t startTStates = 0;
+  uint64_t durationTStates = 0; // Una sola pasada por el bloque
+};
+
+class TapeNavIndex {
+private:
+  tNavEntry *_entries = nullptr; // Sale de la arena. No se libera
+  const tTZXBlockDescriptor *_dsc = nullptr;
+  int _numBlocks = 0;
+  uint64_t _totalTStates = 0;
+  bool _monotonic = true; // false si un salto atras repite bloques
+  // Se construye en la tarea de analisis y se consulta desde la reproduccion.
+  // Solo se lee la tabla con _ready a true
+  std::atomic<bool> _ready{false};
+
+  static const int MAX_NESTING = 16;
+
+  bool inRange(int block) const {
+    // Para uso interno mientras se construye, aun sin _ready
+    return _entries != nullptr && block >= 0 && block < _numBlocks;
+  }
+
+  bool valid(int block) const {
+    // Las consultas publicas solo leen la tabla ya publicada
+    return isReady() && inRange(block);
+  }
+
+  int callTargetAt(int block, int k) const {
+    // Destino de la llamada k de un 0x26 (desplazamiento relativo con signo)
+    if (!inRange(block) || _dsc[block].ID != 38 || k < 0 ||
+        k >= _dsc[block].call_sequence_count ||
+        _dsc[block].call_sequence_array == nullptr) {
+      return -1;
+    }
+    int t = block + (int16_t)_dsc[block].call_sequence_array[k];
+    return (t >= 0 && t < _numBlocks && t != block) ? t : -1;
+  }
+
+  void pairBlocks() {
+    // Grupos y bucles se emparejan con una pila cada uno
+    int groupStack[MAX_NESTING];
+    int loopStack[MAX_NESTING];
+    int groups = 0;
+    int loops = 0;
+
+    for (int b = 0; b < _numBlocks; b++) {
+      tNavEntry &e = _entries[b];
+      e.durationTStates = _dsc[b].durationTStates;
+
+      switch (_dsc[b].ID) {
+      case 33: // 0x21 Group start
+        if (groups < MAX_NESTING) {
+          groupStack[groups++] = b;
+        }
+        break;
+      case 34: // 0x22 Group end
+        if (groups > 0) {
+          int s = groupStack[--groups];
+          for (int k = s; k <= b; k++) {
+            _entries[k].groupStart = s;
+            _entries[k].groupEnd = b;
+          }
+        }
+        break;
+      case 35: { // 0x23 Jump. Desplazamiento relativo con signo
+        int t = b + _dsc[b].jump_relative;
+        e.target = (t >= 0 && t < _numBlocks && t != b) ? t : -1;
+        break;
+      }
+      case 36: // 0x24 Loop start
+        if (loops < MAX_NESTING) {
+          loopStack[loops++] = b;
+        }
+        break;
+      case 37: // 0x25 Loop end
+        if (loops > 0) {
+          int s = loopStack[--loops];
+          for (int k = s; k <= b; k++) {
+            _entries[k].loopStart = s;
+            _entries[k].loopEnd = b;
+          }
+        }
+        break;
+      }
+    }
+  }
+
+  uint64_t callTStates(int callBlock) const {
+    // Tiempo de todas las secuencias llamadas por un 0x26. Cada una llega
+    // hasta su Return (0x27)
+    uint64_t sum = 0;
+    for (int k = 0; k < _dsc[callBlock].call_sequence_count; k++) {
+      int b = callTargetAt(callBlock, k);
+      while (b >= 0 && b < _numBlocks && _dsc[b].ID != 39 && b != callBlock) {
+        sum += _entries[b].durationTStates;
+        b++;
+      }
+    }
+    return sum;
+  }
+
+  void computeStartTimes() {
+    // Recorremos la cinta en el orden en que se reproduce. Los bucles se
+    // recorren una vez y se multiplican, asi el coste es lineal aunque
+    // tengan miles de vueltas.
+    const uint64_t UNSET = UINT64_MAX;
+    for (int b = 0; b < _numBlocks; b++) {
+      _entries[b].startTStates = UNSET;
+    }
+
+    uint64_t t = 0;
+    uint64_t loopT0 = 0;
+    int loopCount = 0;
+    int steps = 0;
+    int b = 0;
+    while (b >= 0 && b < _numBlocks && steps++ < _numBlocks * 2) {
+      tNavEntry &e = _entries[b];
+      if (e.startTStates == UNSET) {
+        e.startTStates = t;
+      } else {
+        _monotonic = false;
+      }
+      t += e.durationTStates;
+
+      switch (_dsc[b].ID) {
+      case 35:
+        if (e.target >= 0) {
+          if (e.target < b) {
+            _monotonic = false;
+          }
+          b = e.target;
+          continue;
+        }
+        break;
+      case 36:
+        loopT0 = t;
+        loopCount = _dsc[b].loop_count;
+        break;
+      case 37:
+        if (loopCount > 1) {
+          t += (t - loopT0) * (loopCount - 1);
+        }
+        loopCount = 0;
+        break;
+      case 38:
+        t += callTStates(b);
+        break;
+      }
+      b++;
+    }
+    _totalTStates = t;
+
+    // Los bloques a los que no se llega (destinos de llamadas, bloques
+    // saltados) empiezan donde empieza el siguiente
+    uint64_t next = t;
+    for (int k = _numBlocks - 1; k >= 0; k--) {
+      if (_entries[k].startTStates == UNSET) {
+        _entries[k].startTStates = next;
+      }
+      next = _entries[k].startTStates;
+    }
+
+    for (int k = 1; k < _numBlocks && _monotonic; k++) {
+      _monotonic = _entries[k].startTStates >= _entries[k - 1].startTStates;
+    }
+  }
+
+public:
+  bool build(const tTZXBlockDescriptor *dsc, int numBlocks) {
+    clear();
+    if (dsc == nullptr || numBlocks <= 0) {
+      return false;
+    }
+
+    _entries = parseArena.allocArray<tNavEntry>(numBlocks);
+    if (_entries == nullptr) {
+      return false;
+    }
+    for (int b = 0; b < numBlocks; b++) {
+      _entries[b] = tNavEntry();
+    }
+
+    _dsc = dsc;
+    _numBlocks = numBlocks;
+    pairBlocks();
+    computeStartTimes();
+    _ready.store(true, std::memory_order_release);
+    return true;
+  }
+
+  void clear() {
+    // La memoria es de la arena, se devuelve con ella
+    _ready.store(false, std::memory_order_release);
+    _entries = nullptr;
+    _dsc = nullptr;
+    _numBlocks = 0;
+    _totalTStates = 0;
+    _monotonic = true;
+  }
+
+  bool isReady() const { return _ready.load(std::memory_order_acquire); }
+
+  int groupStartOf(int block) const {
+    return valid(block) ? _entries[block].groupStart : -1;
+  }
+
+  int groupEndOf(int block) const {
+    return valid(block) ? _entries[block].groupEnd : -1;
+  }
+
+  int loopStartOf(int block) const {
+    return valid(block) ? _entries[block].loopStart : -1;
+  }
+
+  int loopEndOf(int block) const {
+    return valid(block) ? _entries[block].loopEnd : -1;
+  }
+
+  int jumpTarget(int block) const {
+    return valid(block) ? _entries[block].target : -1;
+  }
+
+  int callCount(int block) const {
+    return (valid(block) && _dsc[block].ID == 38)
+               ? _dsc[block].call_sequence_count
+               : 0;
+  }
+
+  int callTarget(int block, int k) const {
+    return valid(block) ? callTargetAt(block, k) : -1;
+  }
+
+  uint64_t startOf(int block) const {
+    if (!valid(block)) {
+      return _totalTStates;
+    }
+    return _entries[block].startTStates;
+  }
+
+  uint64_t durationOf(int block) const {
+    return valid(block) ? _entries[block].durationTStates : 0;
+  }
+
+  uint64_t total() const { return _totalTStates; }
+
+  int blockAtTime(uint64_t t) const {
+    // Ultimo bloque que empieza en o antes de t
+    if (!isReady()) {
+      return -1;
+    }
+    if (!_monotonic) {
+      int best = 0;
+      for (int b = 0; b < _numBlocks; b++) {
+        if (_entries[b].startTStates <= t &&
+            _entries[b].startTStates >= _entries[best].startTStates) {
+          best = b;
+        }
+      }
+      return best;
+    }
+
+    int lo = 0;
+    int hi = _numBlocks - 1;
+    while (lo < hi) {
+      int mid = (lo + hi + 1) / 2;
+      if (_entries[mid].startTStates <= t) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    return lo;
+  }
+};
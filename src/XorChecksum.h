@@ -0,0 +1,48 @@
+#pragma once
+
+// Checksum de los bloques de datos del Spectrum (TAP, TZX 0x10/0x11 y lo que
+// graba TAPrecorder): XOR de todos los bytes.
+//
+// El XOR no depende del orden, así que se pliegan 32 bits de una vez y al
+// final se reduce la palabra a un byte. El Xtensa no admite lecturas de 32
+// bits sin alinear: los bytes sueltos del principio y del final van de uno
+// en uno.
+//
+// Un bloque completo (flag + datos + checksum) es correcto si el resultado
+// es 0.
+
+inline uint8_t xorChecksum(const uint8_t *data, size_t n, uint8_t seed = 0) {
+  uint8_t chk = seed;
+
+  // Hasta alinear a 4 bytes
+  while (n > 0 && ((uintptr_t)data & 3) != 0) {
+    chk ^= *data++;
+    n--;
+  }
+
+  const uint32_t *w = (const uint32_t *)data;
+  uint32_t acc = 0;
+  size_t words = n / 4;
+
+  // Cuatro palabras por vuelta
+  while (words >= 4) {
+    acc ^= w[0] ^ w[1] ^ w[2] ^ w[3];
+    w += 4;
+    words -= 4;
+  }
+  while (words > 0) {
+    acc ^= *w++;
+    words--;
+  }
+
+  acc ^= acc >> 16;
+  acc ^= acc >> 8;
+  chk ^= (uint8_t)acc;
+
+  // Cola
+  data = (const uint8_t *)w;
+  for (size_t i = 0; i < (n & 3); i++) {
+    chk ^= data[i];
+  }
+  return chk;
+}
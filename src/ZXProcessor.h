@@ -106,6 +106,39 @@ public:
 private:
   uint8_t _mask_last_byte = 8;
 
+  // Tabla byte -> semi-pulsos ya codificados (EDGE_MAKE) para sendDataArray.
+  // 16 semi-pulsos por byte (8 bits x 2), MSB primero, que se copian de una
+  // vez a la lista de flancos. Se reconstruye cuando cambia BIT_0 o BIT_1.
+  uint32_t *_byteRuns = nullptr;
+  int _byteRunsBit0 = -1;
+  int _byteRunsBit1 = -1;
+
+  // Posicion del reloj de T-states al empezar a capturar un bloque
+  uint64_t _captureStartT = 0;
+  uint64_t _captureStartSamples = 0;
+
+  // Lista de flancos donde se reducen los bloques antes de renderizarlos
+  EdgeList _edges;
+
+  // Plantillas de los bloques ID 0x4B. Para cada valor de byte, los
+  // semi-pulsos de sus bits de inicio, sus 8 bits y sus bits de parada:
+  // _msxStart[b] .. _msxStart[b + 1]. Se reutilizan mientras no cambie la
+  // configuración del bloque (tiempos de bit, bitcfg y bytecfg).
+  uint32_t *_msxEdges = nullptr;
+  int _msxEdgesCapacity = 0;
+  uint32_t _msxStart[257];
+  int _msxBitcfg = -1;
+  int _msxBytecfg = -1;
+  int _msxBit0 = -1;
+  int _msxBit1 = -1;
+
+  // Direct Recording (ID 0x15). Cada muestra del bloque dura
+  // _drSampleTStates; las muestras iguales consecutivas se agrupan en un
+  // tramo de nivel fijo que puede seguir en el siguiente trozo de datos.
+  uint32_t _drSampleTStates = 79;
+  uint8_t _drRunBit = 0;
+  uint32_t _drRunLen = 0;
+
   // AudioKitStream m_kit;
   void tapeAnimationON() {
     // Activamos animacion cinta
@@ -122,19 +155,19 @@ private:
   }
 
   bool stopOrPauseRequest() {
+    // El REM llega por interrupción a TAPE_EVENTS. Aquí no se lee el GPIO
+    // ni se escribe en el HMI.
+    uint32_t ev = TAPE_EVENTS.load(std::memory_order_acquire);
 
-    remDetection();
-
-    if (STOP) {
+    if (STOP || (ev & TAPE_EVENT_STOP)) {
       LAST_MESSAGE = "Stop requested. Wait.";
       LOADING_STATE = 2; // Parada del bloque actual
-      ACU_ERROR = 0;
       STOP_OR_PAUSE_REQUEST = true;
       return true;
-    } else if (PAUSE || (!REM_DETECTED && STATUS_REM_ACTUATED)) {
+    } else if (PAUSE || (ev & TAPE_EVENT_PAUSE) ||
+               ((ev & TAPE_EVENT_REM) && STATUS_REM_ACTUATED)) {
       LAST_MESSAGE = "Pause requested. Wait.";
       LOADING_STATE = 3; // Pausa del bloque actual
-      ACU_ERROR = 0;
       STOP_OR_PAUSE_REQUEST = true;
 
       if (STATUS_REM_ACTUATED) {
@@ -153,65 +186,99 @@ private:
     }
   }
 
-  void insertSamplesError(int samples, bool changeNextEARedge) {
-    // Este procedimiento permite insertar en la señal
-    // las muestras acumuladas por error generado en la conversión
-    // de double a int
-    bool forzeExit = false;
-    // El buffer se dimensiona para 16 bits
-    uint8_t buffer[samples * 2 * channels];
-    uint16_t *ptr = (uint16_t *)buffer;
+  bool pendingStopOrPause() {
+    // Comprobacion ligera para salir de los bucles de pulsos: una lectura
+    // de la palabra de eventos y de los flags
+    uint32_t ev = TAPE_EVENTS.load(std::memory_order_relaxed);
+    if ((ev & (TAPE_EVENT_STOP | TAPE_EVENT_PAUSE)) ||
+        ((ev & TAPE_EVENT_REM) && STATUS_REM_ACTUATED) || STOP || PAUSE) {
+      return stopOrPauseRequest();
+    }
+    return false;
+  }
 
-    size_t result = 0;
-    uint16_t sample_R = 0;
-    uint16_t sample_L = 0;
-    size_t bytes_written = 0;
-    double amplitude = 0.0;
+  void setupTStateClock() {
+    // Reducimos sampling rate y frecuencia de CPU por su mcd para que
+    // tstates * sr quepa casi siempre en 32 bits
+    uint32_t sr = (uint32_t)(SAMPLING_RATE + 0.5);
+    uint32_t cpu = (uint32_t)freqCPU;
+    uint32_t a = sr;
+    uint32_t b = cpu;
+
+    while (b != 0) {
+      uint32_t t = a % b;
+      a = b;
+      b = t;
+    }
 
-    if (EDGE_EAR_IS == down) {
-      amplitude = minAmplitude;
+    TSTATE_CLOCK_SR = sr / a;
+    TSTATE_CLOCK_CPU = cpu / a;
+    TSTATE_CLOCK_BASE_SR = SAMPLING_RATE;
+    // Empezamos a mitad de muestra para redondear al más cercano
+    TSTATE_CLOCK_PHASE = TSTATE_CLOCK_CPU / 2;
+    TSTATE_CLOCK_TOTAL_T = 0;
+    TSTATE_CLOCK_TOTAL_SAMPLES = 0;
+  }
+
+  int tstatesToSamples(uint64_t tstates) {
+    // Reloj de T-states. El acumulador guarda la fracción de muestra
+    // pendiente (en unidades de T-states x sr), de modo que cada flanco cae
+    // en la muestra más cercana a su instante exacto y no hay deriva entre
+    // pulsos ni entre bloques.
+    if (TSTATE_CLOCK_BASE_SR != SAMPLING_RATE) {
+      setupTStateClock();
+    }
+
+    uint64_t acc = TSTATE_CLOCK_PHASE + tstates * TSTATE_CLOCK_SR;
+    uint32_t samples;
+
+    if (acc <= 0xFFFFFFFFULL) {
+      // Caso habitual. División de 32 bits
+      samples = (uint32_t)acc / TSTATE_CLOCK_CPU;
+      TSTATE_CLOCK_PHASE = (uint32_t)acc - samples * TSTATE_CLOCK_CPU;
     } else {
-      amplitude = maxAmplitude;
+      samples = (uint32_t)(acc / TSTATE_CLOCK_CPU);
+      TSTATE_CLOCK_PHASE = acc - (uint64_t)samples * TSTATE_CLOCK_CPU;
     }
 
-    sample_R = amplitude * (MAIN_VOL_R / 100) * (MAIN_VOL / 100);
-    sample_L = amplitude * (MAIN_VOL_L / 100) * (MAIN_VOL / 100);
-    // }
+    TSTATE_CLOCK_TOTAL_T += tstates;
+    TSTATE_CLOCK_TOTAL_SAMPLES += samples;
+    return (int)samples;
+  }
 
-    // Escribimos el tren de pulsos en el procesador de Audio
-    // Generamos la señal en el buffer del chip de audio.
-    for (int j = 0; j < samples; j++) {
-      // R-OUT - Right channel output (Amplified output)
-      *ptr++ = sample_R;
-      // L-OUT - Left channel output (Speaker)
-      if (ACTIVE_AMP) {
-        *ptr++ = sample_L * EN_SPEAKER;
-      } else {
-        *ptr++ = sample_L;
-      }
+  uint64_t msToTStates(double duration) {
+    // Duraciones en ms (pausas) a T-states
+    return (uint64_t)(duration * (freqCPU / 1000.0) + 0.5);
+  }
 
-      result += 2 * channels;
+  uint32_t packFrame(double r, double l) {
+    // Frame estereo de 32 bits: R en la parte baja, L en la alta
+    return (uint32_t)(uint16_t)(int16_t)r |
+           ((uint32_t)(uint16_t)(int16_t)l << 16);
+  }
 
-      if (stopOrPauseRequest()) {
-        // Salimos
-        forzeExit = true;
-        return;
-      }
-    }
+  void updateLevelFrames() {
+    // Reconstruye LEVEL_FRAME. Se limpia el aviso antes de calcular para no
+    // perder un cambio que llegue mientras tanto.
+    VOL_CHANGE = false;
 
-    if (!forzeExit) {
-      // btstream.write(buffer, result);
-      if (OUT_TO_WAV) {
-        encoderOutWAV.write(buffer, result);
-      } else {
-        kitStream.write(buffer, result);
-      }
+    double gainR = (MAIN_VOL_R / 100.0) * (MAIN_VOL / 100.0);
+    double gainL = (MAIN_VOL_L / 100.0) * (MAIN_VOL / 100.0);
+
+    // Con el amplificador activo el canal L es el speaker
+    if (ACTIVE_AMP && !EN_SPEAKER) {
+      gainL = 0;
     }
 
-    // Reiniciamos
-    ACU_ERROR = 0;
-    // EDGE_EAR_IS ^=1;
-    // if (INVERSETRAIN) EDGE_EAR_IS ^=1;
+    LEVEL_FRAME[down] = packFrame(minAmplitude * gainR, minAmplitude * gainL);
+    LEVEL_FRAME[up] = packFrame(maxAmplitude * gainR, maxAmplitude * gainL);
+    LEVEL_FRAME[LEVEL_ZERO] = 0;
+  }
+
+  void checkLevelFrames() {
+    if (VOL_CHANGE) {
+      updateLevelFrames();
+    }
   }
 
   double getChannelAmplitude() {
@@ -278,627 +345,493 @@ private:
     return _yf[2];
   }
 
-  public: 
+  void writeOutput(uint8_t *buffer, size_t bytes) {
+    // Unico punto de salida hacia el stream de audio
+    if (OFFLINE_RENDER != OFFLINE_NONE) {
+      // Conversion. Sin I2S no hay que esperar a nadie
+      offlineRender.writePCM(buffer, bytes);
+    } else if (OUT_TO_WAV) {
+      encoderOutWAV.write(buffer, bytes);
+    } else if (pcmRing.isReady()) {
+      // La tarea de salida lo vuelca al I2S
+      if (!PCM_RING_STREAMING) {
+        PCM_RING_UNDERRUNS = 0;
+        PCM_RING_STREAMING = true;
+      }
+      pcmRing.write(buffer, bytes);
+    } else {
+      kitStream.write(buffer, bytes);
+      AUDIO_OUT_FRAMES += bytes / (2 * channels);
+    }
+  }
 
-  void createPulse(int width, int bytes, uint16_t sample_R, uint16_t sample_L) {
-    size_t result = 0;
-    uint8_t buffer[bytes + 4];
-    int16_t *ptr = (int16_t *)buffer;
-    int chn = channels;
-    size_t bytes_written = 0;
+  void renderRun(uint32_t frame, int frames) {
+    // Vuelca un tramo de "frames" muestras de nivel constante en el bloque
+    // de salida. El frame ya lleva empaquetados R (parte baja) y L (parte
+    // alta), asi que el relleno se hace con escrituras de 32 bits.
+    while (frames > 0) {
+      if (PULSE_RENDER_FILL == 0) {
+        PULSE_RENDER_T0 = micros();
+      }
 
-    LAST_PULSE_WIDTH = width;
+      int room = PULSE_RENDER_BLOCK_FRAMES - PULSE_RENDER_FILL;
+      int n = (frames < room) ? frames : room;
+      uint32_t *dst = &PULSE_RENDER_BLOCK[PULSE_RENDER_FILL];
 
-    for (int j = 0; j < width; j++) {
-      if (stopOrPauseRequest()) {
-        // Salimos
-        return;
+      for (int j = 0; j < n; j++) {
+        dst[j] = frame;
       }
 
-      // R-OUT - Right channel output (Amplified output) and current output.
-      *ptr++ = sample_R;
-      // L-OUT - Left channel output (Speaker)
-      if (ACTIVE_AMP) {
-        *ptr++ = sample_L * EN_SPEAKER;
-      } else {
-        *ptr++ = sample_L;
+      PULSE_RENDER_FILL += n;
+      frames -= n;
+
+      if (PULSE_RENDER_FILL >= PULSE_RENDER_BLOCK_FRAMES) {
+        if (!flushPulseBlock()) {
+          // Parada o pausa. Se descarta el resto del tramo
+          return;
+        }
       }
-      //
-
-      result += 2 * chn;
-    }
-
-    // int sr_parts = (MOTOR_DELAY_MS * (SAMPLING_RATE / 1000) * 2 * channels);
-    
-
-    // if (REM_DETECTED && (firstBytes_REM < sr_parts))
-    // {
-    //   // Si se ha detectado el REM y no se han escrito los primeros 4 bytes, insertamos un pulso de error
-    //   AudioInfo info = kitStream.audioInfo();
-    //   info.sample_rate = (SAMPLING_RATE / sr_parts)*firstBytes_REM;
-    //   kitStream.setAudioInfo(info);
-    //   firstBytes_REM++;
-    //   if (firstBytes_REM >= sr_parts) 
-    //   {
-    //     // Una vez insertados los primeros 4 bytes, restauramos el sample rate original
-    //     AudioInfo info = kitStream.audioInfo();
-    //     info.sample_rate = SAMPLING_RATE;
-    //     kitStream.setAudioInfo(info);
-    //   }
-    // }
-
-    // Volcamos en el buffer
-    if (OUT_TO_WAV) {
-      encoderOutWAV.write(buffer, result);
-    } else {
-      kitStream.write(buffer, result);
     }
   }
 
-  private: 
-  
-  void sampleDR(int samples, int amp) {
-    // Calculamos el tamaño del buffer
-    int bytes = 0; // Cada muestra ocupa 2 bytes (16 bits)
-    int chn = channels;
-    int frames = 0;
-    double frames_rest = 0;
-
-    // El buffer se dimensiona para 16 bits
-    uint16_t sample_L = 0;
-    uint16_t sample_R = 0;
-    // Amplitud de la señal
-    double amplitude = 0;
+public:
+  bool flushPulseBlock() {
+    // Escribe en el stream lo que haya en el bloque de salida.
+    // STOP / PAUSE / REM se comprueban aqui, una vez por bloque.
+    if (PULSE_RENDER_FILL == 0) {
+      return true;
+    }
 
-    // double rsamples = round((width / freqCPU) * SAMPLING_RATE);
-    //  Ajustamos
-    // int samples = 1;
+    PULSE_RENDER_BUSY_US += micros() - PULSE_RENDER_T0;
 
-    // Ajustamos el volumen
+    if (stopOrPauseRequest()) {
+      // Descartamos el bloque pendiente y lo que quede en el PCM ring
+      PULSE_RENDER_FILL = 0;
+      pcmRing.discard();
 
-    sample_R = (uint16_t)(amp * (MAIN_VOL_R / 100.0) * (MAIN_VOL / 100.0));
-    sample_L = (uint16_t)(amp * (MAIN_VOL_L / 100.0) * (MAIN_VOL / 100.0));
-    // }
+      if (!pcmRing.isReady()) {
+        // Sin PCM ring la latencia es lo escrito desde el evento
+        STOP_LATENCY_SAMPLES = AUDIO_OUT_FRAMES - TAPE_EVENT_FRAME;
+      }
+      return false;
+    }
 
-    bytes = (int)samples * 2 * channels;
-    //
+    writeOutput((uint8_t *)PULSE_RENDER_BLOCK,
+                PULSE_RENDER_FILL * 2 * channels);
 
-    // Generamos la onda
-    createPulse(samples, bytes, sample_R, sample_L);
+    PULSE_RENDER_FRAMES += PULSE_RENDER_FILL;
+    PULSE_RENDER_FILL = 0;
 
-    if (stopOrPauseRequest()) {
-      // Salimos
-      return;
-    }
+    // Cambios de volumen del HMI. Se aplican desde el siguiente bloque
+    checkLevelFrames();
+    return true;
+  }
+
+  void drainOutput() {
+    // Volcamos lo pendiente y esperamos a que llegue al I2S.
+    // Necesario antes de cambiar el sampling rate.
+    flushPulseBlock();
+    pcmRing.drain();
   }
 
-  void pulseSilencePZX(int samples, bool initialLevelLow) {
-    // Calculamos el tamaño del buffer
-    int bytes = 0; // Cada muestra ocupa 2 bytes (16 bits)
-    int chn = channels;
-    int frames = 0;
-    double frames_rest = 0.0;
+  void closePulseBlock() {
+    // Fin de la reproducción. Volcamos lo pendiente e informamos del
+    // rendimiento del renderizador.
+    drainOutput();
+    PCM_RING_STREAMING = false;
 
-    // El buffer se dimensiona para 16 bits
-    uint16_t sample_L = 0;
-    uint16_t sample_R = 0;
-    // Amplitud de la señal
-    double amplitude = 0.0;
+    if (PULSE_RENDER_BUSY_US > 0) {
+      PULSE_RENDER_SPS =
+          (double)PULSE_RENDER_FRAMES * 1000000.0 / PULSE_RENDER_BUSY_US;
+      logln("Pulse render: " + String(PULSE_RENDER_SPS, 0) + " samples/s");
+    }
 
-    ACU_ERROR = 0.0;
+    PULSE_RENDER_FRAMES = 0;
+    PULSE_RENDER_BUSY_US = 0;
 
-    //
-    // Generamos el semi-pulso
-    //
+    if (STOP_OR_PAUSE_REQUEST) {
+      logln("Stop latency: " + String(STOP_LATENCY_SAMPLES) + " samples");
+    }
 
-    // Obtenemos la amplitud de la señal según la configuración de polarización,
-    // nivel low, etc.
-    // Esto es para PZX
-    EDGE_EAR_IS = initialLevelLow ? down : up;
-    amplitude = getChannelAmplitude();
+    // Comprobación de deriva del reloj de T-states: las muestras emitidas
+    // deben coincidir con la suma teórica de T-states (redondeada)
+    if (TSTATE_CLOCK_CPU > 0 && TSTATE_CLOCK_TOTAL_T > 0) {
+      uint64_t expected =
+          (TSTATE_CLOCK_TOTAL_T * TSTATE_CLOCK_SR + TSTATE_CLOCK_CPU / 2) /
+          TSTATE_CLOCK_CPU;
+      long drift = (long)((int64_t)TSTATE_CLOCK_TOTAL_SAMPLES - (int64_t)expected);
+      logln("T-state clock: " + String((double)TSTATE_CLOCK_TOTAL_T, 0) +
+            " T-states, drift " + String(drift) + " samples");
+      setupTStateClock();
+    }
+  }
 
-    sample_R =
-        (uint16_t)(amplitude * (MAIN_VOL_R / 100.0) * (MAIN_VOL / 100.0));
-    sample_L =
-        (uint16_t)(amplitude * (MAIN_VOL_L / 100.0) * (MAIN_VOL / 100.0));
+  void createPulse(int width, uint16_t sample_R, uint16_t sample_L) {
+    // Tramo de "width" muestras. Para muestras que no vienen de LEVEL_FRAME
+    // (tono de test).
 
-    // Pasamos los datos para el modo DEBUG
-    DEBUG_AMP_R = sample_R;
-    DEBUG_AMP_L = sample_L;
+    // L-OUT - Left channel output (Speaker)
+    if (ACTIVE_AMP) {
+      sample_L = sample_L * EN_SPEAKER;
+    }
 
-    // Definiciones el número samples para el splitter
-    int minFrame = MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
+    // R-OUT - Right channel output (Amplified output) and current output.
+    emitFrame(width, (uint32_t)sample_R | ((uint32_t)sample_L << 16));
+  }
 
-    // Si el semi-pulso tiene un numero
-    // menor de muestras que el minFrame, entonces
-    // el minFrame será ese numero de muestras
-    if (samples <= minFrame) {
+  void emitFrame(int width, uint32_t frame) {
+    // Tramo de "width" muestras del frame estereo indicado
+    LAST_PULSE_WIDTH = width;
 
-#ifdef DEBUGMODE
-      // log("SIMPLE PULSE");
-      // log(" --> samp:  " + String(samples));
-      // log(" --> bytes: " + String(bytes));
-      // log(" --> Chns:  " + String(channels));
-      // log(" --> T0:  " + String(T0));
-      // log(" --> T1:  " + String(T1));
+    if (pendingStopOrPause()) {
+      // Parada o pausa pendiente. No generamos nada y descartamos
+      // lo que quede sin volcar.
+      PULSE_RENDER_FILL = 0;
+      return;
+    }
+
+#ifdef BLOCK_CACHE_ENABLE
+    // Guardamos el tramo si estamos capturando el bloque para la cache
+    if (blockCache.isCapturing()) {
+      blockCache.capture(frame, width);
+    }
 #endif
-      // Definimos el tamaño del buffer
-      bytes = samples * 2 * channels;
-      //
 
-      // Generamos la onda
-      createPulse(samples, bytes, sample_R, sample_L);
-    } else {
-      // Caso de un silencio o pulso muy largo
-      // -------------------------------------
-      int frameSlot = samples;
-      bytes = minFrame * 2 * channels;
-      int pass = 0;
-      while (frameSlot >= minFrame) {
-        createPulse(minFrame, bytes, sample_R, sample_L);
-        frameSlot = frameSlot - minFrame;
-        pass++;
-        if (stopOrPauseRequest()) {
-          return;
+    renderRun(frame, width);
+  }
+
+  void renderEdges(const uint32_t *edges, int count) {
+    // Unico renderizador de la lista de flancos a PCM. Cada semi-pulso pasa
+    // por el reloj de T-states y se rellena con el frame de su nivel.
+    checkLevelFrames();
+
+    for (int k = 0; k < count; k++) {
+      uint32_t edge = edges[k];
+
+      switch (EDGE_MODE(edge)) {
+      case EDGE_TOGGLE:
+        if (!KEEP_CURRENT_EDGE) {
+          EDGE_EAR_IS ^= 1;
         }
+        break;
+      case EDGE_LOW:
+        EDGE_EAR_IS = down;
+        break;
+      case EDGE_HIGH:
+        EDGE_EAR_IS = up;
+        break;
+      default:
+        // EDGE_KEEP
+        break;
       }
 
-      // El ultimo trozo
-      if (frameSlot > 0) {
-        bytes = frameSlot * 2 * channels;
-        createPulse(frameSlot, bytes, sample_R, sample_L);
+      if (OFFLINE_RENDER == OFFLINE_PZX) {
+        // Los semi-pulsos van tal cual al PZX
+        offlineRender.pulse(EDGE_TSTATES(edge), EDGE_EAR_IS);
+      } else {
+        emitFrame(tstatesToSamples(EDGE_TSTATES(edge)),
+                  LEVEL_FRAME[EDGE_EAR_IS]);
       }
 
-#ifdef DEBUGMODE
-      // log("ACU_ERROR: "+ String(ACU_ERROR));
-#endif
+      if (pendingStopOrPause()) {
+        break;
+      }
     }
 
-    if (stopOrPauseRequest()) {
+    // Pasamos los datos para el modo DEBUG
+    DEBUG_AMP_R = (int16_t)(LEVEL_FRAME[EDGE_EAR_IS] & 0xFFFF);
+    DEBUG_AMP_L = (int16_t)(LEVEL_FRAME[EDGE_EAR_IS] >> 16);
+  }
+
+#ifdef BLOCK_CACHE_ENABLE
+  void beginBlockCapture(int block) {
+    // Empezamos a guardar los tramos del bloque que se va a reproducir
+    if (OFFLINE_RENDER != OFFLINE_NONE) {
       return;
     }
+    if (TSTATE_CLOCK_BASE_SR != SAMPLING_RATE) {
+      setupTStateClock();
+    }
+
+    _captureStartT = TSTATE_CLOCK_TOTAL_T;
+    _captureStartSamples = TSTATE_CLOCK_TOTAL_SAMPLES;
+    checkLevelFrames();
+    blockCache.startCapture(block, (uint32_t)(SAMPLING_RATE + 0.5), EDGE_EAR_IS,
+                            LEVEL_FRAME[down], LEVEL_FRAME[up]);
   }
 
-  void pulseSilence(int samples) {
-    // Calculamos el tamaño del buffer
-    int bytes = 0; // Cada muestra ocupa 2 bytes (16 bits)
-    int chn = channels;
-    int frames = 0;
-    double frames_rest = 0.0;
+  void endBlockCapture() {
+    // Solo se guarda si el bloque se ha reproducido entero
+    if (LOADING_STATE == 2 || LOADING_STATE == 3 || STOP || PAUSE) {
+      blockCache.abortCapture();
+      return;
+    }
 
-    // El buffer se dimensiona para 16 bits
-    uint16_t sample_L = 0;
-    uint16_t sample_R = 0;
-    // Amplitud de la señal
-    double amplitude = 0.0;
+    blockCache.endCapture(EDGE_EAR_IS, TSTATE_CLOCK_PHASE,
+                          TSTATE_CLOCK_TOTAL_T - _captureStartT,
+                          TSTATE_CLOCK_TOTAL_SAMPLES - _captureStartSamples,
+                          LEVEL_FRAME[down], LEVEL_FRAME[up]);
+  }
 
-    ACU_ERROR = 0.0;
-    //
-    // Generamos el semi-pulso
-    //
+  bool playCachedBlock(int block, int offset, int size) {
+    // Reproduce el bloque desde la cache si esta con los mismos ajustes
+    // de salida. Devuelve false si hay que generarlo de nuevo.
+    if (OFFLINE_RENDER != OFFLINE_NONE) {
+      // Al convertir se genera todo. En PZX la cache (PCM) no sirve
+      return false;
+    }
+    if (TSTATE_CLOCK_BASE_SR != SAMPLING_RATE) {
+      setupTStateClock();
+    }
 
-    // Obtenemos la amplitud de la señal según la configuración de polarización,
-    // nivel low, etc.
-    // EDGE_EAR_IS = down;
-    amplitude = getChannelAmplitude();
-
-    // if (SWAP_MIC_CHANNEL)
-    // {
-    //     sample_L = amplitude * (MAIN_VOL_R / 100) * (MAIN_VOL / 100);
-    //     sample_R = amplitude * (MAIN_VOL_L / 100) * (MAIN_VOL / 100);
-    // }
-    // else
-    // {
-    sample_R =
-        (uint16_t)(amplitude * (MAIN_VOL_R / 100.0) * (MAIN_VOL / 100.0));
-    sample_L =
-        (uint16_t)(amplitude * (MAIN_VOL_L / 100.0) * (MAIN_VOL / 100.0));
-    // }
+    checkLevelFrames();
+    tBlockCacheEntry *e =
+        blockCache.find(block, (uint32_t)(SAMPLING_RATE + 0.5), EDGE_EAR_IS,
+                        LEVEL_FRAME[down], LEVEL_FRAME[up]);
+    if (e == nullptr) {
+      return false;
+    }
 
-    // Pasamos los datos para el modo DEBUG
-    DEBUG_AMP_R = sample_R;
-    DEBUG_AMP_L = sample_L;
+    logln("Block " + String(block) + " from cache (" + String(e->numRuns) +
+          " runs)");
 
-    // Definiciones el número samples para el splitter
-    int minFrame = MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
+    PRG_BAR_OFFSET_INI = offset;
+    PRG_BAR_OFFSET_END = offset + size;
 
-    // Si el semi-pulso tiene un numero
-    // menor de muestras que el minFrame, entonces
-    // el minFrame será ese numero de muestras
-    if (samples <= minFrame) {
+    for (int i = 0; i < e->numRuns; i++) {
+      uint32_t run = e->runs[i];
+      emitFrame(run & BLOCK_CACHE_MAX_RUN, e->palette[run >> 24]);
 
-#ifdef DEBUGMODE
-      // log("SIMPLE PULSE");
-      // log(" --> samp:  " + String(samples));
-      // log(" --> bytes: " + String(bytes));
-      // log(" --> Chns:  " + String(channels));
-      // log(" --> T0:  " + String(T0));
-      // log(" --> T1:  " + String(T1));
-#endif
-      // Definimos el tamaño del buffer
-      bytes = samples * 2 * channels;
-      // Generamos la onda
-      createPulse(samples, bytes, sample_R, sample_L);
-    } else {
-      // Caso de un silencio o pulso muy largo
-      // -------------------------------------
-      int frameSlot = samples;
-      bytes = minFrame * 2 * channels;
-      int pass = 0;
-      while (frameSlot >= minFrame) {
-        createPulse(minFrame, bytes, sample_R, sample_L);
-        frameSlot = frameSlot - minFrame;
-        pass++;
-        if (stopOrPauseRequest()) {
-          return;
-        }
+      if (LOADING_STATE == 2 || LOADING_STATE == 3) {
+        return true;
       }
 
-      // El ultimo trozo
-      if (frameSlot > 0) {
-        bytes = frameSlot * 2 * channels;
-        createPulse(frameSlot, bytes, sample_R, sample_L);
+      // Progreso proporcional a los tramos emitidos
+      if ((i & 0x1FF) == 0 && BYTES_TOBE_LOAD > 0 && size > 0) {
+        int ptrOffset = (int)(((int64_t)size * i) / e->numRuns);
+        PROGRESS_BAR_TOTAL_VALUE =
+            ((PRG_BAR_OFFSET_INI + (ptrOffset + 1)) * 100) / BYTES_TOBE_LOAD;
+        PROGRESS_BAR_BLOCK_VALUE = ((ptrOffset + 1) * 100) / size;
       }
-
-#ifdef DEBUGMODE
-      // log("ACU_ERROR: "+ String(ACU_ERROR));
-#endif
     }
 
-    if (stopOrPauseRequest()) {
-      return;
-    }
-  }
-
-  void fullPulse(double dwidth, double calibrationValue = 0.0) {
-    // Genera un pulso COMPLETO (dos semipulsos) con mayor precisión
-    int chn = channels;
-    int minFrame = MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
-    double tpulseWidth =
-        ((dwidth / freqCPU) * SAMPLING_RATE) + calibrationValue;
-    int s[2] = {(int)round(tpulseWidth),
-                (int)round((2 * tpulseWidth) - round(tpulseWidth))};
+    flushPulseBlock();
 
-    for (int i = 0; i < 2; ++i) {
-      int samples = s[i];
+    // Dejamos el reloj y el flanco como si el bloque se hubiera generado.
+    // El borde con el bloque siguiente puede moverse menos de una muestra.
+    TSTATE_CLOCK_PHASE = e->endPhase;
+    TSTATE_CLOCK_TOTAL_T += e->totalT;
+    TSTATE_CLOCK_TOTAL_SAMPLES += e->totalSamples;
+    EDGE_EAR_IS = e->endEdge;
 
-      double amplitude = 0.0;
-      amplitude = getChannelAmplitude();
-
-      // double amplitude = getChannelAmplitude(true);
-      uint16_t sample_R =
-          (uint16_t)(amplitude * (MAIN_VOL_R / 100) * (MAIN_VOL / 100));
-      uint16_t sample_L =
-          (uint16_t)(amplitude * (MAIN_VOL_L / 100) * (MAIN_VOL / 100));
-      DEBUG_AMP_R = sample_R;
-      DEBUG_AMP_L = sample_L;
-
-      // if (samples <= minFrame) {
-      int bytes = samples * 2 * chn;
-      createPulse(samples, bytes, sample_R, sample_L);
-      // } else {
-      //     int framesCounter = 0;
-      //     int frameSlot = minFrame;
-      //     int bytes = minFrame * 2 * chn;
-      //     while (frameSlot <= samples) {
-      //         createPulse(minFrame, bytes, sample_R, sample_L);
-      //         frameSlot += minFrame;
-      //         if (stopOrPauseRequest()) return;
-      //         framesCounter++;
-      //     }
-      //     // Procesa el residuo final si existe
-      //     int processed = framesCounter * minFrame;
-      //     int remaining = samples - processed;
-      //     if (remaining > 0) {
-      //         bytes = remaining * 2 * chn;
-      //         createPulse(remaining, bytes, sample_R, sample_L);
-      //     }
-      // }
-      if (stopOrPauseRequest())
-        return;
+    BYTES_LOADED += size;
+    if (BYTES_TOBE_LOAD > 0) {
+      PROGRESS_BAR_TOTAL_VALUE = ((offset + size) * 100) / BYTES_TOBE_LOAD;
     }
+    PROGRESS_BAR_BLOCK_VALUE = 100;
+    return true;
   }
+#endif
 
-  // void fullPulse(double dwidth, double calibrationValue = 0.0)
-  // {
-  //     // **************************************************************
-  //     //
-  //     // Genera un pulso COMPLETO (dos semipulsos) con mayor precisión
-  //     //
-  //     // **************************************************************
-
-  //     // Calculamos el tamaño del buffer
-  //     int bytes = 0; //Cada muestra ocupa 2 bytes (16 bits)
-  //     int chn = channels;
-  //     int frames = 0;
-  //     double frames_rest = 0;
-
-  //     // El buffer se dimensiona para 16 bits
-  //     uint16_t sample_L = 0;
-  //     uint16_t sample_R = 0;
-  //     // Amplitud de la señal
-  //     double amplitude = 0;
-
-  //     // Calculamos los semipulsos
-  //     int pulseWidth = (int)round(((dwidth / freqCPU) * SAMPLING_RATE) +
-  //     calibrationValue); int s1 = int(pulseWidth / 2); int s2 = pulseWidth -
-  //     s1;
-
-  //     amplitude = getChannelAmplitude(true);
-  //     sample_R = (uint16_t)(amplitude * (MAIN_VOL_R / 100) * (MAIN_VOL /
-  //     100)); sample_L = (uint16_t)(amplitude * (MAIN_VOL_L / 100) * (MAIN_VOL
-  //     / 100));
-
-  //     // Pasamos los datos para el modo DEBUG
-  //     DEBUG_AMP_R = sample_R;
-  //     DEBUG_AMP_L = sample_L;
-
-  //     // Definiciones el número samples para el splitter
-  //     int minFrame = MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
-  //     // Si el semi-pulso tiene un numero
-  //     // menor de muestras que el minFrame, entonces
-  //     // el minFrame será ese numero de muestras
-
-  //     if (s1 <= minFrame)
-  //     {
-  //         // Definimos el tamaño del buffer
-  //         bytes = s1 * 2 * channels;
-  //         // Generamos la onda
-  //         createPulse(s1,bytes,sample_R,sample_L);
-  //     }
-  //     else
-  //     {
-  //         // Caso de un silencio o pulso muy largo
-  //         // -------------------------------------
-
-  //         // Definimos los terminadores de cada frame para el splitter
-  //         int frameSlot = minFrame;
-
-  //         // Definimos el buffer
-  //         bytes = minFrame * 2 * channels;
-
-  //         // Dividimos la onda en trozos
-  //         int framesCounter = 0;
-
-  //         while(frameSlot <= s1)
-  //         {
-  //             createPulse(minFrame, bytes, sample_R, sample_L);
-  //             frameSlot += minFrame;
-
-  //             if (stopOrPauseRequest()) {return;}
-  //             framesCounter++;
-  //         }
-
-  //             int processed = framesCounter * minFrame;
-  //             int remaining = s1 - processed;
-  //             if (remaining > 0) {
-  //                 bytes = remaining * 2 * channels;
-  //                 createPulse(remaining, bytes, sample_R, sample_L);
-  //             }
-  //     }
-
-  //     amplitude = getChannelAmplitude(true);
-  //     sample_R = (uint16_t)(amplitude * (MAIN_VOL_R / 100) * (MAIN_VOL /
-  //     100)); sample_L = (uint16_t)(amplitude * (MAIN_VOL_L / 100) * (MAIN_VOL
-  //     / 100));
-
-  //     // Ahora la otra mitad del pulso
-  //     if (s2 <= minFrame)
-  //     {
-  //         // Definimos el tamaño del buffer
-  //         bytes = s2 * 2 * channels;
-  //         // Generamos la onda
-  //         createPulse(s2,bytes,sample_R,sample_L);
-  //     }
-  //     else
-  //     {
-  //         // Caso de un silencio o pulso muy largo
-  //         // -------------------------------------
-
-  //         // Definimos los terminadores de cada frame para el splitter
-  //         int frameSlot = minFrame;
-
-  //         // Definimos el buffer
-  //         bytes = minFrame * 2 * channels;
-
-  //         // Dividimos la onda en trozos
-  //         int framesCounter = 0;
-
-  //         while(frameSlot <= s2)
-  //         {
-  //             createPulse(minFrame, bytes, sample_R, sample_L);
-  //             frameSlot += minFrame;
-
-  //             if (stopOrPauseRequest()) {return;}
-  //             framesCounter++;
-  //         }
-  //     }
-
-  //     if (stopOrPauseRequest()) {return;}
-  // }
-
-  void semiPulsePZX(double dwidth, bool initialLevelLow) {
-    // Amplitud de la señal
-    double amplitude = 0;
-    int bytes = 0; // Cada muestra ocupa 2 bytes (16 bits)
-    int samples = 0;
-    // El buffer se dimensiona para 16 bits
-    uint16_t sample_L = 0;
-    uint16_t sample_R = 0;
-
-    // Calculamos el numero de samples
-    // double dwidth = width;
-    double rsamples = (((dwidth / freqCPU) * SAMPLING_RATE));
-    samples = (int)(round(rsamples));
+  private: 
+  
+  bool buildSymbolTemplates(const tSymDef *defs, int numSymbols,
+                            int maxPulses, uint32_t *&edges,
+                            uint16_t *&edgeStart) {
+    // Tabla de símbolos ID 0x19 a plantillas de flancos. El primer semi-pulso
+    // lleva la polaridad del símbolo (bits 0-1 del flag: cambiar, mantener,
+    // forzar bajo, forzar alto) y los siguientes siempre alternan. Un pulso
+    // de 0 T-states termina el símbolo.
+    static const uint8_t firstEdgeMode[4] = {EDGE_TOGGLE, EDGE_KEEP, EDGE_LOW,
+                                             EDGE_HIGH};
+
+    // Las plantillas viven lo mismo que el fichero (ver ParseArena)
+    edges = parseArena.allocArray<uint32_t>(numSymbols * maxPulses + 1);
+    edgeStart = parseArena.allocArray<uint16_t>(numSymbols + 1);
+    if (edges == nullptr || edgeStart == nullptr) {
+      edges = nullptr;
+      edgeStart = nullptr;
+      return false;
+    }
 
-    //
-    // logln("Samples on semiPulse: dwidth = "  + String(dwidth) + " samples = "
-    // + String(samples) + " (rsamples = " + String(rsamples) + ")");
-
-    // Si hay que añadir un sample por el redondeo de muestras en un pulso
-    // completo, se indica para que se aplique en el proximo pulso.
-    if (ADD_ONE_SAMPLE_COMPENSATION) {
-      samples += 1;
-      ADD_ONE_SAMPLE_COMPENSATION = false;
-    } else {
-      // Si hay un residual que no se compensa con ROUND() lo compenso en el
-      // otro semi-pulso con +1 esto se da en los casoso de BIT_0 y BIT_1, y
-      // tono guia estandar.
-      if (rsamples >= samples) {
-        ADD_ONE_SAMPLE_COMPENSATION = true;
+    int count = 0;
+    for (int k = 0; k < numSymbols; k++) {
+      edgeStart[k] = count;
+      if (defs[k].pulse_array == nullptr) {
+        continue;
+      }
+      for (int p = 0; p < maxPulses; p++) {
+        int pulseLen = defs[k].pulse_array[p];
+        if (pulseLen == 0) {
+          break;
+        }
+        uint8_t mode =
+            (p == 0) ? firstEdgeMode[defs[k].symbolFlag & 0x03] : EDGE_TOGGLE;
+        edges[count++] = EDGE_MAKE(pulseLen, mode);
       }
     }
+    edgeStart[numSymbols] = count;
+    return true;
+  }
 
-    // Obtenemos la amplitud de la señal según la configuración de polarización,
-    // nivel low, etc.
-
-    // Esto es para PZX
-    if (!CHANGE_PZX_LEVEL) {
-      // Establecemos el nivel inicial del bloque DATA
-      EDGE_EAR_IS = initialLevelLow ? down : up;
-      // Usamos KEEP_CURRENT_EDGE para que getChannelAmplitude() no haga toggle
-      KEEP_CURRENT_EDGE = true;
-      amplitude = getChannelAmplitude();
-      KEEP_CURRENT_EDGE = false;
-      CHANGE_PZX_LEVEL = true;
-    } else {
-      amplitude = getChannelAmplitude();
+  bool buildMSXTable(const tTimming &t) {
+    // bitcfg: pulsos por bit 0 (bits 7-4) y por bit 1 (bits 3-0).
+    // bytecfg: número y valor de los bits de inicio (7-6, 5) y de parada
+    // (4-3, 2), y orden de los bits (0: LSB primero)
+    if (t.bitcfg == _msxBitcfg && t.bytecfg == _msxBytecfg &&
+        t.bit_0 == _msxBit0 && t.bit_1 == _msxBit1) {
+      return true;
     }
 
-    sample_R = (uint16_t)(amplitude * (MAIN_VOL_R / 100) * (MAIN_VOL / 100));
-    sample_L = (uint16_t)(amplitude * (MAIN_VOL_L / 100) * (MAIN_VOL / 100));
+    int pulses[2] = {((t.bitcfg & 0xF0) >> 4) / 2 * 2,
+                     (t.bitcfg & 0x0F) / 2 * 2};
+    uint32_t width[2] = {(uint32_t)t.bit_0, (uint32_t)t.bit_1};
+    int nlb = (t.bytecfg & 0xC0) >> 6;
+    int vlb = (t.bytecfg & 0x20) >> 5;
+    int ntb = (t.bytecfg & 0x18) >> 3;
+    int vtb = (t.bytecfg & 0x04) >> 2;
+    bool msbFirst = (t.bytecfg & 0x01) != 0;
+
+    // Cada valor de bit aparece 1024 veces en la tabla
+    int total = 256 * (nlb * pulses[vlb] + ntb * pulses[vtb]) +
+                1024 * (pulses[0] + pulses[1]);
+    if (total == 0) {
+      return false;
+    }
+    if (total > _msxEdgesCapacity) {
+      uint32_t *edges =
+          (uint32_t *)ps_realloc(_msxEdges, total * sizeof(uint32_t));
+      if (edges == nullptr) {
+        _msxBitcfg = -1;
+        return false;
+      }
+      _msxEdges = edges;
+      _msxEdgesCapacity = total;
+    }
 
-    // Pasamos los datos para el modo DEBUG
-    DEBUG_AMP_R = sample_R;
-    DEBUG_AMP_L = sample_L;
-
-    // Hacemos splitting del frame si es necesario
-    if (samples <= MIN_FRAME_FOR_SILENCE_PULSE_GENERATION) {
-      // Caso de pulso corto
-      // -------------------
-      // Definimos el tamaño del buffer
-      bytes = samples * 2 * channels;
-      // Generamos la onda
-      createPulse(samples, bytes, sample_R, sample_L);
-    } else {
-      // Caso de un silencio o pulso muy largo
-      // -------------------------------------
-      // Definimos los terminadores de cada frame para el splitter
-      int frameSlot = MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
-      bytes = MIN_FRAME_FOR_SILENCE_PULSE_GENERATION * 2 * channels;
-      int framesCounter = 0;
-
-      while (frameSlot <= samples) {
-        createPulse(MIN_FRAME_FOR_SILENCE_PULSE_GENERATION, bytes, sample_R,
-                    sample_L);
-        frameSlot += MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
-
-        if (stopOrPauseRequest()) {
-          return;
+    int n = 0;
+    for (int b = 0; b < 256; b++) {
+      _msxStart[b] = n;
+      for (int k = 0; k < nlb * pulses[vlb]; k++) {
+        _msxEdges[n++] = EDGE_MAKE(width[vlb], EDGE_TOGGLE);
+      }
+      for (int k = 0; k < 8; k++) {
+        int bit = (b >> (msbFirst ? 7 - k : k)) & 1;
+        for (int p = 0; p < pulses[bit]; p++) {
+          _msxEdges[n++] = EDGE_MAKE(width[bit], EDGE_TOGGLE);
         }
-        framesCounter++;
       }
-
-      // ultima parte
-      int processed = framesCounter * MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
-      int remaining = samples - processed;
-      if (remaining > 0) {
-        bytes = remaining * 2 * channels;
-        createPulse(remaining, bytes, sample_R, sample_L);
+      for (int k = 0; k < ntb * pulses[vtb]; k++) {
+        _msxEdges[n++] = EDGE_MAKE(width[vtb], EDGE_TOGGLE);
       }
     }
-    // double int_rsamples;
-    // double rsamples_fl = modf(rsamples,&int_rsamples);
-    // double errAcc = rsamples - int_rsamples;
-    // ADD_ONE_SAMPLE_COMPENSATION = errAcc >= 0.5 ? 1:0;
-    // ADD_ONE_SAMPLE_COMPENSATION = 1;
-    if (stopOrPauseRequest()) {
-      return;
+    _msxStart[256] = n;
+
+    _msxBitcfg = t.bitcfg;
+    _msxBytecfg = t.bytecfg;
+    _msxBit0 = t.bit_0;
+    _msxBit1 = t.bit_1;
+    return true;
+  }
+
+  bool pushEdge(uint32_t tstates, uint8_t mode = EDGE_TOGGLE) {
+    // Sin memoria para la lista de flancos el bloque no puede seguir
+    if (!_edges.push(tstates, mode)) {
+      logln("Error: no memory for edge list");
+      return false;
     }
+    return true;
   }
 
-  void semiPulse(double dwidth) {
-    // Amplitud de la señal
-    double amplitude = 0;
-    int bytes = 0; // Cada muestra ocupa 2 bytes (16 bits)
-    int samples = 0;
-    // El buffer se dimensiona para 16 bits
-    uint16_t sample_L = 0;
-    uint16_t sample_R = 0;
+  bool appendEdges(const uint32_t *edges, int count) {
+    if (!_edges.append(edges, count)) {
+      logln("Error: no memory for edge list");
+      return false;
+    }
+    return true;
+  }
 
-    // Calculamos el numero de samples
-    // double dwidth = width;
-    double rsamples = (((dwidth / freqCPU) * SAMPLING_RATE));
-    samples = (int)(round(rsamples));
+  bool pushDRRun() {
+    // Cierra el tramo de muestras DR pendiente como semi-pulso de nivel fijo
+    if (_drRunLen == 0) {
+      return true;
+    }
+    bool ok =
+        pushEdge(_drRunLen * _drSampleTStates, _drRunBit ? EDGE_HIGH : EDGE_LOW);
+    _drRunLen = 0;
+    return ok;
+  }
 
-    //
-    // logln("Samples on semiPulse: dwidth = "  + String(dwidth) + " samples = "
-    // + String(samples) + " (rsamples = " + String(rsamples) + ")");
-
-    // Si hay que añadir un sample por el redondeo de muestras en un pulso
-    // completo, se indica para que se aplique en el proximo pulso.
-    if (ADD_ONE_SAMPLE_COMPENSATION) {
-      samples += 1;
-      ADD_ONE_SAMPLE_COMPENSATION = false;
-    } else {
-      // Si hay un residual que no se compensa con ROUND() lo compenso en el
-      // otro semi-pulso con +1 esto se da en los casoso de BIT_0 y BIT_1, y
-      // tono guia estandar.
-      if (rsamples >= samples) {
-        ADD_ONE_SAMPLE_COMPENSATION = true;
+  bool drSample(uint8_t bit) {
+    // Muestra DR. Solo genera flanco cuando cambia el nivel, asi que la
+    // conversion al sampling rate de la sesion la hace el reloj de T-states
+    // y cada flanco cae en su muestra de salida más cercana.
+    // Devuelve false si no se ha podido guardar el flanco.
+    if (_drRunLen > 0 &&
+        (bit != _drRunBit || _drRunLen >= EDGE_TSTATES_MASK / _drSampleTStates)) {
+      if (!pushDRRun()) {
+        return false;
       }
+      renderEdgeListIfFull();
     }
+    _drRunBit = bit;
+    _drRunLen++;
+    return true;
+  }
 
-    // Obtenemos la amplitud de la señal según la configuración de polarización,
-    // nivel low, etc.
-    amplitude = getChannelAmplitude();
+  void fullPulse(double dwidth, double calibrationValue = 0.0) {
+    // Genera un pulso COMPLETO (dos semipulsos) con mayor precisión
+    int s[2];
+    s[0] = tstatesToSamples((uint32_t)dwidth) + (int)calibrationValue;
+    s[1] = tstatesToSamples((uint32_t)dwidth);
 
-    sample_R = (uint16_t)(amplitude * (MAIN_VOL_R / 100) * (MAIN_VOL / 100));
-    sample_L = (uint16_t)(amplitude * (MAIN_VOL_L / 100) * (MAIN_VOL / 100));
+    for (int i = 0; i < 2; ++i) {
+      int samples = s[i];
 
-    // Pasamos los datos para el modo DEBUG
-    DEBUG_AMP_R = sample_R;
-    DEBUG_AMP_L = sample_L;
-
-    // Hacemos splitting del frame si es necesario
-    if (samples <= MIN_FRAME_FOR_SILENCE_PULSE_GENERATION) {
-      // Caso de pulso corto
-      // -------------------
-      // Definimos el tamaño del buffer
-      bytes = samples * 2 * channels;
-      // Generamos la onda
-      createPulse(samples, bytes, sample_R, sample_L);
-    } else {
-      // Caso de un silencio o pulso muy largo
-      // -------------------------------------
-      // Definimos los terminadores de cada frame para el splitter
-      int frameSlot = MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
-      bytes = MIN_FRAME_FOR_SILENCE_PULSE_GENERATION * 2 * channels;
-      int framesCounter = 0;
-
-      while (frameSlot <= samples) {
-        createPulse(MIN_FRAME_FOR_SILENCE_PULSE_GENERATION, bytes, sample_R,
-                    sample_L);
-        frameSlot += MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
-
-        if (stopOrPauseRequest()) {
-          return;
-        }
-        framesCounter++;
-      }
+      getChannelAmplitude();
+      checkLevelFrames();
 
-      // ultima parte
-      int processed = framesCounter * MIN_FRAME_FOR_SILENCE_PULSE_GENERATION;
-      int remaining = samples - processed;
-      if (remaining > 0) {
-        bytes = remaining * 2 * channels;
-        createPulse(remaining, bytes, sample_R, sample_L);
-      }
+      uint32_t frame = LEVEL_FRAME[EDGE_EAR_IS];
+      DEBUG_AMP_R = (int16_t)(frame & 0xFFFF);
+      DEBUG_AMP_L = (int16_t)(frame >> 16);
+
+      emitFrame(samples, frame);
+      if (pendingStopOrPause())
+        return;
+    }
+  }
+
+  void semiPulsePZX(double dwidth, bool initialLevelLow) {
+    // Esto es para PZX. El primer semi-pulso del bloque DATA fija el nivel
+    // inicial; el resto alternan.
+    uint8_t mode = EDGE_TOGGLE;
+
+    if (!CHANGE_PZX_LEVEL) {
+      mode = initialLevelLow ? EDGE_LOW : EDGE_HIGH;
+      CHANGE_PZX_LEVEL = true;
     }
 
-    if (stopOrPauseRequest()) {
-      return;
+    uint32_t edge = EDGE_MAKE((uint32_t)dwidth, mode);
+    renderEdges(&edge, 1);
+  }
+
+  void semiPulse(double dwidth) {
+    uint32_t edge = EDGE_MAKE((uint32_t)dwidth, EDGE_TOGGLE);
+    renderEdges(&edge, 1);
+  }
+
+  bool renderEdgeListIfFull() {
+    // Renderiza lo acumulado cuando la lista llega al tamaño de trozo.
+    // Devuelve false si hay parada o pausa.
+    if (_edges.size() >= EDGE_LIST_CHUNK) {
+      renderEdgeList();
     }
+    return !pendingStopOrPause();
+  }
+
+  void renderEdgeList() {
+    renderEdges(_edges.data(), _edges.size());
+    _edges.clear();
   }
 
   void customPilotTone(int lenPulse, int numPulses) {
@@ -912,45 +845,42 @@ private:
     log("  --> numPulses: " + String(numPulses));
 #endif
 
+    // Enviamos semi-pulsos alternando el cambio de flanco
+    _edges.clear();
     for (int i = 0; i < numPulses; i++) {
-      // Enviamos semi-pulsos alternando el cambio de flanco
-      ADD_ONE_SAMPLE_COMPENSATION = false;
-      semiPulse((double)lenPulse);
-      ACU_ERROR = 0;
-      if (stopOrPauseRequest()) {
+      if (!pushEdge(lenPulse) || !renderEdgeListIfFull()) {
+        _edges.clear();
         return;
       }
     }
+    renderEdgeList();
   }
 
   void pilotTone(int lenpulse, int numpulses) {
     // Tono guía para bloque TZX ID 0x10 y TAP
     // int npulses = (int)round(numpulses/2);
 
+    // Enviamos semi-pulsos alternando el cambio de flanco
+    _edges.clear();
     for (int i = 0; i < numpulses; i++) {
-      // Enviamos semi-pulsos alternando el cambio de flanco
-      semiPulse((double)lenpulse);
-      ACU_ERROR = 0;
-      if (stopOrPauseRequest()) {
+      if (!pushEdge(lenpulse) || !renderEdgeListIfFull()) {
+        _edges.clear();
         return;
       }
     }
+    renderEdgeList();
   }
 
   void zeroTone() {
     // Procedimiento que genera un bit "0"
-    ADD_ONE_SAMPLE_COMPENSATION = false;
     semiPulse(BIT_0);
     semiPulse(BIT_0);
-    ACU_ERROR = 0;
   }
 
   void oneTone() {
     // Procedimiento que genera un bit "1"
-    ADD_ONE_SAMPLE_COMPENSATION = false;
     semiPulse(BIT_1);
     semiPulse(BIT_1);
-    ACU_ERROR = 0;
   }
 
   void syncTone(int nTStates) {
@@ -963,9 +893,45 @@ private:
 
     // El pulso de sincronismo se considera un semi-pulso entonces no tiene
     // compensación.
-    ADD_ONE_SAMPLE_COMPENSATION = false;
     semiPulse((double)nTStates);
-    ACU_ERROR = 0;
+  }
+
+  bool prepareByteRuns() {
+    // Devuelve true si la tabla está lista para el timming actual
+    if (_byteRuns != nullptr && _byteRunsBit0 == BIT_0 &&
+        _byteRunsBit1 == BIT_1) {
+      return true;
+    }
+
+    if (_byteRuns == nullptr) {
+      _byteRuns = (uint32_t *)ps_calloc(256 * 16, sizeof(uint32_t));
+      if (_byteRuns == nullptr) {
+        return false;
+      }
+    }
+
+    // Cada bit son dos semi-pulsos de BIT_0 ó BIT_1 T-states. El paso a
+    // muestras lo hace el reloj de T-states al reproducir, porque depende
+    // de la fase acumulada.
+    for (int b = 0; b < 256; b++) {
+      uint32_t *runs = &_byteRuns[b * 16];
+      for (int n = 0; n < 8; n++) {
+        uint32_t edge =
+            EDGE_MAKE(((b >> (7 - n)) & 1) ? BIT_1 : BIT_0, EDGE_TOGGLE);
+        runs[2 * n] = edge;
+        runs[2 * n + 1] = edge;
+      }
+    }
+
+    _byteRunsBit0 = BIT_0;
+    _byteRunsBit1 = BIT_1;
+    return true;
+  }
+
+  bool sendByteFromTable(uint8_t bRead, uint8_t nbits) {
+    // Equivalente a llamar a oneTone()/zeroTone() por cada bit. Los
+    // semi-pulsos de los nbits primeros bits se copian de la plantilla.
+    return appendEdges(&_byteRuns[bRead * 16], nbits * 2);
   }
 
   void sendDataArray(uint8_t *data, int size, bool isThelastDataPart) {
@@ -974,6 +940,10 @@ private:
     int bytes_in_this_block = 0;
     int ptrOffset = 0;
 
+    // Tabla de semi-pulsos por byte para el timming de este bloque
+    bool useByteRuns = prepareByteRuns();
+    _edges.clear();
+
     // Procedimiento para enviar datos desde un array.
     // si estamos reproduciendo, nos mantenemos.
     if (LOADING_STATE == 1 || TEST_RUNNING) {
@@ -989,8 +959,9 @@ private:
           // {BYTES_LOADED = BYTES_TOBE_LOAD;}
           // Informacion para la barra de progreso total
 
-          if (stopOrPauseRequest()) {
+          if (pendingStopOrPause()) {
             // Salimos
+            _edges.clear();
             i = size;
             return;
           }
@@ -1029,18 +1000,26 @@ private:
           // y le aplicamos la mascara. Es decir SOLO SE TRANSMITE el nº de bits
           // que indica la mascara, para el último byte del bloque
 
-          for (int n = 0; n < _mask; n++) {
-            // Obtenemos el bit a transmitir
-            uint8_t bitMasked = bitRead(bRead, 7 - n);
-
-            // Si el bit leido del BYTE es un "1"
-            if (bitMasked == 1) {
-              // Procesamos "1"
-              oneTone();
-            } else {
-              // En otro caso
-              // procesamos "0"
-              zeroTone();
+          if (useByteRuns) {
+            if (!sendByteFromTable(bRead, _mask)) {
+              _edges.clear();
+              return;
+            }
+            renderEdgeListIfFull();
+          } else {
+            for (int n = 0; n < _mask; n++) {
+              // Obtenemos el bit a transmitir
+              uint8_t bitMasked = bitRead(bRead, 7 - n);
+
+              // Si el bit leido del BYTE es un "1"
+              if (bitMasked == 1) {
+                // Procesamos "1"
+                oneTone();
+              } else {
+                // En otro caso
+                // procesamos "0"
+                zeroTone();
+              }
             }
           }
 
@@ -1051,6 +1030,7 @@ private:
             BYTES_LAST_BLOCK = bytes_in_this_block;
           }
         } else {
+          _edges.clear();
           return;
         }
 
@@ -1065,6 +1045,9 @@ private:
               ((PRG_BAR_OFFSET_INI + (ptrOffset + 1)) * 100) /
               PRG_BAR_OFFSET_END;
       }
+
+      // Lo que quede en la lista de flancos
+      renderEdgeList();
     }
   }
 
@@ -1073,16 +1056,18 @@ public:
 
   void set_maskLastByte(uint8_t mask) { _mask_last_byte = mask; }
 
-  void silenceDR(double duration, double sr) {
-    // la duracion se da en ms
-    LAST_SILENCE_DURATION = duration;
+  void beginDRBlock(uint32_t tstatesPerSample) {
+    // Inicio de un bloque Direct Recording. El codec sigue a SAMPLING_RATE;
+    // solo cambia la duración de cada muestra del bloque en T-states.
+    _drSampleTStates = (tstatesPerSample > 0) ? tstatesPerSample : 1;
+    _drRunLen = 0;
+    _edges.clear();
+  }
 
-    // Paso la duración a T-States
-    double parts = 0, fractPart, intPart, terminator_samples = 0;
-    int lastPart = 0;
-    int tStateSilence = 0;
-    int tStateSilenceOri = 0;
-    double samples = 0;
+  void silenceDR(double duration) {
+    // la duracion se da en ms. La pausa mantiene el nivel de la última
+    // muestra del bloque.
+    LAST_SILENCE_DURATION = duration;
 
 #ifdef DEBUGMODE
     log("Silencio: " + String(duration) + " ms");
@@ -1091,56 +1076,31 @@ public:
     // El silencio siempre acaba en un pulso de nivel bajo
     // Si no hay silencio, se pasas tres kilos del silencio y salimos
     if (duration > 0) {
-      // tStateSilenceOri = tStateSilence;
-      // tStateSilence = (duration / OneSecondTo_ms) * freqCPU;
-      // logln("Sampling rate for SILENCE: " + String(SAMPLING_RATE));
-      samples = ((duration / 1000.0) * sr);
+      uint64_t tstates = msToTStates(duration);
 
-      if (duration < 500.0) {
-        // Calculamos el error y agregamos una muestra si es necesario
-        int samples_int = (int)samples;
-        double duration_int = samples_int / sr * 1000.0;
-
-        if ((duration_int - duration) > 0.01) {
-          samples++;
-        }
+      // Esto es para máquinas como el 48K
+      if (duration >= 1000) {
+        // Añadimos ms extras para maquinas como el 48K
+        tstates += (uint64_t)(SILENCE_COMPENSATION_48K * freqCPU);
       }
 
-#ifdef DEBUGMODE
-      log("Samples: " + String(samples));
-#endif
-
-      // Generador de pulsos exclusivo para silencios
-      int swidth = round(samples);
-      if (swidth > 0) {
-
-        // Esto es para máquinas como el 48K
-        if (duration >= 1000) {
-          // Añadimos ms extras para maquinas como el 48K
-          int addsmp = (int)(SILENCE_COMPENSATION_48K * SAMPLING_RATE);
-          swidth += addsmp;
+      if (tstates > 0) {
+        _edges.clear();
+        if (pushEdge((uint32_t)min(tstates, (uint64_t)0xFFFFFFFF), EDGE_KEEP)) {
+          renderEdgeList();
         }
-        //
-        pulseSilence(swidth);
       }
-
-      // #ifdef DEBUGMODE
-      //     log("..ACU_ERROR: " + String(ACU_ERROR));
-      // #endif
-
-      // //insertamos el error de silencio calculado
-      // insertSamplesError(ACU_ERROR,false);
     } else {
       EDGE_EAR_IS ^= 1; // Alternamos el nivel del EAR para el siguiente pulso
     }
+
+    flushPulseBlock();
   }
 
   void silence(double duration, bool changeNextEARedge = true,
                bool pzxForzeLevel = false) {
     // la duracion se da en ms
     LAST_SILENCE_DURATION = duration;
-    ACU_ERROR = 0;
-    double samples = 0;
 
 #ifdef DEBUGMODE
     logln("Silencio: " + String(duration) + " ms");
@@ -1150,17 +1110,18 @@ public:
 
     // Generar silencio adicional si duration > 0
     if (duration > 0.0) {
-      samples = (duration / 1000.0) * SAMPLING_RATE;
-      int swidth = (int)samples;
+      uint64_t tstates = msToTStates(duration);
 
       // Esto es para máquinas como el 48K
       if (duration >= 1000) {
         // Añadimos ms extras para maquinas como el 48K
-        int addsmp = (int)(SILENCE_COMPENSATION_48K * SAMPLING_RATE);
-        swidth += addsmp;
+        tstates += (uint64_t)(SILENCE_COMPENSATION_48K * freqCPU);
       }
 
-      pulseSilence(swidth);
+      _edges.clear();
+      if (pushEdge((uint32_t)min(tstates, (uint64_t)0xFFFFFFFF))) {
+        renderEdgeList();
+      }
 
     } else {
       // Si el silencio es 0 al menos tengo que replicar el ultimo semipulso
@@ -1175,20 +1136,14 @@ public:
       // EDGE_EAR_IS ^= 1; // Alternamos el nivel del EAR para el siguiente
       // pulso
     }
+
+    // Fin de bloque. Volcamos lo pendiente
+    flushPulseBlock();
   }
 
   void silencePZX(double duration, bool initialLevelLow) {
     // la duracion se da en ms
     LAST_SILENCE_DURATION = duration;
-    // ADD_ONE_SAMPLE_COMPENSATION = false;
-    ACU_ERROR = 0;
-
-    // Paso la duración a T-States
-    // double parts = 0, fractPart, intPart, terminator_samples = 0;
-    // int lastPart = 0;
-    // int tStateSilence = 0;
-    // int tStateSilenceOri = 0;
-    double samples = 0;
 
 #ifdef DEBUGMODE
     log("Silencio: " + String(duration) + " ms");
@@ -1200,43 +1155,42 @@ public:
       // tStateSilence = (duration / OneSecondTo_ms) * freqCPU;
       // logln("Sampling rate for SILENCE: " + String(SAMPLING_RATE));
 
-      // Calculamos el numero de samples
-      samples = (duration / 1000.0) * SAMPLING_RATE;
+      uint64_t tstates = msToTStates(duration);
 
-      // Generador de pulsos exclusivo para silencios
-      int swidth = (int)samples;
-      if (swidth > 0) {
-        logln("Samples of the SILENCE: " + String(duration) + " is " +
-              String(swidth));
-        pulseSilencePZX(swidth, initialLevelLow);
+      if (tstates > 0) {
+        logln("T-states of the SILENCE: " + String(duration) + " is " +
+              String((double)tstates, 0));
+        // El silencio PZX alterna respecto al nivel inicial indicado
+        EDGE_EAR_IS = initialLevelLow ? down : up;
+        _edges.clear();
+        if (pushEdge((uint32_t)min(tstates, (uint64_t)0xFFFFFFFF))) {
+          renderEdgeList();
+        }
       }
     }
+
+    flushPulseBlock();
   }
 
   void pulsePZX(int width, bool initialLevelLow) {
     // Para PZX
-    ADD_ONE_SAMPLE_COMPENSATION = false;
     semiPulsePZX((double)width, initialLevelLow);
-    ACU_ERROR = 0;
   }
 
   void pulse(int width) {
     // Para PZX
-    ADD_ONE_SAMPLE_COMPENSATION = false;
     semiPulse((double)width);
-    ACU_ERROR = 0;
   }
 
   void playPulse(int lenPulse) {
     // Para PZX
-    ADD_ONE_SAMPLE_COMPENSATION = false;
     semiPulse((double)lenPulse);
-    ACU_ERROR = 0;
   }
 
   void playPureTone(int lenPulse, int numPulses) {
     // syncronize with short leader tone
     customPilotTone(lenPulse, numPulses);
+    flushPulseBlock();
   }
 
   void playCustomSequence(int *data, int numPulses, long calibrationValue = 0) {
@@ -1244,97 +1198,243 @@ public:
     // Esto lo usamos para el PULSE_SEQUENCE ID-13
     //
 
-    double samples = 0;
-    double rsamples = 0;
-    int ptrOffset = 0;
-
+    _edges.clear();
     for (int i = 0; i < numPulses; i++) {
-      ADD_ONE_SAMPLE_COMPENSATION = false;
-      semiPulse((double)data[i]);
-      ACU_ERROR = 0;
-      ptrOffset = i;
+      if (!pushEdge(data[i]) || !renderEdgeListIfFull()) {
+        _edges.clear();
+        return;
+      }
+    }
+    renderEdgeList();
+
+    flushPulseBlock();
+  }
+
+  void playCSW(CSWStream &csw, uint32_t sampleRate) {
+    // Pulsos CSW (en muestras a sampleRate) a T-states. El resto de cada
+    // division se arrastra al siguiente pulso para no acumular deriva.
+    uint64_t cpu = (uint64_t)DfreqCPU;
+    uint64_t acc = 0;
+    uint32_t samples;
+    int n = 0;
+
+    _edges.clear();
+    while (csw.nextPulse(samples)) {
+      acc += (uint64_t)samples * cpu;
+      uint32_t tstates = (uint32_t)(acc / sampleRate);
+      acc -= (uint64_t)tstates * sampleRate;
+
+      if (!pushEdge(tstates) || !renderEdgeListIfFull()) {
+        _edges.clear();
+        return;
+      }
+
+      if ((++n & 0xFF) == 0) {
+        PROGRESS_BAR_BLOCK_VALUE = csw.getProgress();
+      }
     }
+    renderEdgeList();
+
+    if (csw.failed()) {
+      logln("CSW: block ended with errors after " + String(n) + " pulses");
+    }
+    PROGRESS_BAR_BLOCK_VALUE = 100;
   }
 
-  void playGDB(tSymbol *symbol) {
-    // Reproducir Generalized Data Block
-    int pulseCount = 0;
+  bool prepareGDB(tSymbol *symbol) {
+    // Genera las plantillas de flancos de las tablas de símbolos de un
+    // bloque ID 0x19. Lo llama el analizador al leer el bloque o al
+    // recuperarlo del .dsc, nunca la reproducción: la arena no admite
+    // reservas desde dos tareas a la vez.
+    if (symbol->TOTP > 0 && symbol->symDefPilot != nullptr &&
+        symbol->pilotEdges == nullptr &&
+        !buildSymbolTemplates(symbol->symDefPilot, symbol->ASP, symbol->NPP,
+                              symbol->pilotEdges, symbol->pilotEdgeStart)) {
+      return false;
+    }
+
+    if (symbol->symDefData == nullptr) {
+      return symbol->TOTD == 0;
+    }
+
+    if (symbol->dataEdges != nullptr) {
+      return true;
+    }
+
+    return buildSymbolTemplates(symbol->symDefData, symbol->ASD, symbol->NPD,
+                                symbol->dataEdges, symbol->dataEdgeStart);
+  }
+
+  bool gdbReady(const tSymbol *symbol) {
+    // Plantillas ya generadas por prepareGDB()
+    return (symbol->TOTP == 0 || symbol->pilotEdges != nullptr) &&
+           (symbol->TOTD == 0 || symbol->dataEdges != nullptr);
+  }
+
+  void playMSX(const tTimming &t, File &file, int offset, int length) {
+    // Reproducir ID 0x4B (MSX). Pilot de semi-pulsos iguales y después cada
+    // byte como una plantilla de buildMSXTable(). Los datos se leen del
+    // fichero en trozos de GDB_STREAM_CHUNK.
+#ifdef DEBUGMODE
+    logln("ID 0x4B: bitcfg 0x" + String(t.bitcfg, HEX) + ", bytecfg 0x" +
+          String(t.bytecfg, HEX) + ", bit 0 " + String(t.bit_0) +
+          " T, bit 1 " + String(t.bit_1) + " T, " + String(length) +
+          " bytes");
+#endif
+    if (!buildMSXTable(t)) {
+      logln("MSX: cannot build byte templates");
+      return;
+    }
+
+    _edges.clear();
+    for (int p = 0; p < t.pilot_num_pulses; p++) {
+      if (!pushEdge(t.pilot_len) || !renderEdgeListIfFull()) {
+        _edges.clear();
+        return;
+      }
+    }
+
+    uint8_t chunk[GDB_STREAM_CHUNK];
+    for (int done = 0; done < length;) {
+      int n = min(length - done, GDB_STREAM_CHUNK);
+      file.seek(offset + done);
+      if (file.read(chunk, n) != n) {
+        logln("MSX: error reading data");
+        _edges.clear();
+        return;
+      }
+
+      for (int k = 0; k < n; k++) {
+        uint8_t b = chunk[k];
+        if (!appendEdges(_msxEdges + _msxStart[b],
+                         _msxStart[b + 1] - _msxStart[b]) ||
+            !renderEdgeListIfFull()) {
+          _edges.clear();
+          return;
+        }
+      }
+
+      done += n;
+      PROGRESS_BAR_BLOCK_VALUE = (int)(((int64_t)done * 100) / length);
+    }
+
+    renderEdgeList();
+  }
+
+  void playGDB(tSymbol *symbol, File &file, int blockSize) {
+    // Reproducir Generalized Data Block. Cada símbolo es una plantilla de
+    // flancos ya codificada, así que el bloque se reduce a concatenar
+    // plantillas en la lista de flancos. El data stream se lee del fichero
+    // en trozos de GDB_STREAM_CHUNK.
+    if (!gdbReady(symbol)) {
+      logln("GDB: symbol templates not available");
+      return;
+    }
+
+    // La polaridad de cada símbolo va en el modo de su primer flanco
+    KEEP_CURRENT_EDGE = false;
+    _edges.clear();
+
     // Primero, pilot/sync stream
-    if (symbol->TOTP > 0) {
-      for (int i = 0; i < symbol->TOTP; i++) {
-        int symIndex = symbol->pilotStream[i].symbol;
-        int repeat = symbol->pilotStream[i].repeat;
-        for (int r = 0; r < repeat; r++) {
-          playSymbol(symbol->symDefPilot[symIndex], symbol->NPP, pulseCount);
-          if (stopOrPauseRequest())
-            return;
+    for (int i = 0; i < symbol->TOTP && symbol->pilotEdges != nullptr; i++) {
+      int symIndex = symbol->pilotStream[i].symbol;
+      if (symIndex >= symbol->ASP) {
+        continue;
+      }
+
+      const uint32_t *tpl = symbol->pilotEdges + symbol->pilotEdgeStart[symIndex];
+      int len = symbol->pilotEdgeStart[symIndex + 1] -
+                symbol->pilotEdgeStart[symIndex];
+
+      for (int r = 0; r < symbol->pilotStream[i].repeat; r++) {
+        if (!appendEdges(tpl, len) || !renderEdgeListIfFull()) {
+          _edges.clear();
+          return;
         }
       }
     }
 
-    // Luego, data stream
+    // Luego, data stream. NB = ceil(log2(ASD)) bits por símbolo, MSB primero
     int NB = 0;
-    int temp = symbol->ASD;
-    while (temp > 1) {
-      temp >>= 1;
+    while ((1 << NB) < symbol->ASD) {
       NB++;
     }
-    if ((1 << NB) < symbol->ASD)
-      NB++;
+    int DS = ((NB * symbol->TOTD) + 7) / 8;
+    uint32_t symMask = (1 << NB) - 1;
+
+    // Los bits se leen de palabra en palabra: el acumulador se rellena con
+    // varios bytes a la vez y de él se sacan los NB bits de cada símbolo
+    uint32_t bits = 0;
+    int numBits = 0;
+    int byteIdx = 0;
+    uint8_t chunk[GDB_STREAM_CHUNK];
+    int chunkPos = 0;
+    int chunkLen = 0;
 
-    int bitPos = 0;
     for (int i = 0; i < symbol->TOTD; i++) {
-      // Extraer NB bits del data stream, LSB first in byte = LSB first in
-      // symbol
-      int symbolIndex = 0;
-      for (int b = 0; b < NB; b++) {
-        int byteIndex = bitPos / 8;
-        int bitInByte = bitPos % 8; // LSB first in byte
-        if (symbol->dataStream[byteIndex] & (1 << bitInByte)) {
-          symbolIndex |= (1 << b); // LSB first in symbol
+      if (numBits < NB) {
+        while (numBits <= 24 && byteIdx < DS) {
+          if (chunkPos == chunkLen) {
+            file.seek(symbol->offsetDataStream + byteIdx);
+            chunkLen = file.read(chunk, min(DS - byteIdx, GDB_STREAM_CHUNK));
+            chunkPos = 0;
+            if (chunkLen <= 0) {
+              logln("GDB: error reading data stream");
+              _edges.clear();
+              return;
+            }
+          }
+          bits = (bits << 8) | chunk[chunkPos++];
+          byteIdx++;
+          numBits += 8;
         }
-        bitPos++;
       }
 
-      playSymbol(symbol->symDefData[symbolIndex], symbol->NPD, pulseCount);
-      if (stopOrPauseRequest())
+      numBits -= NB;
+      uint32_t symIndex = (bits >> numBits) & symMask;
+
+      if ((int)symIndex < symbol->ASD &&
+          !appendEdges(symbol->dataEdges + symbol->dataEdgeStart[symIndex],
+                       symbol->dataEdgeStart[symIndex + 1] -
+                           symbol->dataEdgeStart[symIndex])) {
+        _edges.clear();
         return;
-    }
-    SerialHW.println("Data stream done, total pulses: " + String(pulseCount));
-  }
+      }
 
-  void playSymbol(tSymDef symDef, int maxPulses, int &pulseCount) {
-    // Reproducir un símbolo: aplicar flags y reproducir pulsos
-    uint8_t flags = symDef.symbolFlag;
-    bool polarityChange = true;
-    if ((flags & 0x03) == 0x01)
-      polarityChange = false; // same as current level
-    else if ((flags & 0x03) == 0x02)
-      forzeLowLevel = true; // force low
-    else if ((flags & 0x03) == 0x03)
-      forzeHighLevel = true; // force high
+      if (!renderEdgeListIfFull()) {
+        _edges.clear();
+        return;
+      }
 
-    for (int p = 0; p < maxPulses; p++) {
-      int pulseLen = symDef.pulse_array[p];
-      if (pulseLen == 0)
-        break; // zero-length pulse terminates
-      ADD_ONE_SAMPLE_COMPENSATION = false;
-      semiPulse((double)pulseLen);
-      // polarityChange = !polarityChange; // alternate for next pulse
-      pulseCount++;
+      // Barra de progreso
+      if ((i & 0xFF) == 0) {
+        PROGRESS_BAR_BLOCK_VALUE = (i * 100) / symbol->TOTD;
+        if (BYTES_TOBE_LOAD > 0) {
+          PROGRESS_BAR_TOTAL_VALUE =
+              ((PRG_BAR_OFFSET_INI + (int)(((int64_t)blockSize * i) /
+                                           symbol->TOTD)) *
+               100) /
+              BYTES_TOBE_LOAD;
+        }
+      }
     }
+
+    renderEdgeList();
   }
 
   void playCustomSymbol(int pulsewidth, int repeat) {
     //
     // Esto lo usamos para el GENERALIZA DATA BLOCK ID-19
     //
+    // Generamos los semipulsos
+    _edges.clear();
     for (int i = 0; i < repeat; i++) {
-      // Generamos los semipulsos
-      ADD_ONE_SAMPLE_COMPENSATION = false;
-      semiPulse((double)pulsewidth);
-      ACU_ERROR = 0;
+      if (!pushEdge(pulsewidth) || !renderEdgeListIfFull()) {
+        _edges.clear();
+        return;
+      }
     }
+    renderEdgeList();
   }
 
   void playData(uint8_t *bBlock, int lenBlock, int pulse_len, int num_pulses) {
@@ -1348,7 +1448,6 @@ public:
     // Put now code block
     // syncronize with short leader tone
     // long t1=millis();
-    ADD_ONE_SAMPLE_COMPENSATION = false;
     pilotTone(pulse_len, num_pulses);
     // long t2=millis();
 
@@ -1381,7 +1480,6 @@ public:
     }
 
     // Silent tone
-    ACU_ERROR = 0;
     silence(silent);
 
     // log("Send SILENCE");
@@ -1408,94 +1506,49 @@ public:
       total_bits_to_process = ((size - 1) * 8) + _mask_last_byte;
     }
 
-    // =====================================================
-    // OPTIMIZACIÓN: Usar buffer para escribir en chunks
-    // en lugar de llamar a sampleDR() para cada bit
-    // =====================================================
-    const int BUFFER_SAMPLES = 512; // Número de muestras por chunk
-    const int BUFFER_BYTES =
-        BUFFER_SAMPLES * 2 * channels; // 2 bytes por muestra, stereo
-    uint8_t audio_buffer[BUFFER_BYTES];
-    int16_t *ptr = (int16_t *)audio_buffer;
-    int samples_in_buffer = 0;
-
-    // Pre-calcular amplitudes ajustadas por volumen
-    uint16_t sample_up_R =
-        (uint16_t)(maxLevelUp * (MAIN_VOL_R / 100.0) * (MAIN_VOL / 100.0));
-    uint16_t sample_up_L =
-        (uint16_t)(maxLevelUp * (MAIN_VOL_L / 100.0) * (MAIN_VOL / 100.0));
-    uint16_t sample_down_R =
-        (uint16_t)(maxLevelDown * (MAIN_VOL_R / 100.0) * (MAIN_VOL / 100.0));
-    uint16_t sample_down_L =
-        (uint16_t)(maxLevelDown * (MAIN_VOL_L / 100.0) * (MAIN_VOL / 100.0));
-
-    // Ajustar canal L si ACTIVE_AMP está activo
-    if (ACTIVE_AMP) {
-      sample_up_L = sample_up_L * EN_SPEAKER;
-      sample_down_L = sample_down_L * EN_SPEAKER;
-    }
-
-    int current_bit_count = 0;
+    // 3. Las muestras iguales se agrupan en tramos y solo los cambios de
+    //    nivel llegan a la lista de flancos. Un byte 0x00 o 0xFF se salta
+    //    entero sin mirar bit a bit.
+    int full_bytes = total_bits_to_process / 8;
 
-    // 3. Iterar por cada byte del trozo
-    for (int byte_idx = 0; byte_idx < size; byte_idx++) {
+    for (int byte_idx = 0; byte_idx < full_bytes; byte_idx++) {
       uint8_t current_byte = bBlock[byte_idx];
 
-      // 4. Iterar por cada bit del byte (de MSB a LSB)
-      for (int bit_idx = 7; bit_idx >= 0; bit_idx--) {
-        // 5. Si ya hemos procesado todos los bits necesarios, salir del bucle.
-        if (current_bit_count >= total_bits_to_process) {
-          break;
-        }
-
-        // Obtenemos el bit actual
-        uint8_t bit_value = (current_byte >> bit_idx) & 1;
-
-        // Añadir muestra al buffer
-        if (bit_value == 1) {
-          *ptr++ = sample_up_R;
-          *ptr++ = sample_up_L;
-        } else {
-          *ptr++ = sample_down_R;
-          *ptr++ = sample_down_L;
-        }
-
-        samples_in_buffer++;
-        current_bit_count++;
-
-        // Cuando el buffer está lleno, escribir al stream
-        if (samples_in_buffer >= BUFFER_SAMPLES) {
-          int bytes_to_write = samples_in_buffer * 2 * channels;
-
-          if (OUT_TO_WAV) {
-            encoderOutWAV.write(audio_buffer, bytes_to_write);
-          } else {
-            kitStream.write(audio_buffer, bytes_to_write);
-          }
-
-          // Reset buffer
-          ptr = (int16_t *)audio_buffer;
-          samples_in_buffer = 0;
+      if ((current_byte == 0x00 || current_byte == 0xFF) &&
+          _drRunLen > 0 && _drRunBit == (current_byte & 1) &&
+          _drRunLen + 8 < EDGE_TSTATES_MASK / _drSampleTStates) {
+        _drRunLen += 8;
+        continue;
+      }
 
-          // Check stop/pause menos frecuentemente
-          if (stopOrPauseRequest())
-            return;
-        }
+      // 4. Iterar por cada bit del byte (de MSB a LSB)
+      bool edgesOk = true;
+      for (int bit_idx = 7; bit_idx >= 0 && edgesOk; bit_idx--) {
+        edgesOk = drSample((current_byte >> bit_idx) & 1);
       }
 
-      if (current_bit_count >= total_bits_to_process) {
-        break;
+      if (!edgesOk || pendingStopOrPause()) {
+        _edges.clear();
+        _drRunLen = 0;
+        return;
       }
     }
 
-    // Escribir muestras restantes en el buffer
-    if (samples_in_buffer > 0) {
-      int bytes_to_write = samples_in_buffer * 2 * channels;
+    // Bits sueltos del último byte
+    for (int n = 0; n < total_bits_to_process - full_bytes * 8; n++) {
+      if (!drSample((bBlock[full_bytes] >> (7 - n)) & 1)) {
+        _edges.clear();
+        _drRunLen = 0;
+        return;
+      }
+    }
 
-      if (OUT_TO_WAV) {
-        encoderOutWAV.write(audio_buffer, bytes_to_write);
+    // 5. Al final del bloque cerramos el último tramo y lo renderizamos
+    if (isThelastDataPart) {
+      if (pushDRRun()) {
+        renderEdgeList();
       } else {
-        kitStream.write(audio_buffer, bytes_to_write);
+        _edges.clear();
       }
     }
   }
@@ -1548,13 +1601,10 @@ public:
           // Obtenemos el bit a transmitir
           uint8_t bitMasked = bitRead(bRead, 7 - n);
 
-          // Si el bit leido del BYTE es un "1"
-          if (bitMasked == 1) {
-            // bit "1"
-            sampleDR(1, maxLevelUp);
-          } else {
-            // bit "0"
-            sampleDR(1, maxLevelDown);
+          if (!drSample(bitMasked)) {
+            _edges.clear();
+            _drRunLen = 0;
+            return;
           }
         }
 
@@ -1575,6 +1625,16 @@ public:
       PROGRESS_BAR_BLOCK_VALUE =
           ((PRG_BAR_OFFSET_INI + (ptrOffset + 1)) * 100) / PRG_BAR_OFFSET_END;
     }
+
+    if (isThelastDataPart) {
+      if (pushDRRun()) {
+        renderEdgeList();
+      } else {
+        _edges.clear();
+      }
+    }
+
+    flushPulseBlock();
   }
 
   void playPureData(uint8_t *bBlock, int lenBlock) {
@@ -1598,12 +1658,13 @@ public:
 
     if (silent > 0) {
       // Silent tone (silence() ya maneja el terminador y nivel LOW)
-      ACU_ERROR = 0;
       silence(silent);
 
       if (LOADING_STATE == 2) {
         return;
       }
+    } else {
+      flushPulseBlock();
     }
   }
 
@@ -1612,9 +1673,8 @@ public:
     // ya que es parte de un bloque completo que ha sido partido en varios
     sendDataArray(bBlock, lenBlock, false);
 
-    if (LOADING_STATE == 2) {
-      return;
-    }
+    // La siguiente partición se lee de la SD. Volcamos antes lo pendiente
+    flushPulseBlock();
   }
 
   void playDataBegin(uint8_t *bBlock, int lenBlock, int pulse_len,
@@ -1622,7 +1682,6 @@ public:
     // PROGRAM
     // double duration = tState * pulse_pilot_duration;
     // syncronize with short leader tone
-    ADD_ONE_SAMPLE_COMPENSATION = false;
     pilotTone(pulse_len, num_pulses);
     // syncronization for end short leader tone
     syncTone(SYNC1);
@@ -1630,6 +1689,7 @@ public:
 
     // Send data
     sendDataArray(bBlock, lenBlock, false);
+    flushPulseBlock();
   }
 
   void playDataEnd(uint8_t *bBlock, int lenBlock) {
@@ -1637,7 +1697,6 @@ public:
     sendDataArray(bBlock, lenBlock, true);
 
     // Silent tone
-    ACU_ERROR = 0;
     silence(silent);
   }
 
@@ -1659,7 +1718,6 @@ public:
     logln("Starting test");
     _hmi.writeString("g0.txt=\"Test signal playing. Press STOP for end\"");
     // Generamos una onda de 256 muestras
-    int bytes = 0;
     int samples = 256;
     uint16_t sample_L = 0;
     uint16_t sample_R = 0;
@@ -1667,29 +1725,24 @@ public:
     sample_R = (uint16_t)(32768 * (MAIN_VOL_R / 100.0) * (MAIN_VOL / 100.0));
     sample_L = (uint16_t)(32768 * (MAIN_VOL_L / 100.0) * (MAIN_VOL / 100.0));
 
-    bytes = samples * 2 * channels;
-
     while (!STOP) {
       // Lanzamos 10 pulsos de 256 muestras
       // tono
       samples = 60;
-      bytes = samples * 2 * channels;
       for (int i = 0; i < 8063; i++) {
-        createPulse(samples, bytes, sample_R, sample_L);
+        createPulse(samples, sample_R, sample_L);
         sample_R *= -1;
         sample_L *= -1;
       }
 
       // Silencio 3458ms
       samples = 256;
-      bytes = samples * 2 * channels;
       for (int i = 0; i < 1296; i++) {
-        createPulse(samples, bytes, sample_R, sample_L);
+        createPulse(samples, sample_R, sample_L);
       }
 
       samples = 192;
-      bytes = samples * 2 * channels;
-      createPulse(samples, bytes, sample_R, sample_L);
+      createPulse(samples, sample_R, sample_L);
 
       sample_R *= -1;
       sample_L *= -1;
@@ -1704,6 +1757,5 @@ public:
   // Constructor
   ZXProcessor() {
     // Constructor de la clase
-    ACU_ERROR = 0;
   }
 };
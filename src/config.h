@@ -85,6 +85,73 @@
 // Tarea del Core 1 - HMI (Task0code - HMI, FTP, etc.) - Más ligera
 #define TASK0_STACK_SIZE 8192 // Defecto 8192
 
+// --------------------------------------------------------------
+// Buffer de salida de audio (PCM ring)
+// --------------------------------------------------------------
+// Los procesadores de cinta sintetizan en un buffer circular en PSRAM y una
+// tarea dedicada lo vuelca al I2S. Así una lectura lenta de la SD o del HMI
+// no se traduce en un hueco en el audio. Comentar para escribir directamente.
+#define PCM_RING_ENABLE
+// Profundidad del buffer en bytes (potencia de 2). 131072 bytes son unos 340ms a 96KHz estereo 16 bits
+#define PCM_RING_SIZE (128 * 1024)
+// Maximo de bytes que la tarea de salida escribe de una vez en el stream
+#define PCM_RING_CHUNK 4096
+#define TASK_AUDIO_OUT_STACK_SIZE 4096
+
+// --------------------------------------------------------------
+// Cache de bloques renderizados
+// --------------------------------------------------------------
+// Al reproducir un bloque de datos (TAP / TZX ID 0x10, 0x11, 0x14, 0x19 y
+// 0x4B) se guarda en PSRAM la secuencia de tramos (muestras + nivel) que
+// genera. Si el bloque se vuelve a reproducir (REW/FF, loops, reanudar) se
+// vuelca desde la cache sin leer la SD ni recalcular pulsos. Solo se guarda lo
+// que ya ha sonado: no se generan bloques por adelantado, porque el render
+// comparte con la reproduccion el nivel de la señal y el reloj de T-states.
+// Comentar para desactivar.
+#define BLOCK_CACHE_ENABLE
+// Memoria maxima en PSRAM para la cache (bytes). Un bloque de 48K ocupa ~450KB
+#define BLOCK_CACHE_SIZE (1536 * 1024)
+// Numero maximo de bloques en cache
+#define BLOCK_CACHE_SLOTS 16
+// Niveles distintos (frames estereo) por bloque
+#define BLOCK_CACHE_PALETTE 8
+
+// --------------------------------------------------------------
+// Lectura de ficheros de cinta
+// --------------------------------------------------------------
+// Ventana de lectura anticipada (PSRAM) para analizar los bloques al abrir un
+// fichero. Los campos de cabecera se sirven desde la ventana y la SD solo se
+// lee cuando un campo cae fuera de ella.
+#define FILE_WINDOW_SIZE (32 * 1024)
+// Trozo de PSRAM de la arena de la que salen los datos de los descriptores
+// (pulsos, simbolos, CSW...). Se libera entera al expulsar la cinta.
+#define PARSE_ARENA_CHUNK (64 * 1024)
+// Los bloques CSW (ID 0x18) y los datos de los ID 0x19 no se cargan al
+// analizar la cinta: se leen de la SD en trozos de este tamaño al reproducir
+#define CSW_STREAM_CHUNK (4 * 1024)
+#define GDB_STREAM_CHUNK 512
+// Indice de bloques (.dsc) junto a cada TZX/TSX/CDT/PZX. La primera apertura
+// lo genera y las siguientes cargan los descriptores de una sola lectura sin
+// volver a analizar el fichero. Comentar para desactivar.
+#define DSC_INDEX_ENABLE
+// Los TZX/TSX/CDT se analizan en una tarea aparte (core 1) que va publicando
+// los bloques según los describe. PLAY puede empezar en cuanto está el primero
+// y solo espera si alcanza al analizador. Comentar para analizar antes de PLAY.
+#define TZX_PARSE_TASK_ENABLE
+#define TASK_PARSE_STACK_SIZE 16384
+
+// --------------------------------------------------------------
+// Conversion de cintas (TAP->TZX, cualquiera->PZX / WAV)
+// --------------------------------------------------------------
+// Se reproduce la cinta sin audio y la salida se escribe en /CONV (PZX, TZX)
+// o /WAV, tan rapido como lo permitan la CPU y la SD.
+// Escrituras a la SD agrupadas en trozos de este tamaño (PSRAM)
+#define OFFLINE_WRITE_BUFFER_SIZE (64 * 1024)
+// Tamaño maximo de cada bloque PULS al escribir un PZX
+#define OFFLINE_PZX_PULS_CHUNK (16 * 1024)
+// Los T-states de un PZX son siempre de 3.5MHz
+#define PZX_CPU_FREQ 3500000
+
 // Definimos la ganancia de la entrada de linea (para RECORDING)
 #define WORKAROUND_ES8388_LINE1_GAIN MIC_GAIN_MAX
 #define WORKAROUND_ES8388_LINE2_GAIN MIC_GAIN_MAX
@@ -216,7 +283,6 @@ int GPIO_MSX_REMOTE_PAUSE = 19;
 #define PAUSE_TAIL_SAMPLES (0.002 / STANDARD_SR_8_BIT_MACHINE)
 #define PAUSE_TAIL_TSTATES 3500 * 2000 // Minimo debe ser 1S (3500000 TStates)
 #define SILENCE_COMPENSATION_48K 0.5
-#define APPLY_ACCU_ERROR_ON_SILENCE false
 
 // #define STANDARD_SR_8_BIT_MACHINE                     31250   // Sampling
 // rate adecuado para maquinas de 8 bitsAjuste AZIMUT (Hz) - 22200 Hz
@@ -315,8 +381,15 @@ int GPIO_MSX_REMOTE_PAUSE = 19;
         // (Hz) - 22200 Hz
 //
 // ----------------------------------------------------------------------------------------------
-// Particion mas pequeña de un silencio
-#define MIN_FRAME_FOR_SILENCE_PULSE_GENERATION 1024
+// Tamaño (en frames estereo de 16 bits) del bloque de salida del renderizador de pulsos.
+// STOP/PAUSE/REM se comprueban una vez por bloque volcado.
+#define PULSE_RENDER_BLOCK_FRAMES              2048
+// Semi-pulsos que se acumulan en la lista de flancos antes de renderizarlos
+#define EDGE_LIST_CHUNK                        1024
+// PZX DATA: tabla de semi-pulsos por valor de byte (1024 * (p0 + p1) flancos).
+// Solo si los simbolos son cortos y el bloque tiene bits suficientes
+#define PZX_BYTE_TABLE_MAX_PULSES              16
+#define PZX_BYTE_TABLE_MIN_BITS                2048
 #define MOTOR_DELAY_MS                         20 // Retardo de arranque/parada de motor en ms (20ms = 50Hz)
 
 // --------------------------------------------------------------
@@ -333,7 +406,8 @@ int GPIO_MSX_REMOTE_PAUSE = 19;
 
 // Maximo número de bloques para el descriptor.
 #define MAX_BLOCKS_IN_TAP 4000
-#define MAX_BLOCKS_IN_TZX 4000
+// Los descriptores de TZX se reservan por trozos, sin maximo
+#define TZX_DESCRIPTOR_CHUNK 64
 
 // Configuracion del test in/out
 bool TEST_LINE_IN_OUT = false;
@@ -38,6 +38,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <string>
+#include <atomic>
 
 #define up 1
 #define down 0
@@ -104,6 +105,7 @@ struct ConfigEntry {
   void *value; // Pointer to the configuration value
 };
 
+// Una entrada de un bloque PZX PULS, tal y como se decodifica al reproducir
 struct tRlePulse {
   uint32_t pulse_len; // Longitud del pulso en T-States (puede ser hasta 31 bits
                       // en PZX)
@@ -126,13 +128,9 @@ struct tTimming {
   int bytecfg = 0;
   int csw_sampling_rate;
   int csw_compression_type;
-  int csw_num_pulses;        // ✅ AÑADIR: Número de pulsos en la secuencia RLE
-  tRlePulse *csw_pulse_data; // ✅ AÑADIR: Puntero a la secuencia de pulsos RLE
-
-  // PARA PZX
-  int pzx_num_pulses;        // Número de pulsos en un bloque PULS
-  tRlePulse *pzx_pulse_data; // Puntero a la secuencia de pulsos (reutilizamos
-                             // tRlePulse)
+  int csw_num_pulses;  // Pulsos según la cabecera del bloque
+  int csw_data_offset; // Datos RLE / Z-RLE en el fichero (ver CSWStream)
+  int csw_data_size;
 };
 
 struct tSymDef {
@@ -159,9 +157,14 @@ struct tSymbol {
   tSymDef *symDefPilot = nullptr; // Pilot and Sync definition table
   tSymDef *symDefData = nullptr;  // Data definition table
   tPrle *pilotStream = nullptr;   // Pilot and sync data stream
-  int offsetDataStream = 0;
+  int offsetDataStream = 0; // El data stream se lee del fichero al reproducir
   int offsetPilotDataStream = 0;
-  uint8_t *dataStream = nullptr; // Data stream
+  // Plantillas de flancos (formato EdgeList) de cada símbolo. Se generan la
+  // primera vez que se reproduce el bloque. El símbolo k ocupa [edgeStart[k], edgeStart[k + 1])
+  uint32_t *pilotEdges = nullptr;
+  uint16_t *pilotEdgeStart = nullptr;
+  uint32_t *dataEdges = nullptr;
+  uint16_t *dataEdgeStart = nullptr;
 };
 
 // Estructura del descriptor de bloques
@@ -179,6 +182,11 @@ struct tTAPBlockDescriptor {
   bool playeable = true;
 };
 
+// Resultado del checksum de un bloque de datos (tTZXBlockDescriptor::chkStatus)
+#define BLOCK_CHK_NONE 0 // Sin checksum que verificar
+#define BLOCK_CHK_OK 1
+#define BLOCK_CHK_BAD 2
+
 // Estructura de un descriptor de TZX
 struct tTZXBlockDescriptor {
   int ID = 0;
@@ -199,7 +207,7 @@ struct tTZXBlockDescriptor {
   int maskLastByte = 8;
   bool hasMaskLastByte = false;
   tTimming timming;
-  tSymbol symbol;
+  tSymbol *symbol = nullptr; // Solo para ID 0x19. Se reserva al analizarlo
   uint16_t call_sequence_count;
   uint16_t *call_sequence_array;
   uint16_t numSelections;
@@ -208,6 +216,9 @@ struct tTZXBlockDescriptor {
   int compressionType = 0;
   int group = 0;
   int loop_count = 0;
+  int jump_relative = 0; // ID 0x23. Bloques a saltar (con signo)
+  uint64_t durationTStates = 0; // Una pasada por el bloque, pausa incluida
+  uint8_t chkStatus = BLOCK_CHK_NONE; // BLOCK_CHK_xxx. Solo 0x10 y 0x11
   bool jump_this_ID = false;
   int samplingRate = 79;
   bool signalLvl = false; // true == polarization UP, false == DOWN
@@ -222,6 +233,7 @@ struct tTZX {
   int numBlocks = 0; // Numero de bloques
   bool hasGroupBlocks = false;
   tTZXBlockDescriptor *descriptor = nullptr; // Descriptor
+  int capacity = 0; // Descriptores reservados en "descriptor"
   bool availableForREM = true;
 };
 
@@ -243,9 +255,9 @@ struct tPZXBlockDescriptor {
   uint16_t *data_s0_pulses = nullptr;
   uint16_t *data_s1_pulses = nullptr;
   int data_stream_offset = 0;
-  // Para bloques CSW
-  int csw_num_pulses;
-  tRlePulse *csw_pulse_data;
+  // Para bloques CSW. Datos Z-RLE en el fichero (ver CSWStream)
+  int csw_data_offset = 0;
+  int csw_data_size = 0;
   // Para el bloque PZX STOP
   uint16_t stop_flags;
   // Para bloque PAUS
@@ -321,6 +333,53 @@ struct tConfig {
 //
 bool myTAPmemoryReserved = false;
 bool myTZXmemoryReserved = false;
+
+bool reserveTZXDescriptors(tTZX &tzx, int count,
+                           tTZXBlockDescriptor **oldTable = nullptr) {
+  // La tabla de descriptores crece por trozos según aparecen bloques, así la
+  // memoria es proporcional al fichero y no hay límite fijo de bloques.
+  // Los descriptores nuevos quedan a cero, como con ps_calloc.
+  //
+  // Con "oldTable" la tabla vieja no se libera, se devuelve ahí: otra tarea
+  // puede estar leyéndola. En ese caso se crece doblando, para que la suma de
+  // tablas viejas no pase del tamaño de la nueva.
+  if (count <= tzx.capacity) {
+    return true;
+  }
+
+  int capacity = (tzx.capacity == 0) ? TZX_DESCRIPTOR_CHUNK : tzx.capacity;
+  while (capacity < count) {
+    capacity += (capacity < 1024 || oldTable != nullptr)
+                    ? capacity
+                    : TZX_DESCRIPTOR_CHUNK * 16;
+  }
+
+  tTZXBlockDescriptor *descriptor;
+  if (oldTable != nullptr) {
+    descriptor = (tTZXBlockDescriptor *)ps_malloc(
+        capacity * sizeof(tTZXBlockDescriptor));
+    if (descriptor != nullptr && tzx.descriptor != nullptr) {
+      memcpy(descriptor, tzx.descriptor,
+             tzx.capacity * sizeof(tTZXBlockDescriptor));
+    }
+  } else {
+    descriptor = (tTZXBlockDescriptor *)ps_realloc(
+        tzx.descriptor, capacity * sizeof(tTZXBlockDescriptor));
+  }
+  if (descriptor == nullptr) {
+    return false;
+  }
+
+  if (oldTable != nullptr) {
+    *oldTable = tzx.descriptor;
+  }
+
+  memset(descriptor + tzx.capacity, 0,
+         (capacity - tzx.capacity) * sizeof(tTZXBlockDescriptor));
+  tzx.descriptor = descriptor;
+  tzx.capacity = capacity;
+  return true;
+}
 // bool bitChStrMemoryReserved = false;
 // bool datablockMemoryReserved = false;
 // bool bufferRecMemoryReserved = false;
@@ -329,7 +388,6 @@ bool myTZXmemoryReserved = false;
 // ********************************************************************
 //
 bool SILENCEDEBUG = false;
-double ACU_ERROR = 0.0;
 double INTPART = 0.0;
 
 // Timming estandar de la ROM
@@ -406,6 +464,16 @@ bool PLAY_TO_WAV_FILE = false;
 bool WAV_8BIT_MONO = false;
 bool disable_auto_media_stop = false;
 
+// Conversion de cintas (ver OfflineRender.h). OFFLINE_RENDER indica a donde va
+// la salida mientras se convierte y CONVERT_DIR_REQUEST pide convertir el
+// directorio actual
+#define OFFLINE_NONE 0
+#define OFFLINE_WAV 1
+#define OFFLINE_PZX 2
+#define OFFLINE_TZX 3
+uint8_t OFFLINE_RENDER = OFFLINE_NONE;
+uint8_t CONVERT_DIR_REQUEST = OFFLINE_NONE;
+
 // Power led
 bool POWERLED_ON = true;
 bool ENABLE_POWER_LED = true;
@@ -415,7 +483,6 @@ bool HIDE_VIRTUAL_KEY = false;
 
 uint8_t TAPESTATE = 0;
 uint8_t LAST_TAPESTATE = 0;
-bool ADD_ONE_SAMPLE_COMPENSATION = false;
 bool MCP23017_AVAILABLE = false;
 
 // --------------------------------------------------------------------------
@@ -454,6 +521,72 @@ int LEVELDOWN = maxLevelDown;
 int DEBUG_AMP_L = 0;
 int DEBUG_AMP_R = 0;
 
+// Frames estereo por nivel de señal (R en la parte baja, L en la alta), con el
+// volumen y el speaker ya aplicados. Indices: down, up y LEVEL_ZERO.
+// Se reconstruye cuando el HMI marca VOL_CHANGE.
+#define LEVEL_ZERO 2
+uint32_t LEVEL_FRAME[3] = {0, 0, 0};
+
+// Reloj de T-states (ZXProcessor)
+// Acumulador de fase en unidades de T-states x sampling rate. SR y CPU
+// se guardan reducidos por su mcd.
+uint64_t TSTATE_CLOCK_PHASE = 0;
+uint32_t TSTATE_CLOCK_SR = 0;
+uint32_t TSTATE_CLOCK_CPU = 0;
+double TSTATE_CLOCK_BASE_SR = 0;
+// Totales de la reproducción en curso, para verificar la deriva
+uint64_t TSTATE_CLOCK_TOTAL_T = 0;
+uint64_t TSTATE_CLOCK_TOTAL_SAMPLES = 0;
+
+// Tiempo de cinta (T-states) de la reproducción TZX en curso, para el HMI.
+// Sale de la duración de cada bloque calculada al abrir el fichero
+uint64_t TAPE_TOTAL_T = 0;
+uint64_t TAPE_ELAPSED_T = 0; // Hasta el inicio del bloque en curso
+uint64_t TAPE_BLOCK_T = 0;   // Duración del bloque en curso
+
+// Renderizador de pulsos por bloques
+// Cada frame es R (16 bits bajos) + L (16 bits altos), igual que el orden en el stream
+uint32_t PULSE_RENDER_BLOCK[PULSE_RENDER_BLOCK_FRAMES];
+int PULSE_RENDER_FILL = 0;
+// Metrica de rendimiento (muestras/s de sintesis, sin contar la escritura en I2S)
+uint64_t PULSE_RENDER_FRAMES = 0;
+uint64_t PULSE_RENDER_BUSY_US = 0;
+unsigned long PULSE_RENDER_T0 = 0;
+double PULSE_RENDER_SPS = 0;
+
+// Buffer de salida de audio (PCM ring)
+// Se pone a true con la primera escritura de una reproducción y a false al cerrarla
+bool PCM_RING_STREAMING = false;
+// Veces que la tarea de salida encontró el buffer vacío durante la reproducción
+uint32_t PCM_RING_UNDERRUNS = 0;
+// Ocupación actual del buffer (%)
+int PCM_RING_LEVEL = 0;
+
+// Eventos de transporte para el generador de pulsos. Los escriben el HMI
+// (STOP / PAUSE) y la interrupción del pin REM; el bucle de audio solo lee
+// esta palabra, sin tocar el GPIO ni el HMI.
+#define TAPE_EVENT_STOP 0x01
+#define TAPE_EVENT_PAUSE 0x02
+#define TAPE_EVENT_REM 0x04 // Motor parado (pin REM en alto)
+std::atomic<uint32_t> TAPE_EVENTS{0};
+// Bloques TZX ya descritos (0..N-1). El analizador lo publica después de
+// completar cada descriptor; la reproducción no pasa de aquí
+std::atomic<int> TZX_BLOCKS_READY{0};
+// Análisis en curso en la tarea del analizador y petición para cortarlo
+volatile bool TZX_PARSE_RUNNING = false;
+volatile bool TZX_PARSE_CANCEL = false;
+// Analisis terminado y pendiente de aplicar en la tarea que abrio el fichero
+volatile bool TZX_PARSE_FINISHED = false;
+// Frames entregados al codec. Los cuenta la tarea de salida
+volatile uint32_t AUDIO_OUT_FRAMES = 0;
+// AUDIO_OUT_FRAMES en el momento del último evento
+volatile uint32_t TAPE_EVENT_FRAME = 0;
+// Muestras que siguieron sonando desde el último STOP / PAUSE / REM
+uint32_t STOP_LATENCY_SAMPLES = 0;
+
+// Lecturas a la SD al analizar el último fichero abierto
+uint32_t SD_READS_LAST_OPEN = 0;
+
 // Tamaño del fichero abierto
 int FILE_LENGTH = 0;
 bool FILE_IS_OPEN = false;
@@ -591,6 +724,8 @@ int LOOP_START = 0;
 int BL_LOOP_START = 0;
 int LOOP_COUNT = 0;
 int LOOP_PLAYED = 0;
+int CALL_BLOCK = -1; // Call sequence (0x26) en curso
+int CALL_PLAYED = 0;
 int LOOP_END = 0;
 int BL_LOOP_END = 0;
 bool WAITING_FOR_USER_ACTION = false;
@@ -722,7 +857,9 @@ float EQ_LOW = 0.7;
 bool EQ_CHANGE = false;
 bool AMP_CHANGE = false;
 bool SPK_CHANGE = false;
-bool VOL_CHANGE = false;
+// Cambio de volumen, speaker o polaridad pendiente de aplicar a LEVEL_FRAME.
+// Empieza a true para construir la tabla la primera vez.
+bool VOL_CHANGE = true;
 bool VOL_LIMIT_HEADPHONE = false;
 double TONE_ADJUST = 0.0;
 int SAMPLES_ADJUST = 0;
@@ -1309,6 +1446,29 @@ uint8_t MCP23017_readGPIO(uint8_t regGPIO, uint8_t i2c_addr = 0x20) {
   return a;
 }
 
+void raiseTapeEvent(uint32_t ev) {
+  // Marca un evento de transporte y anota en qué muestra se produjo
+  if ((TAPE_EVENTS.load() & ev) == 0) {
+    TAPE_EVENT_FRAME = AUDIO_OUT_FRAMES;
+  }
+  TAPE_EVENTS.fetch_or(ev);
+}
+
+void clearTapeEvents() {
+  // Al empezar a reproducir. El REM es un nivel y lo mantiene la interrupción
+  TAPE_EVENTS.fetch_and(~(uint32_t)(TAPE_EVENT_STOP | TAPE_EVENT_PAUSE));
+}
+
+void IRAM_ATTR remISR() {
+  // Flanco en el pin REM. LOW = motor en marcha
+  if (digitalRead(GPIO_MSX_REMOTE_PAUSE) == LOW) {
+    TAPE_EVENTS.fetch_and(~(uint32_t)TAPE_EVENT_REM);
+  } else {
+    TAPE_EVENT_FRAME = AUDIO_OUT_FRAMES;
+    TAPE_EVENTS.fetch_or(TAPE_EVENT_REM);
+  }
+}
+
 void remDetection() {
   bool isAvailableForREM = false;
 
@@ -129,6 +129,47 @@ WAVEncoder wavEncoder;
 EncodedAudioStream encoderOutWAV(&wavfile, &wavEncoder);
 #endif
 
+// Buffer de salida de audio entre los procesadores de cinta y el I2S
+#include "PCMRingBuffer.h"
+PCMRingBuffer pcmRing;
+TaskHandle_t TaskAudioOut;
+
+// Analisis de ficheros TZX en paralelo con la reproduccion
+TaskHandle_t TaskParse;
+char PARSE_PATH[257];
+
+// Cache de bloques ya renderizados, para repetirlos sin volver a la SD
+#include "BlockPCMCache.h"
+BlockPCMCache blockCache;
+
+// Representacion intermedia (semi-pulsos en T-states) de todos los formatos
+#include "EdgeList.h"
+
+// Checksum XOR de los bloques de datos
+#include "XorChecksum.h"
+
+// Lectura anticipada para el analisis de bloques al abrir un fichero
+#include "FileWindowReader.h"
+
+// Memoria de los datos de los descriptores del fichero abierto
+#include "ParseArena.h"
+ParseArena parseArena;
+
+// Lectura de bloques CSW al reproducir
+#include "CSWStream.h"
+
+// Grupos, bucles, saltos y tiempos de los bloques TZX
+#include "TapeNavIndex.h"
+TapeNavIndex tapeNav;
+
+// Indice de bloques (.dsc) para reabrir ficheros sin analizarlos
+#include "DescriptorIndex.h"
+DescriptorIndex dscIndex;
+
+// Conversion de cintas sin audio (WAV / PZX / TZX)
+#include "OfflineRender.h"
+OfflineRender offlineRender;
+
 #include "ZXProcessor.h"
 
 // ZX Spectrum. Procesador de audio output
@@ -212,6 +253,7 @@ bool statusRXLine = false;
 // Prototype function
 
 void ejectingFile();
+bool createSpecialDirectory(String fDir);
 void isGroupStart();
 void isGroupEnd();
 void getRandomFilenameWAV(char *&currentPath, String currentFileBaseName);
@@ -264,60 +306,6 @@ void actuatePowerLed(uint8_t state) {
   }
 }
 
-void freeMemoryFromDescriptorTZX(tTZXBlockDescriptor *descriptor) {
-  // Vamos a liberar el descriptor completo
-  for (int n = 0; n < TOTAL_BLOCKS; n++) {
-    switch (descriptor[n].ID) {
-    case 19: // bloque 0x13
-      // Hay que liberar el array
-      // delete[] descriptor[n].timming.pulse_seq_array;
-      free(descriptor[n].timming.pulse_seq_array);
-      break;
-
-    case 25: // bloque 0x19 - GDB
-      // Liberar symDefPilot y sus pulse_array internos
-      if (descriptor[n].symbol.symDefPilot != nullptr) {
-        for (int i = 0; i < descriptor[n].symbol.ASP; i++) {
-          if (descriptor[n].symbol.symDefPilot[i].pulse_array != nullptr) {
-            free(descriptor[n].symbol.symDefPilot[i].pulse_array);
-            descriptor[n].symbol.symDefPilot[i].pulse_array = nullptr;
-          }
-        }
-        free(descriptor[n].symbol.symDefPilot);
-        descriptor[n].symbol.symDefPilot = nullptr;
-      }
-
-      // Liberar pilotStream
-      if (descriptor[n].symbol.pilotStream != nullptr) {
-        free(descriptor[n].symbol.pilotStream);
-        descriptor[n].symbol.pilotStream = nullptr;
-      }
-
-      // Liberar symDefData y sus pulse_array internos
-      if (descriptor[n].symbol.symDefData != nullptr) {
-        for (int i = 0; i < descriptor[n].symbol.ASD; i++) {
-          if (descriptor[n].symbol.symDefData[i].pulse_array != nullptr) {
-            free(descriptor[n].symbol.symDefData[i].pulse_array);
-            descriptor[n].symbol.symDefData[i].pulse_array = nullptr;
-          }
-        }
-        free(descriptor[n].symbol.symDefData);
-        descriptor[n].symbol.symDefData = nullptr;
-      }
-
-      // Liberar dataStream
-      if (descriptor[n].symbol.dataStream != nullptr) {
-        free(descriptor[n].symbol.dataStream);
-        descriptor[n].symbol.dataStream = nullptr;
-      }
-      break;
-
-    default:
-      break;
-    }
-  }
-}
-
 int *strToIPAddress(String strIPAddr) {
   int *ipnum = new int[4];
   int wc = 0;
@@ -703,15 +691,20 @@ void proccesingTAP(char *file_ch) {
   }
 }
 
-void proccesingTZX(char *file_ch) {
-  // Procesamos ficheros CDT, TSX y TZX
-  pTZX.initialize();
+void finishProcessingTZX() {
+  // Siempre en la tarea que abrio el fichero, nunca en la del analizador
+  logln("Parse arena: " + String(parseArena.getUsedBytes()) + " bytes used / " +
+        String(parseArena.getReservedBytes()) + " reserved");
 
-  pTZX.process(file_ch);
+  // La tabla ha podido moverse al crecer
+  myTZX.descriptor = pTZX.getDescriptor();
+  myTZX.capacity = pTZX.getCapacity();
+  pTZX.finishParseResults();
 
-  if (ABORT) {
+  // STOP o PAUSE durante el analisis en paralelo no lo cortan. Solo expulsar
+  // o cambiar de fichero
+  if (pTZX.parseCancelled()) {
     FILE_PREPARED = false;
-    // ABORT=false;
   } else {
     if (TOTAL_BLOCKS != 0) {
       FILE_PREPARED = true;
@@ -725,11 +718,95 @@ void proccesingTZX(char *file_ch) {
   }
 }
 
+void TaskParsecode(void *pvParameters) {
+  // Analiza el fichero entero. La reproduccion puede empezar en cuanto
+  // esta descrito el primer bloque
+  pTZX.process(PARSE_PATH);
+  // El resultado lo aplica pollTZXParse()
+  TZX_PARSE_FINISHED = true;
+  TZX_PARSE_RUNNING = false;
+  vTaskDelete(NULL);
+}
+
+void pollTZXParse() {
+  // Lo que deja el analisis en paralelo se aplica aqui, en la tarea que
+  // abrio el fichero
+  if (TZX_PARSE_RUNNING) {
+    pTZX.applyParseResults();
+  } else if (TZX_PARSE_FINISHED) {
+    TZX_PARSE_FINISHED = false;
+    finishProcessingTZX();
+  }
+}
+
+void stopTZXParseTask() {
+  // Al expulsar o cambiar de fichero el analisis en curso se cancela
+  if (!TZX_PARSE_RUNNING) {
+    return;
+  }
+  TZX_PARSE_CANCEL = true;
+  while (TZX_PARSE_RUNNING) {
+    delay(5);
+  }
+  // El resultado de un analisis cortado no se aplica
+  TZX_PARSE_FINISHED = false;
+  TZX_PARSE_CANCEL = false;
+  logln("TZX parse cancelled");
+}
+
+void proccesingTZX(char *file_ch) {
+  // Procesamos ficheros CDT, TSX y TZX
+  pTZX.setMirror(&myTZX);
+  pTZX.initialize();
+
+  // Lo que quede de un analisis abortado ya no lo usa nadie
+  tapeNav.clear();
+  parseArena.reset();
+
+  LAST_MESSAGE = "Analyzing file. Capturing blocks";
+
+#ifdef TZX_PARSE_TASK_ENABLE
+  strncpy(PARSE_PATH, file_ch, sizeof(PARSE_PATH) - 1);
+  PARSE_PATH[sizeof(PARSE_PATH) - 1] = '\0';
+  TZX_PARSE_FINISHED = false;
+  TZX_PARSE_RUNNING = true;
+
+  if (xTaskCreatePinnedToCore(TaskParsecode, "TaskParse",
+                              TASK_PARSE_STACK_SIZE, NULL, 2, &TaskParse,
+                              1) == pdPASS) {
+    // Esperamos solo a tener el primer bloque (el 0 es el vacio)
+    while (TZX_PARSE_RUNNING && TZX_BLOCKS_READY.load() < 2) {
+      delay(1);
+    }
+    if (TZX_PARSE_RUNNING) {
+      // El resto se sigue analizando mientras tanto
+      FILE_PREPARED = true;
+    }
+    // Lo ya analizado, o el final si el fichero era corto
+    pollTZXParse();
+    return;
+  }
+
+  // Sin memoria para la tarea. Lo analizamos aqui
+  TZX_PARSE_RUNNING = false;
+  logln("Warning: TZX parse task not created");
+#endif
+
+  pTZX.process(file_ch);
+  finishProcessingTZX();
+}
+
 void proccesingPZX(char *file_ch) {
   // Procesamos ficheros CDT, TSX y TZX
   pPZX.initialize();
 
+  // Lo que quede de un analisis abortado ya no lo usa nadie
+  tapeNav.clear();
+  parseArena.reset();
+
   pPZX.process(file_ch);
+  logln("Parse arena: " + String(parseArena.getUsedBytes()) + " bytes used / " +
+        String(parseArena.getReservedBytes()) + " reserved");
 
   if (ABORT) {
     FILE_PREPARED = false;
@@ -1624,47 +1701,6 @@ void updateSamplingRate(AudioPlayer &player, Equalizer3Bands &eq,
   }
 }
 
-void estimatePlayingTime(int fileread, int filesize, int samprate) {
-
-  if (samprate > 0) {
-    float totalTime = 0;
-
-    if (TYPE_FILE_LOAD == "WAV") {
-      totalTime = (filesize) / (samprate);
-    } else {
-      totalTime = (filesize * 8) / (samprate);
-    }
-
-    int tmin = totalTime / 60.0;
-    int tsec = totalTime - (tmin * 60);
-
-    String utsec = (tsec < 10) ? "0" : "";
-    String utmin = (tmin < 10) ? "0" : "";
-
-    // Elapsed time
-    // logln("Bit rate por sample: " + String(ainfo.bits_per_sample));
-    // logln("Sampling rate:       " + String(ainfo.sample_rate));
-
-    float time = 0;
-
-    if (TYPE_FILE_LOAD == "WAV") {
-      time = (fileread) / (samprate);
-    } else {
-      time = (fileread * 8) / (samprate);
-    }
-
-    int min = time / 60.0;
-    int sec = time - (min * 60);
-
-    String usec = (sec < 10) ? "0" : "";
-    String umin = (min < 10) ? "0" : "";
-
-    LAST_MESSAGE = "Total time:  [" + utmin + String(tmin) + ":" + utsec +
-                   String(tsec) + "]   -   Elapsed:  [" + umin + String(min) +
-                   ":" + usec + String(sec) + "]";
-  }
-}
-
 String removeExtension(const String &filename) {
   int dotIndex = filename.lastIndexOf('.');
   if (dotIndex > 0) {
@@ -4503,8 +4539,10 @@ void loadingFile(char *file_ch) {
       //
       if (!myTZXmemoryReserved) 
       {
-        myTZX.descriptor = (tTZXBlockDescriptor *)ps_calloc(MAX_BLOCKS_IN_TZX, sizeof(struct tTZXBlockDescriptor));
-        myTZXmemoryReserved = true;
+        // Primer trozo. La tabla crece al analizar el fichero
+        myTZX.descriptor = nullptr;
+        myTZX.capacity = 0;
+        myTZXmemoryReserved = reserveTZXDescriptors(myTZX, TZX_DESCRIPTOR_CHUNK);
       }
 
       // Pasamos el control a la clase
@@ -4562,39 +4600,9 @@ void stopFile() {
   tapeAnimationOFF();
 }
 
-void freeMemoryFromDescriptorPZX(tPZXBlockDescriptor *descriptor) {
-  if (descriptor == nullptr)
-    return;
-
-  // Iteramos por todos los bloques para liberar la memoria de los punteros
-  // internos
-  for (int n = 0; n < TOTAL_BLOCKS; n++) {
-    if (strcmp(descriptor[n].tag, "PULS") == 0) {
-      // PULS usa timming.pzx_pulse_data (asignado en analyzePULS)
-      if (descriptor[n].timming.pzx_pulse_data != nullptr) {
-        free(descriptor[n].timming.pzx_pulse_data);
-        descriptor[n].timming.pzx_pulse_data = nullptr;
-      }
-    } else if (strcmp(descriptor[n].tag, "DATA") == 0) {
-      if (descriptor[n].data_s0_pulses != nullptr) {
-        free(descriptor[n].data_s0_pulses);
-        descriptor[n].data_s0_pulses = nullptr;
-      }
-      if (descriptor[n].data_s1_pulses != nullptr) {
-        free(descriptor[n].data_s1_pulses);
-        descriptor[n].data_s1_pulses = nullptr;
-      }
-    } else if (strcmp(descriptor[n].tag, "CSW") == 0) {
-      if (descriptor[n].csw_pulse_data != nullptr) {
-        free(descriptor[n].csw_pulse_data);
-        descriptor[n].csw_pulse_data = nullptr;
-      }
-    }
-  }
-}
-
 void ejectingFile() {
   logln("Eject executing for " + TYPE_FILE_LOAD);
+  stopTZXParseTask();
   // Terminamos los players
   if (TYPE_FILE_LOAD == "TAP") {
     // Solicitamos el puntero _myTAP de la clase
@@ -4614,8 +4622,12 @@ void ejectingFile() {
     logln("Eject TZX");
     if (myTZXmemoryReserved) {
       LAST_MESSAGE = "Preparing structure";
-      freeMemoryFromDescriptorTZX(pTZX.getDescriptor());
+      // Los datos de cada bloque salen de la arena
+      tapeNav.clear();
+      parseArena.reset();
       free(pTZX.getDescriptor());
+      myTZX.descriptor = nullptr;
+      myTZX.capacity = 0;
       // Finalizamos
       pTZX.terminate();
       myTZXmemoryReserved = false;
@@ -4626,7 +4638,7 @@ void ejectingFile() {
     if (myPZX.descriptor != nullptr) {
       LAST_MESSAGE = "Preparing structure";
       // Primero liberamos la memoria interna de cada bloque
-      freeMemoryFromDescriptorPZX(myPZX.descriptor);
+      parseArena.reset();
       // Luego liberamos el array de descriptores principal
       free(myPZX.descriptor);
       myPZX.descriptor = nullptr;
@@ -4644,6 +4656,154 @@ void ejectingFile() {
   LAST_MESSAGE = "No file inside the tape";
 }
 
+bool canConvert(const String &name, uint8_t target) {
+  // TZX solo sale de un TAP. PZX y WAV de cualquier cinta
+  String ext = name.substring(name.lastIndexOf('.') + 1);
+  ext.toUpperCase();
+
+  if (target == OFFLINE_TZX) {
+    return ext == "TAP";
+  }
+  return ext == "TAP" || ext == "TZX" || ext == "TSX" || ext == "CDT" ||
+         ext == "PZX";
+}
+
+bool convertFile(const String &path, uint8_t target) {
+  // Convierte un fichero de cinta sin audio. La salida va a /CONV (TZX, PZX)
+  // o a /WAV con el mismo nombre
+  String name = getFileNameFromPath(path);
+  if (!canConvert(name, target)) {
+    return false;
+  }
+
+  String out;
+  if (target == OFFLINE_WAV) {
+    out = "/WAV/" + removeExtension(name) + ".wav";
+  } else if (target == OFFLINE_PZX) {
+    out = "/CONV/" + removeExtension(name) + ".pzx";
+  } else {
+    out = "/CONV/" + removeExtension(name) + ".tzx";
+  }
+
+  if (target == OFFLINE_TZX) {
+    // Los bloques del TAP se copian tal cual
+    LAST_MESSAGE = "Converting " + name;
+    unsigned long t0 = millis();
+    bool ok = convertTAPtoTZX(path.c_str(), out.c_str());
+    logln("Converted " + path + " -> " + out + " in " +
+          String(millis() - t0) + " ms");
+    return ok;
+  }
+
+  // Se carga como si se hubiera elegido en el navegador
+  char file_ch[257];
+  PATH_FILE_TO_LOAD = path;
+  path.toCharArray(file_ch, 256);
+  FILE_SELECTED = true;
+  loadingFile(file_ch);
+  FILE_SELECTED = false;
+
+  if (!FILE_PREPARED) {
+    logln("Convert: " + path + " not prepared");
+    return false;
+  }
+
+  double lastSR = SAMPLING_RATE;
+  bool opened;
+  if (target == OFFLINE_WAV) {
+    SAMPLING_RATE = DEFAULT_WAV_SAMPLING_RATE_REC;
+    opened = offlineRender.beginWAV(out.c_str(), DEFAULT_WAV_SAMPLING_RATE_REC);
+  } else {
+    opened = offlineRender.beginPZX(out.c_str(), removeExtension(name),
+                                    (uint32_t)DfreqCPU);
+  }
+
+  bool ok = false;
+  if (opened) {
+    LAST_MESSAGE = "Converting " + name;
+    unsigned long t0 = millis();
+
+    OFFLINE_RENDER = target;
+    STATUS_REM_ACTUATED = false;
+    STOP = false;
+    PAUSE = false;
+    EJECT = false;
+    PLAY = true;
+    LOADING_STATE = 1;
+    BLOCK_SELECTED = 0;
+    clearTapeEvents();
+
+    if (TYPE_FILE_LOAD == "TAP") {
+      pTAP.play();
+    } else if (TYPE_FILE_LOAD == "PZX") {
+      pPZX.play();
+    } else {
+      pTZX.play();
+    }
+
+    OFFLINE_RENDER = OFFLINE_NONE;
+    ok = offlineRender.end();
+    logln("Converted " + path + " -> " + out + " in " +
+          String(millis() - t0) + " ms");
+  } else {
+    logln("Convert: cannot create " + out);
+  }
+
+  SAMPLING_RATE = lastSR;
+  PLAY = false;
+  LOADING_STATE = 0;
+  AUTO_STOP = false;
+
+  ejectingFile();
+  FILE_PREPARED = false;
+  return ok;
+}
+
+void convertDirectory(const String &dir, uint8_t target) {
+  // Convierte todos los ficheros de cinta del directorio. STOP cancela
+  String base = dir.endsWith("/") ? dir : dir + "/";
+  File root = SD_MMC.open(dir.length() > 0 ? dir : "/");
+  if (!root || !root.isDirectory()) {
+    LAST_MESSAGE = "Convert: directory not found";
+    return;
+  }
+
+  if (target != OFFLINE_WAV) {
+    createSpecialDirectory("/CONV");
+  }
+
+  int converted = 0;
+  int failed = 0;
+  File entry = root.openNextFile();
+  while (entry) {
+    bool isDir = entry.isDirectory();
+    String name = getFileNameFromPath(String(entry.name()));
+    entry.close();
+
+    if (!isDir && canConvert(name, target)) {
+      if (convertFile(base + name, target)) {
+        converted++;
+      } else {
+        failed++;
+      }
+    }
+
+    if (TAPE_EVENTS.load() & TAPE_EVENT_STOP) {
+      logln("Convert: cancelled");
+      break;
+    }
+    entry = root.openNextFile();
+  }
+  root.close();
+
+  clearTapeEvents();
+  STOP = true;
+  hmi.clearInformationFile();
+  LAST_MESSAGE = "Converted " + String(converted) + " files, " +
+                 String(failed) + " failed";
+  logln(LAST_MESSAGE);
+}
+
 void prepareRecording() {
   hmi.activateWifi(false);
 
@@ -4718,9 +4878,14 @@ void nextGroupBlock() {
   if (TYPE_FILE_LOAD != "TAP" && TYPE_FILE_LOAD != "WAV" &&
       TYPE_FILE_LOAD != "MP3" && TYPE_FILE_LOAD != "FLAC" &&
       TYPE_FILE_LOAD != "RADIO") {
-    while (myTZX.descriptor[BLOCK_SELECTED].ID != 34 &&
-           BLOCK_SELECTED <= TOTAL_BLOCKS) {
-      BLOCK_SELECTED++;
+    if (tapeNav.groupEndOf(BLOCK_SELECTED) >= 0) {
+      // El indice ya tiene el Group end de este grupo
+      BLOCK_SELECTED = tapeNav.groupEndOf(BLOCK_SELECTED);
+    } else {
+      while (BLOCK_SELECTED < TOTAL_BLOCKS &&
+             myTZX.descriptor[BLOCK_SELECTED].ID != 34) {
+        BLOCK_SELECTED++;
+      }
     }
 
     if (BLOCK_SELECTED > (TOTAL_BLOCKS - 1)) {
@@ -4743,11 +4908,16 @@ void prevGroupBlock() {
   if (TYPE_FILE_LOAD != "TAP" && TYPE_FILE_LOAD != "WAV" &&
       TYPE_FILE_LOAD != "MP3" && TYPE_FILE_LOAD != "FLAC" &&
       TYPE_FILE_LOAD != "RADIO") {
-    while (myTZX.descriptor[BLOCK_SELECTED].ID != 33 && BLOCK_SELECTED > 1) {
-      BLOCK_SELECTED--;
+    if (tapeNav.groupStartOf(BLOCK_SELECTED) >= 0) {
+      // El indice ya tiene el Group start de este grupo
+      BLOCK_SELECTED = tapeNav.groupStartOf(BLOCK_SELECTED);
+    } else {
+      while (myTZX.descriptor[BLOCK_SELECTED].ID != 33 && BLOCK_SELECTED > 1) {
+        BLOCK_SELECTED--;
+      }
     }
 
-    if (BLOCK_SELECTED < 1) {
+    if (BLOCK_SELECTED < 0) {
       // No he encontrado el Group Start
       BLOCK_SELECTED = TOTAL_BLOCKS - 1;
     } else {
@@ -4910,12 +5080,12 @@ void getTheFirstPlayeableBlock() {
   if (TYPE_FILE_LOAD != "TAP" && TYPE_FILE_LOAD != "PZX") {
     int i = 0;
 
-    while (!myTZX.descriptor[i].playeable) {
+    while (i < TOTAL_BLOCKS && !myTZX.descriptor[i].playeable) {
       BLOCK_SELECTED = i;
       i++;
     }
 
-    if (i > MAX_BLOCKS_IN_TZX) {
+    if (i >= TOTAL_BLOCKS) {
       i = 0;
     }
 
@@ -5070,7 +5240,9 @@ void recoverEdgeBeginOfBlock() {
   if (TYPE_FILE_LOAD == "TZX" || TYPE_FILE_LOAD == "CDT" ||
       TYPE_FILE_LOAD == "TSX") {
     // Recuperamos el flanco con el que empezo el bloque
-    EDGE_EAR_IS = myTZX.descriptor[BLOCK_SELECTED].edge;
+    if (!pTZX.edgeAtStartOf(BLOCK_SELECTED, EDGE_EAR_IS)) {
+      EDGE_EAR_IS = INVERSETRAIN ? POLARIZATION ^ 1 : POLARIZATION;
+    }
   } else if (TYPE_FILE_LOAD == "PZX") {
     // Recuperamos el flanco con el que empezo el bloque
     EDGE_EAR_IS = myPZX.descriptor[BLOCK_SELECTED].edge;
@@ -5115,6 +5287,8 @@ void tapeControl() {
   //
   // Nuevo tapeControl
 
+  pollTZXParse();
+
   if (UPDATE_HMI) {
     updateHMIOnBlockChange();
     UPDATE_HMI = false;
@@ -5173,6 +5347,13 @@ void tapeControl() {
       //
       setPolarization();
     }
+    else if (CONVERT_DIR_REQUEST != OFFLINE_NONE)
+    {
+      // Conversion del directorio actual sin audio
+      uint8_t target = CONVERT_DIR_REQUEST;
+      CONVERT_DIR_REQUEST = OFFLINE_NONE;
+      convertDirectory(FILE_LAST_DIR, target);
+    }
     else if (SAMPLINGTEST) 
     {
       logln("Testing is output at 96KHz");
@@ -5258,6 +5439,7 @@ void tapeControl() {
       // Inicializamos la polarización de la señal al iniciar la reproducción.
       //
       LOADING_STATE = 1;
+      clearTapeEvents();
       // Activamos la animación
       tapeAnimationON();
       // Reproducimos el fichero
@@ -5497,6 +5679,7 @@ void tapeControl() {
         // flujo de TAPESTATE
         TAPESTATE = 1;
         LOADING_STATE = 1;
+        clearTapeEvents();
 
         if (OUT_TO_WAV) {
           prepareOutputToWav();
@@ -8100,6 +8283,57 @@ void Task1code(void *pvParameters) {
   }
 }
 
+// Tarea de salida de audio. Vuelca el PCM ring al I2S
+void TaskAudioOutcode(void *pvParameters) {
+  bool wasEmpty = true;
+  bool eventSeen = false;
+
+  for (;;) {
+    // STOP / PAUSE / REM. Se descarta lo pendiente sin esperar a que el
+    // generador de pulsos lo vea, asi el audio se corta en el siguiente trozo.
+    // Y se sigue descartando hasta que lo vea y cierre el stream: lo que
+    // escriba mientras tanto tampoco debe sonar
+    uint32_t ev = TAPE_EVENTS.load(std::memory_order_acquire);
+    bool stopNow = (ev & (TAPE_EVENT_STOP | TAPE_EVENT_PAUSE)) ||
+                   ((ev & TAPE_EVENT_REM) && STATUS_REM_ACTUATED);
+
+    if (stopNow && PCM_RING_STREAMING) {
+      pcmRing.skipPending();
+      if (!eventSeen) {
+        // Lo que ha llegado al I2S desde el evento
+        STOP_LATENCY_SAMPLES = AUDIO_OUT_FRAMES - TAPE_EVENT_FRAME;
+        eventSeen = true;
+      }
+      wasEmpty = true;
+      vTaskDelay(1);
+      continue;
+    } else if (!stopNow) {
+      eventSeen = false;
+    }
+
+    uint8_t *ptr = nullptr;
+    size_t len = pcmRing.peek(ptr, PCM_RING_CHUNK);
+
+    PCM_RING_LEVEL = (int)((pcmRing.getAvailable() * 100) / pcmRing.getSize());
+
+    if (len == 0) {
+      // Buffer vacío en plena reproducción. Contamos el underrun una sola vez
+      // por cada vaciado
+      if (!wasEmpty && PCM_RING_STREAMING && LOADING_STATE == 1) {
+        PCM_RING_UNDERRUNS++;
+      }
+      wasEmpty = true;
+      vTaskDelay(1);
+      continue;
+    }
+
+    wasEmpty = false;
+    kitStream.write(ptr, len);
+    pcmRing.consume(len);
+    AUDIO_OUT_FRAMES += len / 4;
+  }
+}
+
 // Task0code se puede liberar desde el config, para usar un solo CORE
 void Task0code(void *pvParameters) {
 
@@ -8982,6 +9216,9 @@ void loadHMICfgfromNVS() {
     MAIN_VOL = MAX_VOL_FOR_HEADPHONE_LIMIT;
   }
 
+  // Avisamos al generador de pulsos para que recalcule los niveles
+  VOL_CHANGE = true;
+
   // Volumen sliders
   showOption("menuAudio.volM.val", String(int(MAIN_VOL)));
   showOption("menuAudio.volLevelM.val", String(int(MAIN_VOL)));
@@ -9269,6 +9506,11 @@ void setup() {
   // {
   delay(1250);
   pinMode(GPIO_MSX_REMOTE_PAUSE, INPUT_PULLUP);
+  // El REM se atiende por interrupción para pausar en cuanto cambia el pin
+  if (digitalRead(GPIO_MSX_REMOTE_PAUSE) != LOW) {
+    TAPE_EVENTS.fetch_or(TAPE_EVENT_REM);
+  }
+  attachInterrupt(digitalPinToInterrupt(GPIO_MSX_REMOTE_PAUSE), remISR, CHANGE);
 // }
 #endif
 
@@ -9434,6 +9676,27 @@ hmi.writeString("statusLCD.txt=\"Preparing environment\"");
   esp_task_wdt_add(&Task0);
   delay(500);
 
+  // Salida de audio. En el core del HMI, fuera del core de WiFi/FTP
+  #ifdef PCM_RING_ENABLE
+    if (pcmRing.begin(PCM_RING_SIZE))
+    {
+      if (xTaskCreatePinnedToCore(TaskAudioOutcode, "TaskAudioOut", TASK_AUDIO_OUT_STACK_SIZE, NULL,4 | portPRIVILEGE_BIT, &TaskAudioOut, 1) == pdPASS)
+      {
+        logln("PCM ring ready: " + String(pcmRing.getSize()) + " bytes");
+      }
+      else
+      {
+        // Sin tarea que lo vacie el ring no sirve
+        pcmRing.end();
+        logln("PCM ring task not created. Direct output.");
+      }
+    }
+    else
+    {
+      logln("PCM ring not available. Direct output.");
+    }
+  #endif
+
   // Inicializamos el modulo de recording
   taprec.set_HMI(hmi);
   // taprec.set_SdFat32(sdf);